@@ -0,0 +1,245 @@
+#include "attr-palette.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "macros.h"
+#include "util.h"
+#include "xmalloc.h"
+
+static inline uint32_t
+slot_index(const struct attr_palette *palette, uint64_t value)
+{
+    /* Fibonacci hashing */
+    const unsigned bits = __builtin_ctz(palette->size);
+    return (value * 11400714819323198485ull) >> (64 - bits);
+}
+
+static void
+hash_insert(struct attr_palette *palette, uint16_t idx)
+{
+    const uint32_t mask = palette->size - 1;
+    uint32_t slot = slot_index(palette, palette->values[idx]);
+
+    while (palette->slots[slot] != 0)
+        slot = (slot + 1) & mask;
+
+    palette->slots[slot] = idx;
+}
+
+static void
+hash_rebuild(struct attr_palette *palette, uint32_t size)
+{
+    free(palette->slots);
+    palette->slots = xcalloc(size, sizeof(palette->slots[0]));
+    palette->size = size;
+
+    for (uint32_t idx = 1; idx < palette->used; idx++) {
+        if (palette->values[idx] != 0)
+            hash_insert(palette, idx);
+    }
+}
+
+bool
+attr_palette_insert(struct attr_palette *palette, uint64_t value,
+                    uint32_t *idx)
+{
+    if (value == 0) {
+        *idx = 0;
+        return true;
+    }
+
+    if (palette->size > 0) {
+        const uint32_t mask = palette->size - 1;
+
+        for (uint32_t slot = slot_index(palette, value);
+             palette->slots[slot] != 0;
+             slot = (slot + 1) & mask)
+        {
+            const uint32_t i = palette->slots[slot];
+            if (palette->values[i] == value) {
+                *idx = i;
+                return true;
+            }
+        }
+    }
+
+    /* Not found; allocate a new index */
+    const uint32_t threshold = palette->gc_threshold > 0
+        ? palette->gc_threshold : ATTR_PALETTE_GC_MIN_THRESHOLD;
+
+    if (palette->count >= threshold)
+        return false;
+
+    uint32_t new_idx;
+
+    if (palette->free_count > 0)
+        new_idx = palette->free[--palette->free_count];
+    else if (palette->used < ATTR_PALETTE_MAX_ENTRIES) {
+        if (palette->used == 0)
+            palette->used = 1;  /* Index 0 is reserved */
+
+        if (palette->used >= palette->allocated) {
+            const uint32_t old_allocated = palette->allocated;
+
+            palette->allocated = max(palette->allocated * 2, 256u);
+            palette->values = xreallocarray(
+                palette->values, palette->allocated, sizeof(palette->values[0]));
+            palette->values[0] = 0;
+
+            if (palette->free != NULL) {
+                palette->free = xreallocarray(
+                    palette->free, palette->allocated, sizeof(palette->free[0]));
+            }
+
+            if (palette->marked != NULL) {
+                palette->marked = xreallocarray(
+                    palette->marked, palette->allocated / 64,
+                    sizeof(palette->marked[0]));
+                memset(&palette->marked[old_allocated / 64], 0,
+                       (palette->allocated - old_allocated) / 64 *
+                       sizeof(palette->marked[0]));
+            }
+        }
+
+        new_idx = palette->used++;
+    } else
+        return false;
+
+    palette->values[new_idx] = value;
+    palette->count++;
+
+    /* Keep the load factor below 50% */
+    if (palette->count * 2 > palette->size)
+        hash_rebuild(palette, max(palette->size * 2, 512u));
+    else
+        hash_insert(palette, new_idx);
+
+    *idx = new_idx;
+    return true;
+}
+
+void
+attr_palette_mark(struct attr_palette *palette, uint32_t idx)
+{
+    if (idx == 0)
+        return;
+
+    xassert(idx < palette->used);
+
+    if (palette->marked == NULL) {
+        palette->marked = xcalloc(
+            palette->allocated / 64, sizeof(palette->marked[0]));
+    }
+
+    palette->marked[idx / 64] |= 1ull << (idx % 64);
+}
+
+size_t
+attr_palette_sweep(struct attr_palette *palette)
+{
+    size_t removed = 0;
+
+    for (uint32_t idx = 1; idx < palette->used; idx++) {
+        if (palette->values[idx] == 0)
+            continue;
+
+        if (palette->marked != NULL &&
+            palette->marked[idx / 64] & (1ull << (idx % 64)))
+        {
+            continue;
+        }
+
+        if (palette->free == NULL) {
+            palette->free = xmalloc(
+                palette->allocated * sizeof(palette->free[0]));
+        }
+
+        palette->values[idx] = 0;
+        palette->free[palette->free_count++] = idx;
+        palette->count--;
+        removed++;
+    }
+
+    if (palette->marked != NULL) {
+        memset(palette->marked, 0,
+               palette->allocated / 64 * sizeof(palette->marked[0]));
+    }
+
+    if (removed > 0 && palette->size > 0)
+        hash_rebuild(palette, palette->size);
+
+    palette->gc_threshold = min(
+        max(ATTR_PALETTE_GC_MIN_THRESHOLD, palette->count * 2),
+        ATTR_PALETTE_MAX_ENTRIES - 1);
+
+    return removed;
+}
+
+void
+attr_palette_free(struct attr_palette *palette)
+{
+    free(palette->values);
+    free(palette->free);
+    free(palette->slots);
+    free(palette->marked);
+    *palette = (struct attr_palette){0};
+}
+
+UNITTEST
+{
+    struct attr_palette palette = {0};
+    uint32_t idx;
+
+    xassert(attr_palette_insert(&palette, 0, &idx));
+    xassert(idx == 0);
+    xassert(palette.count == 0);
+
+    /* Fill the palette */
+    for (uint64_t v = 1; v <= ATTR_PALETTE_GC_MIN_THRESHOLD; v++) {
+        xassert(attr_palette_insert(&palette, v << 24, &idx));
+        xassert(idx == v);
+    }
+
+    xassert(palette.count == ATTR_PALETTE_GC_MIN_THRESHOLD);
+    xassert(!attr_palette_insert(&palette, 1, &idx));
+
+    /* Existing entries are still found */
+    xassert(attr_palette_insert(&palette, 1234ull << 24, &idx));
+    xassert(idx == 1234);
+    xassert(attr_palette_get(&palette, 1234) == 1234ull << 24);
+
+    /* Keep every other entry */
+    for (uint32_t i = 2; i <= ATTR_PALETTE_GC_MIN_THRESHOLD; i += 2)
+        attr_palette_mark(&palette, i);
+
+    xassert(attr_palette_sweep(&palette) == ATTR_PALETTE_GC_MIN_THRESHOLD / 2);
+    xassert(palette.count == ATTR_PALETTE_GC_MIN_THRESHOLD / 2);
+    xassert(attr_palette_get(&palette, 1234) == 1234ull << 24);
+    xassert(attr_palette_get(&palette, 1235) == 0);
+
+    /* Free:d indices are re-used */
+    xassert(attr_palette_insert(&palette, 1, &idx));
+    xassert(idx % 2 == 1);
+    xassert(attr_palette_get(&palette, idx) == 1);
+
+    xassert(attr_palette_insert(&palette, 1234ull << 24, &idx));
+    xassert(idx == 1234);
+
+    /* Refill; when all entries are still in use, the palette grows */
+    for (uint64_t v = 2; palette.count < ATTR_PALETTE_GC_MIN_THRESHOLD; v++)
+        xassert(attr_palette_insert(&palette, v, &idx));
+    xassert(!attr_palette_insert(&palette, 1ull << 63, &idx));
+
+    for (uint32_t i = 1; i < palette.used; i++)
+        attr_palette_mark(&palette, i);
+    xassert(attr_palette_sweep(&palette) == 0);
+
+    xassert(attr_palette_insert(&palette, 1ull << 63, &idx));
+    xassert(idx > UINT16_MAX);
+    xassert(attr_palette_get(&palette, idx) == 1ull << 63);
+    xassert(attr_palette_get(&palette, 1234) == 1234ull << 24);
+
+    attr_palette_free(&palette);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Attribute palette, used by compact cells (FOOT_COMPACT_CELLS).
+ *
+ * Maps (64-bit) attribute values to 28-bit indices, and back. Index 0
+ * is reserved for the value 0 (i.e. the default attributes), and is
+ * never stored in the palette.
+ *
+ * Unused entries are garbage collected with attr_palette_mark() and
+ * attr_palette_sweep(). Indices of live entries never change. The
+ * palette grows when most of its entries are still in use after a
+ * collection.
+ */
+
+#define ATTR_PALETTE_IDX_BITS 28
+#define ATTR_PALETTE_MAX_ENTRIES (1u << ATTR_PALETTE_IDX_BITS)
+#define ATTR_PALETTE_GC_MIN_THRESHOLD (1u << 16)
+
+struct attr_palette {
+    uint64_t *values;   /* Index -> value; 0 if the index is free */
+    uint32_t used;      /* Indices handed out so far, including 0 */
+    uint32_t allocated; /* Size of 'values' */
+
+    uint32_t *free;     /* Free:d indices, below 'used' */
+    uint32_t free_count;
+
+    uint32_t *slots;    /* Hash table: value index, or 0 if empty */
+    uint32_t size;      /* Always a power of two (or 0) */
+    uint32_t count;     /* Number of live entries */
+
+    uint64_t *marked;   /* Bitmap, used by attr_palette_sweep() */
+
+    /* attr_palette_insert() fails when 'count' reaches this (0: the minimum) */
+    uint32_t gc_threshold;
+};
+
+/*
+ * Looks up 'value', inserting it if it doesn't exist. Returns false
+ * if the palette is full, i.e. when it is time to collect unused
+ * entries.
+ */
+bool attr_palette_insert(
+    struct attr_palette *palette, uint64_t value, uint32_t *idx);
+
+static inline uint64_t
+attr_palette_get(const struct attr_palette *palette, uint32_t idx)
+{
+    return idx < palette->used ? palette->values[idx] : 0;
+}
+
+/*
+ * Mark-and-sweep: attr_palette_sweep() frees all entries that have
+ * not been marked with attr_palette_mark() since the last sweep, and
+ * returns the number of entries free:d. The next collection is done
+ * when the number of live entries has doubled.
+ */
+void attr_palette_mark(struct attr_palette *palette, uint32_t idx);
+size_t attr_palette_sweep(struct attr_palette *palette);
+
+void attr_palette_free(struct attr_palette *palette);
@@ -18,6 +18,7 @@
 #include "log.h"
 #include "debug.h"
 #include "macros.h"
+#include "util.h"
 #include "xmalloc.h"
 
 /*
@@ -38,6 +39,88 @@ _Static_assert(
  #error "wchar_t does not use UTF-32"
 #endif
 
+#if defined(FOOT_GRAPHEME_CLUSTERING)
+_Atomic(const int8_t *) c32width_blocks[0x110000 >> C32WIDTH_BLOCK_SHIFT];
+
+const int8_t *
+c32width_populate(char32_t c)
+{
+    const size_t idx = c >> C32WIDTH_BLOCK_SHIFT;
+    const char32_t first = (char32_t)idx << C32WIDTH_BLOCK_SHIFT;
+
+    int8_t *block = xmalloc(C32WIDTH_BLOCK_SIZE);
+    for (size_t i = 0; i < C32WIDTH_BLOCK_SIZE; i++)
+        block[i] = utf8proc_charwidth((utf8proc_int32_t)(first + i));
+
+    /*
+     * Lookups may be done from the render worker threads; if another
+     * thread beat us to it, use its block and throw away ours
+     */
+    const int8_t *expected = NULL;
+    if (!atomic_compare_exchange_strong_explicit(
+            &c32width_blocks[idx], &expected, block,
+            memory_order_acq_rel, memory_order_acquire))
+    {
+        free(block);
+        return expected;
+    }
+
+    return block;
+}
+
+UNITTEST
+{
+    /*
+     * Lazy population. Other constructors may already have looked up
+     * codepoints in this block; start from an unpopulated block.
+     */
+    const char32_t pua = 0x10ff42;
+    const size_t pua_idx = pua >> C32WIDTH_BLOCK_SHIFT;
+
+    free((void *)atomic_exchange(&c32width_blocks[pua_idx], NULL));
+    xassert(c32width(pua) == utf8proc_charwidth((utf8proc_int32_t)pua));
+
+    const int8_t *block = atomic_load(&c32width_blocks[pua_idx]);
+    xassert(block != NULL);
+    xassert(c32width(pua + 1) == utf8proc_charwidth((utf8proc_int32_t)pua + 1));
+    xassert(atomic_load(&c32width_blocks[pua_idx]) == block);
+
+    /*
+     * Compare a sample of codepoints against utf8proc: the edges of
+     * the cache blocks containing some Unicode block boundaries, and
+     * a pseudo-random selection. Don't check *all* codepoints; this
+     * runs on each startup of debug builds.
+     */
+    static const char32_t boundaries[] = {
+        0x0000, 0x007f, 0x00a0, 0x0300, 0x1100, 0x115f, 0x2e80, 0x3000,
+        0x303f, 0xa4d0, 0xac00, 0xd7a3, 0xe000, 0xfe00, 0xff00, 0x1f300,
+        0x1f64f, 0x20000, 0x2fffd, 0x30000, 0xe0000, 0x10ffff,
+    };
+
+    for (size_t i = 0; i < ALEN(boundaries); i++) {
+        const char32_t first =
+            boundaries[i] & ~(char32_t)(C32WIDTH_BLOCK_SIZE - 1);
+        const char32_t last = first + C32WIDTH_BLOCK_SIZE - 1;
+
+        const char32_t samples[] = {boundaries[i], first, first + 1, last - 1, last};
+        for (size_t j = 0; j < ALEN(samples); j++) {
+            const char32_t c = samples[j];
+            xassert(c32width(c) == utf8proc_charwidth((utf8proc_int32_t)c));
+        }
+    }
+
+    uint32_t seed = 1;
+    for (size_t i = 0; i < 256; i++) {
+        seed = seed * 1103515245 + 12345;
+        const char32_t c = (seed >> 8) % 0x110000;
+        xassert(c32width(c) == utf8proc_charwidth((utf8proc_int32_t)c));
+    }
+
+    xassert(c32width(U'a') == 1);
+    xassert(c32width(U'漢') == 2);
+}
+#endif
+
 UNITTEST
 {
     xassert(c32len(U"") == 0);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <uchar.h>
 #include <stddef.h>
 #include <stdarg.h>
@@ -9,9 +10,12 @@
 #include <wctype.h>
 
 #if defined(FOOT_GRAPHEME_CLUSTERING)
+ #include <stdatomic.h>
  #include <utf8proc.h>
 #endif
 
+#include "macros.h"
+
 static inline size_t c32len(const char32_t *s) {
     return wcslen((const wchar_t *)s);
 }
@@ -87,9 +91,33 @@ static inline bool hasc32upper(const char32_t *s) {
     return false;
 }
 
+#if defined(FOOT_GRAPHEME_CLUSTERING)
+/*
+ * utf8proc_charwidth() is an out-of-line library call, doing a
+ * multi-level property lookup. Since it's called for every non-ASCII
+ * character we print, its results are cached in a two-level table,
+ * indexed by codepoint. Blocks are populated, 256 codepoints at a
+ * time, the first time a codepoint in them is looked up.
+ */
+#define C32WIDTH_BLOCK_SHIFT 8
+#define C32WIDTH_BLOCK_SIZE (1u << C32WIDTH_BLOCK_SHIFT)
+
+extern _Atomic(const int8_t *) c32width_blocks[0x110000 >> C32WIDTH_BLOCK_SHIFT];
+const int8_t *c32width_populate(char32_t c);
+#endif
+
 static inline int c32width(char32_t c) {
 #if defined(FOOT_GRAPHEME_CLUSTERING)
-    return utf8proc_charwidth((utf8proc_int32_t)c);
+    if (unlikely(c >= 0x110000))
+        return utf8proc_charwidth((utf8proc_int32_t)c);
+
+    const int8_t *block = atomic_load_explicit(
+        &c32width_blocks[c >> C32WIDTH_BLOCK_SHIFT], memory_order_acquire);
+
+    if (unlikely(block == NULL))
+        block = c32width_populate(c);
+
+    return block[c & (C32WIDTH_BLOCK_SIZE - 1)];
 #else
     return wcwidth((wchar_t)c);
 #endif
@@ -99,7 +127,7 @@ static inline int c32swidth(const char32_t *s, size_t n) {
 #if defined(FOOT_GRAPHEME_CLUSTERING)
     int width = 0;
     for (size_t i = 0; i < n; i++)
-        width += utf8proc_charwidth((utf8proc_int32_t)s[i]);
+        width += c32width(s[i]);
     return width;
 #else
     return wcswidth((const wchar_t *)s, n);
@@ -1,10 +1,20 @@
 #include "composed.h"
 
 #include <stdlib.h>
-#include <stdbool.h>
+#include <string.h>
 
 #include "debug.h"
 #include "terminal.h"
+#include "xmalloc.h"
+
+/* Number of characters in each arena chunk */
+#define COMPOSED_CHUNK_SIZE 4096
+
+struct composed_chunk {
+    struct composed_chunk *next;
+    size_t used;
+    char32_t data[COMPOSED_CHUNK_SIZE];
+};
 
 uint32_t
 composed_key_from_chars(const uint32_t chars[], size_t count)
@@ -51,28 +61,43 @@ UNITTEST
     xassert(k3 == k4);
 }
 
+static inline uint32_t
+slot_index(const struct composed_table *table, uint32_t key)
+{
+    /*
+     * Keys are already hashed, but keys created by collision
+     * avoidance are consecutive; spread them out (Fibonacci hashing)
+     */
+    const unsigned bits = __builtin_ctz(table->size);
+    return (key * 2654435769u) >> (32 - bits);
+}
+
 const struct composed *
-composed_lookup(struct composed *root, uint32_t key)
+composed_lookup(const struct composed_table *table, uint32_t key)
 {
-    struct composed *node = root;
+    if (table->count == 0)
+        return NULL;
 
-    while (node != NULL) {
-        if (key == node->key)
-            return node;
+    const uint32_t mask = table->size - 1;
 
-        node = key < node->key ? node->left : node->right;
-    }
+    for (uint32_t i = slot_index(table, key);; i = (i + 1) & mask) {
+        const struct composed *cc = &table->slots[i];
 
-    return NULL;
+        if (cc->chars == NULL)
+            return NULL;
+        if (cc->key == key)
+            return cc;
+    }
 }
 
 const struct composed *
-composed_lookup_without_collision(struct composed *root, uint32_t *key,
+composed_lookup_without_collision(const struct composed_table *table,
+                                  uint32_t *key,
                                   const char32_t *prefix_text, size_t prefix_len,
                                   char32_t wc, int forced_width)
 {
     while (true) {
-        const struct composed *cc = composed_lookup(root, *key);
+        const struct composed *cc = composed_lookup(table, *key);
         if (cc == NULL)
             return NULL;
 
@@ -101,49 +126,267 @@ composed_lookup_without_collision(struct composed *root, uint32_t *key,
     return NULL;
 }
 
+static struct composed *
+free_slot(struct composed_table *table, uint32_t key)
+{
+    const uint32_t mask = table->size - 1;
+    uint32_t i = slot_index(table, key);
+
+    while (table->slots[i].chars != NULL) {
+        xassert(table->slots[i].key != key);
+        i = (i + 1) & mask;
+    }
+
+    return &table->slots[i];
+}
+
+static void
+resize(struct composed_table *table, uint32_t size)
+{
+    struct composed *old_slots = table->slots;
+    const uint32_t old_size = table->size;
+
+    table->slots = xcalloc(size, sizeof(table->slots[0]));
+    table->size = size;
+
+    for (uint32_t i = 0; i < old_size; i++) {
+        if (old_slots[i].chars != NULL)
+            *free_slot(table, old_slots[i].key) = old_slots[i];
+    }
+
+    free(old_slots);
+}
+
+static char32_t *
+chars_alloc(struct composed_table *table, size_t count)
+{
+    xassert(count <= COMPOSED_CHUNK_SIZE);
+
+    struct composed_chunk *chunk = table->chunks;
+
+    if (chunk == NULL || chunk->used + count > COMPOSED_CHUNK_SIZE) {
+        chunk = xmalloc(sizeof(*chunk));
+        chunk->next = table->chunks;
+        chunk->used = 0;
+        table->chunks = chunk;
+    }
+
+    char32_t *chars = &chunk->data[chunk->used];
+    chunk->used += count;
+    return chars;
+}
+
+const struct composed *
+composed_insert(struct composed_table *table, const struct composed *cc)
+{
+    /* Keep the load factor below 3/4 */
+    if ((table->count + 1) * 4 > table->size * 3)
+        resize(table, table->size == 0 ? 64 : table->size * 2);
+
+    struct composed *slot = free_slot(table, cc->key);
+    *slot = *cc;
+    slot->chars = chars_alloc(table, cc->count);
+    slot->marked = false;
+    memcpy(slot->chars, cc->chars, cc->count * sizeof(slot->chars[0]));
+
+    table->count++;
+    return slot;
+}
+
+/*
+ * Note: the removed entry's characters remain in the arena until the
+ * next composed_sweep()
+ */
+bool
+composed_remove(struct composed_table *table, uint32_t key)
+{
+    if (table->count == 0)
+        return false;
+
+    const uint32_t mask = table->size - 1;
+    uint32_t i = slot_index(table, key);
+
+    while (true) {
+        if (table->slots[i].chars == NULL)
+            return false;
+        if (table->slots[i].key == key)
+            break;
+        i = (i + 1) & mask;
+    }
+
+    /*
+     * Backward shift deletion: move entries following the removed
+     * one back, unless that would move them before their home slot
+     */
+    for (uint32_t j = (i + 1) & mask;
+         table->slots[j].chars != NULL;
+         j = (j + 1) & mask)
+    {
+        const uint32_t home = slot_index(table, table->slots[j].key);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            table->slots[i] = table->slots[j];
+            i = j;
+        }
+    }
+
+    table->slots[i] = (struct composed){0};
+    table->count--;
+    return true;
+}
+
 void
-composed_insert(struct composed **root, struct composed *node)
+composed_mark(struct composed_table *table, uint32_t key)
 {
-    node->left = node->right = NULL;
+    struct composed *cc = (struct composed *)composed_lookup(table, key);
+    if (cc != NULL)
+        cc->marked = true;
+}
 
-    if (*root == NULL) {
-        *root = node;
-        return;
+size_t
+composed_sweep(struct composed_table *table)
+{
+    uint32_t live = 0;
+    for (uint32_t i = 0; i < table->size; i++) {
+        if (table->slots[i].chars != NULL && table->slots[i].marked)
+            live++;
     }
 
-    uint32_t key = node->key;
+    const size_t removed = table->count - live;
 
-    struct composed *prev = NULL;
-    struct composed *n = *root;
+    if (removed == 0) {
+        for (uint32_t i = 0; i < table->size; i++)
+            table->slots[i].marked = false;
+        return 0;
+    }
+
+    /* Re-insert all live entries into a new table (and arena) */
+    struct composed_table new_table = {0};
+
+    if (live > 0) {
+        uint32_t size = 64;
+        while (live * 2 > size)
+            size *= 2;
 
-    while (n != NULL) {
-        xassert(n->key != node->key);
+        resize(&new_table, size);
 
-        prev = n;
-        n = key < n->key ? n->left : n->right;
+        for (uint32_t i = 0; i < table->size; i++) {
+            if (table->slots[i].chars != NULL && table->slots[i].marked)
+                composed_insert(&new_table, &table->slots[i]);
+        }
     }
 
-    xassert(prev != NULL);
-    xassert(n == NULL);
+    xassert(new_table.count == live);
 
-    if (key < prev->key) {
-        xassert(prev->left == NULL);
-        prev->left = node;
-    } else {
-        xassert(prev->right == NULL);
-        prev->right = node;
+    composed_free(table);
+    *table = new_table;
+    return removed;
+}
+
+void
+composed_free(struct composed_table *table)
+{
+    struct composed_chunk *chunk = table->chunks;
+    while (chunk != NULL) {
+        struct composed_chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
     }
+
+    free(table->slots);
+    *table = (struct composed_table){0};
 }
 
 void
-composed_free(struct composed *root)
+composed_snapshot(struct composed_table *snapshot,
+                  const struct composed_table *table)
 {
-    if (root == NULL)
-        return;
+    *snapshot = (struct composed_table){
+        .slots = table->size > 0
+            ? xmemdup(table->slots, table->size * sizeof(table->slots[0]))
+            : NULL,
+        .size = table->size,
+        .count = table->count,
+    };
+}
+
+UNITTEST
+{
+    struct composed_table table = {0};
+    xassert(composed_lookup(&table, 0) == NULL);
+    xassert(!composed_remove(&table, 0));
+
+    /* Colliding keys, as created by composed_lookup_without_collision() */
+    const uint32_t base_key = composed_key_from_key(U'e', 0x301);
+    const size_t count = 1000;
+    xassert(base_key + count <= CELL_COMB_CHARS_HI - CELL_COMB_CHARS_LO);
+
+    for (size_t i = 0; i < count; i++) {
+        char32_t chars[3] = {U'a' + i % 26, 0x301, 0x300 + i};
+
+        uint32_t key = base_key;
+        xassert(composed_lookup_without_collision(
+                    &table, &key, chars, 2, chars[2], 0) == NULL);
+
+        const struct composed *cc = composed_insert(
+            &table, &(struct composed){
+                .chars = chars, .key = key, .count = 3, .width = 1});
+
+        xassert(cc->key == key);
+        xassert(cc->chars != chars);
+        xassert(memcmp(cc->chars, chars, sizeof(chars)) == 0);
+    }
 
-    composed_free(root->left);
-    composed_free(root->right);
+    xassert(table.count == count);
+    xassert(table.size >= count);
+    xassert((table.size & (table.size - 1)) == 0);
+
+    for (size_t i = 0; i < count; i++) {
+        const struct composed *cc = composed_lookup(&table, base_key + i);
+        xassert(cc != NULL);
+        xassert(cc->count == 3);
+        xassert(cc->chars[2] == 0x300 + i);
+    }
+
+    /* Remove every other entry */
+    for (size_t i = 0; i < count; i += 2)
+        xassert(composed_remove(&table, base_key + i));
+    xassert(!composed_remove(&table, base_key));
+
+    xassert(table.count == count / 2);
+    for (size_t i = 0; i < count; i++) {
+        const struct composed *cc = composed_lookup(&table, base_key + i);
+        xassert((cc != NULL) == (i % 2 == 1));
+        xassert(cc == NULL || cc->chars[2] == 0x300 + i);
+    }
+
+    /* Keep every third of the remaining entries */
+    for (size_t i = 1; i < count; i += 6)
+        composed_mark(&table, base_key + i);
+
+    size_t live = (count / 2 + 2) / 3;
+    xassert(composed_sweep(&table) == count / 2 - live);
+    xassert(table.count == live);
+
+    for (size_t i = 0; i < count; i++) {
+        const struct composed *cc = composed_lookup(&table, base_key + i);
+        xassert((cc != NULL) == (i % 6 == 1));
+        xassert(cc == NULL || (!cc->marked && cc->chars[2] == 0x300 + i));
+    }
 
-    free(root->chars);
-    free(root);
+    /* Snapshots are unaffected by removals from the original table */
+    struct composed_table snapshot;
+    composed_snapshot(&snapshot, &table);
+    xassert(composed_remove(&table, base_key + 1));
+    xassert(composed_lookup(&table, base_key + 1) == NULL);
+    live--;
+    xassert(composed_lookup(&snapshot, base_key + 1) != NULL);
+    xassert(composed_lookup(&snapshot, base_key + 7)->key == base_key + 7);
+    composed_free(&snapshot);
+
+    /* Nothing marked - everything goes */
+    xassert(composed_sweep(&table) == live);
+    xassert(table.count == 0);
+    xassert(composed_lookup(&table, base_key + 1) == NULL);
+
+    composed_free(&table);
 }
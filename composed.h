@@ -1,25 +1,66 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <uchar.h>
 
 struct composed {
     char32_t *chars;
-    struct composed *left;
-    struct composed *right;
     uint32_t key;
     uint8_t count;
     uint8_t width;
     uint8_t forced_width;
+    bool marked;    /* Used by composed_sweep() */
+};
+
+struct composed_chunk;
+
+/*
+ * Open addressed (linear probing) hash table of composed characters,
+ * indexed by key. The character payloads are allocated from an arena
+ * owned by the table.
+ *
+ * Pointers returned by composed_lookup() are invalidated by
+ * composed_insert(), composed_remove() and composed_sweep().
+ */
+struct composed_table {
+    struct composed *slots;  /* slot is free if 'chars' is NULL */
+    uint32_t size;           /* Always a power of two (or 0) */
+    uint32_t count;
+    struct composed_chunk *chunks;
 };
 
 uint32_t composed_key_from_chars(const uint32_t chars[], size_t count);
 uint32_t composed_key_from_key(uint32_t prev_key, uint32_t next_char);
 
-const struct composed *composed_lookup(struct composed *root, uint32_t key);
+const struct composed *composed_lookup(
+    const struct composed_table *table, uint32_t key);
 const struct composed *composed_lookup_without_collision(
-    struct composed *root, uint32_t *key,
+    const struct composed_table *table, uint32_t *key,
     const char32_t *prefix, size_t prefix_len, char32_t wc, int forced_width);
-void composed_insert(struct composed **root, struct composed *node);
 
-void composed_free(struct composed *root);
+/* Copies 'cc', and its characters, into the table */
+const struct composed *composed_insert(
+    struct composed_table *table, const struct composed *cc);
+bool composed_remove(struct composed_table *table, uint32_t key);
+
+/*
+ * Mark-and-sweep: composed_sweep() removes all entries that have not
+ * been marked with composed_mark() since the last sweep, compacts the
+ * table, and returns the number of entries removed.
+ */
+void composed_mark(struct composed_table *table, uint32_t key);
+size_t composed_sweep(struct composed_table *table);
+
+/*
+ * Copies the hash table, but not the arena; the snapshot's character
+ * payloads are shared with 'table', and are only valid until 'table'
+ * is swept or free:d. Lookups in the snapshot are unaffected by later
+ * insertions into 'table', and may thus be done from another thread.
+ * Free with composed_free().
+ */
+void composed_snapshot(
+    struct composed_table *snapshot, const struct composed_table *table);
+
+void composed_free(struct composed_table *table);
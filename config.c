@@ -1286,6 +1286,17 @@ parse_section_scrollback(struct context *ctx)
     else if (streq(key, "multiplier"))
         return value_to_float(ctx, &conf->scrollback.multiplier);
 
+    else if (streq(key, "reflow")) {
+        _Static_assert(
+            sizeof(conf->scrollback.reflow) == sizeof(int),
+            "enum is not 32-bit");
+
+        return value_to_enum(
+            ctx,
+            (const char *[]){"background", "lazy", NULL},
+            (int *)&conf->scrollback.reflow);
+    }
+
     else {
         LOG_CONTEXTUAL_ERR("not a valid option: %s", key);
         return false;
@@ -2958,6 +2969,32 @@ parse_section_tweak(struct context *ctx)
     else if (streq(key, "pre-apply-damage"))
         return value_to_bool(ctx, &conf->tweak.preapply_damage);
 
+    else if (streq(key, "scroll-strategy")) {
+        _Static_assert(sizeof(conf->tweak.scroll_strategy) == sizeof(int),
+                       "enum is not 32-bit");
+
+        return value_to_enum(
+            ctx,
+            (const char *[]){"auto", "calibrate", "shm", "memmove", NULL},
+            (int *)&conf->tweak.scroll_strategy);
+    }
+
+    else if (streq(key, "shm-hugepages")) {
+        _Static_assert(sizeof(conf->tweak.shm_hugepages) == sizeof(int),
+                       "enum is not 32-bit");
+
+        return value_to_enum(
+            ctx,
+            (const char *[]){"none", "transparent", "hugetlb", NULL},
+            (int *)&conf->tweak.shm_hugepages);
+    }
+
+    else if (streq(key, "shm-prefault"))
+        return value_to_bool(ctx, &conf->tweak.shm_prefault);
+
+    else if (streq(key, "shm-idle-timeout"))
+        return value_to_uint32(ctx, 10, &conf->tweak.shm_idle_timeout);
+
     else {
         LOG_CONTEXTUAL_ERR("not a valid option: %s", key);
         return false;
@@ -3538,6 +3575,7 @@ config_load(struct config *conf, const char *conf_path,
                 .text = xc32dup(U""),
             },
             .multiplier = 3.,
+            .reflow = SCROLLBACK_REFLOW_BACKGROUND,
         },
         .colors_dark = {
             .fg = default_foreground,
@@ -3624,6 +3662,10 @@ config_load(struct config *conf, const char *conf_path,
             .surface_bit_depth = SHM_BITS_AUTO,
             .min_stride_alignment = 256,
             .preapply_damage = true,
+            .scroll_strategy = SCROLL_STRATEGY_AUTO,
+            .shm_hugepages = SHM_HUGEPAGES_NONE,
+            .shm_prefault = true,
+            .shm_idle_timeout = 60,
         },
 
         .touch = {
@@ -210,6 +210,12 @@ enum shm_bit_depth {
     SHM_BITS_16,
 };
 
+enum shm_hugepages {
+    SHM_HUGEPAGES_NONE,
+    SHM_HUGEPAGES_TRANSPARENT,
+    SHM_HUGEPAGES_HUGETLB,
+};
+
 enum center_when {
     CENTER_INVALID,
     CENTER_NEVER,
@@ -327,6 +333,11 @@ struct config {
             char32_t *text;
         } indicator;
         float multiplier;
+
+        enum {
+            SCROLLBACK_REFLOW_BACKGROUND,
+            SCROLLBACK_REFLOW_LAZY,
+        } reflow;
     } scrollback;
 
     struct {
@@ -460,6 +471,15 @@ struct config {
         enum shm_bit_depth surface_bit_depth;
         uint32_t min_stride_alignment;
         bool preapply_damage;
+        enum {
+            SCROLL_STRATEGY_AUTO,
+            SCROLL_STRATEGY_CALIBRATE,
+            SCROLL_STRATEGY_SHM,
+            SCROLL_STRATEGY_MEMMOVE,
+        } scroll_strategy;
+        enum shm_hugepages shm_hugepages;
+        bool shm_prefault;
+        uint32_t shm_idle_timeout;
     } tweak;
 
     struct {
@@ -805,7 +805,7 @@ csi_dispatch(struct terminal *term, uint8_t final)
 
                 if (term->vt.last_printed >= CELL_COMB_CHARS_LO) {
                     const struct composed *comp = composed_lookup(
-                        term->composed, term->vt.last_printed - CELL_COMB_CHARS_LO);
+                        &term->composed, term->vt.last_printed - CELL_COMB_CHARS_LO);
 
                     xassert(comp != NULL);
                     width = comp->forced_width > 0 ? comp->forced_width : comp->width;
@@ -1101,7 +1101,9 @@ csi_dispatch(struct terminal *term, uint8_t final)
 
             for (size_t c = 0; c < remaining; c++)
                 term->grid->cur_row->cells[term->grid->cursor.point.col + c].attrs.clean = 0;
-            term->grid->cur_row->dirty = true;
+            grid_row_dirty_cols(
+                term->grid->cur_row, term->grid->cursor.point.col,
+                term->cols - 1);
 
             /* Erase the remainder of the line */
             const struct coord *cursor = &term->grid->cursor.point;
@@ -1129,7 +1131,9 @@ csi_dispatch(struct terminal *term, uint8_t final)
                     remaining * sizeof(term->grid->cur_row->cells[0]));
             for (size_t c = 0; c < remaining; c++)
                 term->grid->cur_row->cells[term->grid->cursor.point.col + count + c].attrs.clean = 0;
-            term->grid->cur_row->dirty = true;
+            grid_row_dirty_cols(
+                term->grid->cur_row, term->grid->cursor.point.col,
+                term->cols - 1);
 
             /* Erase (insert space characters) */
             const struct coord *cursor = &term->grid->cursor.point;
@@ -1926,10 +1930,12 @@ csi_dispatch(struct terminal *term, uint8_t final)
 
             for (int r = top; r <= bottom; r++) {
                 struct row *row = grid_row(term->grid, r);
-                row->dirty = true;
+                grid_row_dirty_cols(row, left, right);
 
                 for (int c = left; c <= right; c++) {
-                    struct attributes *a = &row->cells[c].attrs;
+                    struct cell *cell = &row->cells[c];
+                    struct attributes attrs = term_cell_attrs(term, cell);
+                    struct attributes *a = &attrs;
                     a->clean = 0;
 
                     for (size_t i = 4; i < term->vt.params.idx; i++) {
@@ -1955,6 +1961,8 @@ csi_dispatch(struct terminal *term, uint8_t final)
                         case 27: a->reverse = false; break;
                         }
                     }
+
+                    cell->attrs = term_attrs_to_cell(term, a);
                 }
             }
             break;
@@ -1970,10 +1978,12 @@ csi_dispatch(struct terminal *term, uint8_t final)
 
             for (int r = top; r <= bottom; r++) {
                 struct row *row = grid_row(term->grid, r);
-                row->dirty = true;
+                grid_row_dirty_cols(row, left, right);
 
                 for (int c = left; c <= right; c++) {
-                    struct attributes *a = &row->cells[c].attrs;
+                    struct cell *cell = &row->cells[c];
+                    struct attributes attrs = term_cell_attrs(term, cell);
+                    struct attributes *a = &attrs;
                     a->clean = 0;
 
                     for (size_t i = 4; i < term->vt.params.idx; i++) {
@@ -1994,6 +2004,8 @@ csi_dispatch(struct terminal *term, uint8_t final)
                         case 7: a->reverse = !a->reverse; break;
                         }
                     }
+
+                    cell->attrs = term_attrs_to_cell(term, a);
                 }
             }
             break;
@@ -2065,7 +2077,7 @@ csi_dispatch(struct terminal *term, uint8_t final)
             /* Paste into destination area */
             for (int r = 0; r < row_count; r++) {
                 struct row *row = grid_row(term->grid, dst_top + r);
-                row->dirty = true;
+                grid_row_dirty_cols(row, dst_left, dst_left + cell_count - 1);
 
                 struct cell *cell = &row->cells[dst_left];
                 memcpy(cell, copy[r], cell_count * sizeof(copy[r][0]));
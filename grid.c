@@ -1,8 +1,10 @@
 #include "grid.h"
 
 #include <limits.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
 
 #define LOG_MODULE "grid"
 #define LOG_ENABLE_DBG 0
@@ -14,7 +16,10 @@
 #include "util.h"
 #include "xmalloc.h"
 
-#define TIME_REFLOW 0
+/* Overridden by the reflow benchmark (tests/bench-reflow.c) */
+#if !defined(TIME_REFLOW)
+ #define TIME_REFLOW 0
+#endif
 
 #if defined(TIME_REFLOW)
 #include "misc.h"
@@ -270,6 +275,337 @@ range_delete(struct row_ranges *ranges, enum row_range_type type, size_t idx)
     ranges->count--;
 }
 
+/*
+ * Row slab allocator
+ *
+ * Row headers, and cell arrays, are allocated from two pools of fixed
+ * size slots. Each pool carves its slots out of large chunks, and
+ * keeps free slots in per-chunk free lists. This keeps rows allocated
+ * together close in memory, and avoids two malloc()/free() calls
+ * per row.
+ *
+ * Chunks are released as soon as they're empty (except the last one
+ * with free slots, to avoid thrashing), and all at once when the
+ * slab is destroyed.
+ */
+
+#define SLAB_CHUNK_SIZE (64 * 1024)
+#define SLAB_MIN_SLOTS_PER_CHUNK 16
+
+struct slab_chunk;
+
+struct slab_slot {
+    struct slab_chunk *chunk;
+
+    /* Slot payload starts here; only valid while the slot is free */
+    struct slab_slot *next_free;
+};
+
+struct slab_chunk {
+    struct slab_chunk *prev;
+    struct slab_chunk *next;
+    struct slab_slot *free;
+    size_t used;
+    uint8_t slots[];
+};
+
+struct slab_pool {
+    size_t slot_size;
+    size_t slots_per_chunk;
+
+    struct slab_chunk *partial;  /* Chunks with at least one free slot */
+    struct slab_chunk *full;
+};
+
+struct row_slab {
+    int cols;
+    struct slab_pool rows;
+    struct slab_pool cells;
+};
+
+static void
+slab_pool_init(struct slab_pool *pool, size_t payload_size)
+{
+    const size_t payload_offset = offsetof(struct slab_slot, next_free);
+    const size_t align = _Alignof(struct slab_slot);
+
+    payload_size = max(payload_size, sizeof(struct slab_slot *));
+
+    *pool = (struct slab_pool){
+        .slot_size = (payload_offset + payload_size + align - 1) & ~(align - 1),
+    };
+
+    pool->slots_per_chunk = max(
+        SLAB_MIN_SLOTS_PER_CHUNK, SLAB_CHUNK_SIZE / pool->slot_size);
+}
+
+static void
+slab_chunk_link(struct slab_chunk **list, struct slab_chunk *chunk)
+{
+    chunk->prev = NULL;
+    chunk->next = *list;
+    if (*list != NULL)
+        (*list)->prev = chunk;
+    *list = chunk;
+}
+
+static void
+slab_chunk_unlink(struct slab_chunk **list, struct slab_chunk *chunk)
+{
+    if (chunk->prev != NULL)
+        chunk->prev->next = chunk->next;
+    else
+        *list = chunk->next;
+
+    if (chunk->next != NULL)
+        chunk->next->prev = chunk->prev;
+}
+
+static void *
+slab_pool_alloc(struct slab_pool *pool)
+{
+    struct slab_chunk *chunk = pool->partial;
+
+    if (unlikely(chunk == NULL)) {
+        chunk = xmalloc(sizeof(*chunk) + pool->slots_per_chunk * pool->slot_size);
+        chunk->used = 0;
+        chunk->free = NULL;
+
+        for (size_t i = pool->slots_per_chunk; i > 0; i--) {
+            struct slab_slot *slot =
+                (struct slab_slot *)&chunk->slots[(i - 1) * pool->slot_size];
+            slot->chunk = chunk;
+            slot->next_free = chunk->free;
+            chunk->free = slot;
+        }
+
+        slab_chunk_link(&pool->partial, chunk);
+    }
+
+    struct slab_slot *slot = chunk->free;
+    chunk->free = slot->next_free;
+    chunk->used++;
+
+    if (chunk->free == NULL) {
+        slab_chunk_unlink(&pool->partial, chunk);
+        slab_chunk_link(&pool->full, chunk);
+    }
+
+    return &slot->next_free;
+}
+
+static void
+slab_pool_free(struct slab_pool *pool, void *ptr)
+{
+    struct slab_slot *slot = (struct slab_slot *)(
+        (uint8_t *)ptr - offsetof(struct slab_slot, next_free));
+    struct slab_chunk *chunk = slot->chunk;
+
+    xassert(chunk->used > 0);
+
+    if (chunk->free == NULL) {
+        slab_chunk_unlink(&pool->full, chunk);
+        slab_chunk_link(&pool->partial, chunk);
+    }
+
+    slot->next_free = chunk->free;
+    chunk->free = slot;
+    chunk->used--;
+
+    if (chunk->used == 0 && (chunk->prev != NULL || chunk->next != NULL)) {
+        slab_chunk_unlink(&pool->partial, chunk);
+        free(chunk);
+    }
+}
+
+static void
+slab_pool_destroy(struct slab_pool *pool)
+{
+    struct slab_chunk *lists[] = {pool->partial, pool->full};
+
+    for (size_t i = 0; i < ALEN(lists); i++) {
+        for (struct slab_chunk *chunk = lists[i], *next; chunk != NULL; chunk = next) {
+            next = chunk->next;
+            free(chunk);
+        }
+    }
+
+    pool->partial = pool->full = NULL;
+}
+
+struct row_slab *
+grid_row_slab_new(int cols)
+{
+    struct row_slab *slab = xmalloc(sizeof(*slab));
+    slab->cols = cols;
+    slab_pool_init(&slab->rows, sizeof(struct row));
+    slab_pool_init(&slab->cells, cols * sizeof(struct cell));
+    return slab;
+}
+
+void
+grid_row_slab_destroy(struct row_slab *slab)
+{
+    if (slab == NULL)
+        return;
+
+    slab_pool_destroy(&slab->rows);
+    slab_pool_destroy(&slab->cells);
+    free(slab);
+}
+
+static struct cell *
+row_cells_alloc(struct row_slab *slab, int cols)
+{
+    if (slab == NULL)
+        return xmalloc(cols * sizeof(struct cell));
+
+    xassert(slab->cols == cols);
+    return slab_pool_alloc(&slab->cells);
+}
+
+static void
+row_cells_free(struct row_slab *slab, struct cell *cells)
+{
+    if (cells == NULL)
+        return;
+
+    if (slab == NULL)
+        free(cells);
+    else
+        slab_pool_free(&slab->cells, cells);
+}
+
+static struct row *
+row_header_alloc(struct row_slab *slab)
+{
+    struct row *row = slab != NULL
+        ? slab_pool_alloc(&slab->rows)
+        : xmalloc(sizeof(*row));
+
+    row->slab = slab;
+    return row;
+}
+
+struct row *
+grid_row_alloc(struct row_slab *slab, int cols, bool initialize)
+{
+    struct row *row = row_header_alloc(slab);
+    row->dirty = false;
+    row->linebreak = true;
+    row->extra = NULL;
+    row->packed = NULL;
+    row->packed_size = 0;
+    row->shell_integration.prompt_marker = false;
+    row->shell_integration.cmd_start = -1;
+    row->shell_integration.cmd_end = -1;
+
+    row->cells = row_cells_alloc(slab, cols);
+
+    if (initialize) {
+        memset(row->cells, 0, cols * sizeof(row->cells[0]));
+        for (size_t c = 0; c < cols; c++)
+            row->cells[c].attrs.clean = 1;
+    }
+
+    return row;
+}
+
+/* Frees everything owned by the row, except its slab slots */
+static void
+row_free_data(struct row *row)
+{
+    grid_row_reset_extra(row);
+    free(row->extra);
+    free(row->packed);
+}
+
+void
+grid_row_free(struct row *row)
+{
+    if (row == NULL)
+        return;
+
+    row_free_data(row);
+    row_cells_free(row->slab, row->cells);
+
+    if (row->slab != NULL)
+        slab_pool_free(&row->slab->rows, row);
+    else
+        free(row);
+}
+
+/*
+ * Frees all rows, and then the slab. Rows allocated from the slab
+ * aren't returned to it individually; the slab is released in one go.
+ */
+static void
+rows_free_with_slab(struct row **rows, int count, struct row_slab *slab)
+{
+    for (int r = 0; r < count; r++) {
+        struct row *row = rows[r];
+
+        if (row == NULL)
+            continue;
+
+        if (slab != NULL && row->slab == slab)
+            row_free_data(row);
+        else
+            grid_row_free(row);
+    }
+
+    grid_row_slab_destroy(slab);
+}
+
+UNITTEST
+{
+    const int cols = 80;
+    struct row_slab *slab = grid_row_slab_new(cols);
+
+    const size_t count = 4 * slab->cells.slots_per_chunk + 1;
+    struct row **rows = xcalloc(count, sizeof(rows[0]));
+
+    for (size_t i = 0; i < count; i++) {
+        rows[i] = grid_row_alloc(slab, cols, i & 1);
+        xassert(rows[i]->slab == slab);
+        xassert(rows[i]->cells != NULL);
+
+        /* Write all cells; would trample neighbouring slots on overlap */
+        for (int c = 0; c < cols; c++)
+            rows[i]->cells[c] = (struct cell){.wc = i};
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        for (int c = 0; c < cols; c++)
+            xassert(rows[i]->cells[c].wc == i);
+    }
+
+    /* Free everything but the last row; only its chunk remains */
+    for (size_t i = 0; i < count - 1; i++) {
+        grid_row_free(rows[i]);
+        rows[i] = NULL;
+    }
+
+    xassert(slab->cells.full == NULL);
+    xassert(slab->cells.partial != NULL);
+    xassert(slab->cells.partial->next == NULL);
+    xassert(slab->cells.partial->used == 1);
+    xassert(slab->rows.partial != NULL);
+    xassert(slab->rows.partial->next == NULL);
+    xassert(slab->rows.partial->used == 1);
+
+    /* Freed slots are re-used */
+    struct row *row = grid_row_alloc(slab, cols, true);
+    xassert(slab->cells.partial->next == NULL);
+    xassert(slab->cells.partial->used == 2);
+    for (int c = 0; c < cols; c++)
+        xassert(row->cells[c].wc == 0 && row->cells[c].attrs.clean);
+
+    rows[0] = row;
+    rows_free_with_slab(rows, count, slab);
+    free(rows);
+}
+
 struct grid *
 grid_snapshot(const struct grid *grid)
 {
@@ -282,6 +618,9 @@ grid_snapshot(const struct grid *grid)
     clone->saved_cursor = grid->saved_cursor;
     clone->kitty_kbd = grid->kitty_kbd;
     clone->rows = xcalloc(grid->num_rows, sizeof(clone->rows[0]));
+    clone->slab = grid_row_slab_new(grid->num_cols);
+    clone->packed_bytes = grid->packed_bytes;
+    clone->unpacked_bytes = grid->unpacked_bytes;
     memset(&clone->scroll_damage, 0, sizeof(clone->scroll_damage));
     memset(&clone->sixel_images, 0, sizeof(clone->sixel_images));
 
@@ -294,16 +633,27 @@ grid_snapshot(const struct grid *grid)
         if (row == NULL)
             continue;
 
-        struct row *clone_row = xmalloc(sizeof(*row));
+        struct row *clone_row = row_header_alloc(clone->slab);
         clone->rows[r] = clone_row;
 
-        clone_row->cells = xmalloc(grid->num_cols * sizeof(clone_row->cells[0]));
         clone_row->linebreak = row->linebreak;
         clone_row->dirty = row->dirty;
+        clone_row->dirty_start = row->dirty_start;
+        clone_row->dirty_end = row->dirty_end;
         clone_row->shell_integration = row->shell_integration;
 
-        for (int c = 0; c < grid->num_cols; c++)
-            clone_row->cells[c] = row->cells[c];
+        if (row->cells == NULL) {
+            clone_row->cells = NULL;
+            clone_row->packed = xmemdup(row->packed, row->packed_size);
+            clone_row->packed_size = row->packed_size;
+        } else {
+            clone_row->cells = row_cells_alloc(clone->slab, grid->num_cols);
+            clone_row->packed = NULL;
+            clone_row->packed_size = 0;
+
+            for (int c = 0; c < grid->num_cols; c++)
+                clone_row->cells[c] = row->cells[c];
+        }
 
         const struct row_data *extra = row->extra;
 
@@ -406,8 +756,8 @@ grid_free(struct grid *grid)
     if (grid == NULL)
         return;
 
-    for (int r = 0; r < grid->num_rows; r++)
-        grid_row_free(grid->rows[r]);
+    rows_free_with_slab(grid->rows, grid->num_rows, grid->slab);
+    grid->slab = NULL;
 
     tll_foreach(grid->sixel_images, it) {
         sixel_destroy(&it->item);
@@ -434,37 +784,296 @@ grid_swap_row(struct grid *grid, int row_a, int row_b)
     grid->rows[real_b] = a;
 }
 
-struct row *
-grid_row_alloc(int cols, bool initialize)
+/*
+ * Packed rows
+ *
+ * Rows that have scrolled far enough into the scrollback are unlikely
+ * to ever be looked at again, and are stored in a compact form. The
+ * cells are split into runs of identical attributes, each encoded as:
+ *
+ *   varint   number of cells in the run
+ *   8 bytes  attributes (with 'clean' cleared)
+ *
+ * followed by the run's characters, with repeated characters
+ * collapsed:
+ *
+ *   varint   wc + 1
+ *   varint   0, followed by a varint 'n': previous character
+ *            repeated 'n' more times
+ *
+ * Packed rows are unpacked on demand, by grid_row_in_view(),
+ * grid_row_unpacked() etc.
+ */
+
+static size_t
+varint_put(uint8_t *p, uint64_t value)
 {
-    struct row *row = xmalloc(sizeof(*row));
-    row->dirty = false;
-    row->linebreak = true;
-    row->extra = NULL;
-    row->shell_integration.prompt_marker = false;
-    row->shell_integration.cmd_start = -1;
-    row->shell_integration.cmd_end = -1;
+    size_t len = 0;
+    while (value >= 0x80) {
+        p[len++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    p[len++] = value;
+    return len;
+}
 
-    if (initialize) {
-        row->cells = xcalloc(cols, sizeof(row->cells[0]));
-        for (size_t c = 0; c < cols; c++)
-            row->cells[c].attrs.clean = 1;
-    } else
-        row->cells = xmalloc(cols * sizeof(row->cells[0]));
+static uint64_t
+varint_get(const uint8_t **p)
+{
+    uint64_t value = 0;
+    unsigned shift = 0;
+    uint8_t byte;
 
-    return row;
+    do {
+        byte = *(*p)++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    return value;
+}
+
+/* Attributes as a single integer, with 'clean' masked out */
+static inline uint64_t
+attrs_bits(const cell_attrs_t *attrs)
+{
+    static const union {
+        cell_attrs_t attrs;
+        uint64_t bits;
+    } clean = {.attrs = {.clean = true}};
+
+    uint64_t bits = 0;
+    memcpy(&bits, attrs, sizeof(*attrs));
+    return bits & ~clean.bits;
+}
+
+bool
+grid_row_pack(struct grid *grid, struct row *row)
+{
+    xassert(row->cells != NULL);
+
+    const int cols = grid->num_cols;
+    const size_t unpacked_size = cols * sizeof(row->cells[0]);
+
+    /* Worst case: one run, and one non-repeated character, per cell */
+    uint8_t *const packed = xmalloc(cols * (5 + sizeof(cell_attrs_t) + 5));
+    uint8_t *p = packed;
+
+    for (int c = 0; c < cols;) {
+        const uint64_t attrs = attrs_bits(&row->cells[c].attrs);
+
+        int run_end = c + 1;
+        while (run_end < cols && attrs_bits(&row->cells[run_end].attrs) == attrs)
+            run_end++;
+
+        p += varint_put(p, run_end - c);
+        memcpy(p, &attrs, sizeof(cell_attrs_t));
+        p += sizeof(cell_attrs_t);
+
+        while (c < run_end) {
+            const char32_t wc = row->cells[c].wc;
+
+            int repeat = 1;
+            while (c + repeat < run_end && row->cells[c + repeat].wc == wc)
+                repeat++;
+
+            p += varint_put(p, (uint64_t)wc + 1);
+
+            if (repeat > 2) {
+                *p++ = 0;
+                p += varint_put(p, repeat - 1);
+            } else if (repeat == 2)
+                p += varint_put(p, (uint64_t)wc + 1);
+
+            c += repeat;
+        }
+    }
+
+    const size_t packed_size = p - packed;
+
+    if (packed_size >= unpacked_size) {
+        free(packed);
+        return false;
+    }
+
+    row->packed = xrealloc(packed, packed_size);
+    row->packed_size = packed_size;
+    row_cells_free(row->slab, row->cells);
+    row->cells = NULL;
+
+    grid->packed_bytes += packed_size;
+    grid->unpacked_bytes += unpacked_size;
+    return true;
 }
 
 void
-grid_row_free(struct row *row)
+grid_row_unpack_to(const struct grid *grid, const struct row *row,
+                   struct cell *cells)
 {
-    if (row == NULL)
-        return;
+    xassert(row->cells == NULL);
 
-    grid_row_reset_extra(row);
-    free(row->extra);
-    free(row->cells);
-    free(row);
+    const int cols = grid->num_cols;
+    const uint8_t *p = row->packed;
+
+    for (int c = 0; c < cols;) {
+        const int run_end = c + varint_get(&p);
+
+        cell_attrs_t attrs;
+        memcpy(&attrs, p, sizeof(attrs));
+        p += sizeof(attrs);
+
+        xassert(run_end <= cols);
+
+        char32_t wc = 0;
+
+        while (c < run_end) {
+            const uint64_t value = varint_get(&p);
+
+            if (value == 0) {
+                /* Repeat previous character */
+                const int repeat = varint_get(&p);
+                for (int i = 0; i < repeat; i++, c++)
+                    cells[c] = (struct cell){.wc = wc, .attrs = attrs};
+            } else {
+                wc = value - 1;
+                cells[c++] = (struct cell){.wc = wc, .attrs = attrs};
+            }
+        }
+    }
+
+    xassert(p == row->packed + row->packed_size);
+}
+
+void
+grid_row_unpack(struct grid *grid, struct row *row)
+{
+    struct cell *cells = row_cells_alloc(row->slab, grid->num_cols);
+    grid_row_unpack_to(grid, row, cells);
+
+    grid->packed_bytes -= row->packed_size;
+    grid->unpacked_bytes -= grid->num_cols * sizeof(cells[0]);
+
+    free(row->packed);
+    row->packed = NULL;
+    row->packed_size = 0;
+    row->cells = cells;
+
+    /* Cells are not 'clean' */
+    grid_row_dirty(row);
+}
+
+void
+grid_row_discard_packed(struct grid *grid, struct row *row)
+{
+    xassert(row->cells == NULL);
+
+    grid->packed_bytes -= row->packed_size;
+    grid->unpacked_bytes -= grid->num_cols * sizeof(row->cells[0]);
+
+    free(row->packed);
+    row->packed = NULL;
+    row->packed_size = 0;
+    row->cells = row_cells_alloc(row->slab, grid->num_cols);
+    grid_row_dirty(row);
+}
+
+void
+grid_free_rows(struct grid *grid, int start, int end)
+{
+    for (int i = start; i < end; i++) {
+        struct row *row = grid->rows[i];
+        if (row == NULL)
+            continue;
+
+        if (row->cells == NULL)
+            grid_row_discard_packed(grid, row);
+
+        grid_row_free(row);
+        grid->rows[i] = NULL;
+    }
+}
+
+void
+grid_pack_cold_rows(struct grid *grid, int screen_rows, int count)
+{
+    const int distance = GRID_PACK_DISTANCE_SCREENS * screen_rows;
+    const int mask = grid->num_rows - 1;
+
+    /* Never pack rows on the screen, or in the view */
+    count = min(count, grid->num_rows - screen_rows - distance);
+
+    for (int i = 1; i <= count; i++) {
+        const int idx = (grid->offset - distance - i) & mask;
+        struct row *row = grid->rows[idx];
+
+        if (row == NULL || row->cells == NULL)
+            continue;
+
+        if (((idx - grid->view) & mask) < screen_rows)
+            continue;
+
+        grid_row_pack(grid, row);
+    }
+}
+
+/* Distinct, non-default, cell attributes */
+static cell_attrs_t UNUSED
+unittest_attrs(uint16_t n)
+{
+#if defined(FOOT_COMPACT_CELLS)
+    return (cell_attrs_t){.idx = n + 1};
+#else
+    return (cell_attrs_t){.fg = n, .bg = n, .fg_src = COLOR_RGB};
+#endif
+}
+
+UNITTEST
+{
+    const int cols = 80;
+    struct grid grid = {.num_rows = 1, .num_cols = cols};
+
+    struct row *row = grid_row_alloc(NULL, cols, true);
+    const cell_attrs_t bold = unittest_attrs(0xff);
+
+    for (int c = 0; c < 20; c++)
+        row->cells[c] = (struct cell){.wc = U'a' + c, .attrs = {.clean = c & 1}};
+    for (int c = 20; c < 30; c++)
+        row->cells[c] = (struct cell){.wc = U'-', .attrs = bold};
+    row->cells[30] = (struct cell){.wc = U'漢', .attrs = bold};
+    row->cells[31] = (struct cell){.wc = CELL_SPACER + 1, .attrs = bold};
+    row->cells[32] = (struct cell){.wc = CELL_COMB_CHARS_HI};
+
+    struct cell expected[cols];
+    memcpy(expected, row->cells, sizeof(expected));
+    for (int c = 0; c < cols; c++)
+        expected[c].attrs.clean = false;
+
+    xassert(grid_row_pack(&grid, row));
+    xassert(row->cells == NULL);
+    xassert(row->packed_size < cols * sizeof(struct cell) / 2);
+    xassert(grid.packed_bytes == row->packed_size);
+    xassert(grid.unpacked_bytes == cols * sizeof(struct cell));
+
+    grid_row_unpack(&grid, row);
+    xassert(row->cells != NULL);
+    xassert(row->packed == NULL);
+    xassert(row->dirty);
+    xassert(memcmp(row->cells, expected, sizeof(expected)) == 0);
+    xassert(grid.packed_bytes == 0);
+    xassert(grid.unpacked_bytes == 0);
+
+    /* Incompressible rows are left as-is */
+    for (int c = 0; c < cols; c++) {
+        row->cells[c] = (struct cell){
+            .wc = 0x10000 + c * 0x100,
+            .attrs = unittest_attrs(c)};
+    }
+
+    xassert(!grid_row_pack(&grid, row));
+    xassert(row->cells != NULL);
+    xassert(grid.packed_bytes == 0);
+
+    grid_row_free(row);
 }
 
 void
@@ -472,11 +1081,11 @@ grid_resize_without_reflow(
     struct grid *grid, int new_rows, int new_cols,
     int old_screen_rows, int new_screen_rows)
 {
-    struct row *const *old_grid = grid->rows;
     const int old_rows = grid->num_rows;
     const int old_cols = grid->num_cols;
 
     struct row **new_grid = xcalloc(new_rows, sizeof(new_grid[0]));
+    struct row_slab *new_slab = grid_row_slab_new(new_cols);
 
     tll(struct sixel) untranslated_sixels = tll_init();
     tll_foreach(grid->sixel_images, it)
@@ -490,17 +1099,18 @@ grid_resize_without_reflow(
         const int old_row_idx = (grid->offset + r) & (old_rows - 1);
         const int new_row_idx = (new_offset + r) & (new_rows - 1);
 
-        const struct row *old_row = old_grid[old_row_idx];
+        const struct row *old_row = grid_row_unpacked(grid, old_row_idx);
         xassert(old_row != NULL);
 
-        struct row *new_row = grid_row_alloc(new_cols, false);
+        struct row *new_row = grid_row_alloc(new_slab, new_cols, false);
         new_grid[new_row_idx] = new_row;
 
         memcpy(new_row->cells,
                old_row->cells,
                sizeof(struct cell) * min(old_cols, new_cols));
 
-        new_row->dirty = old_row->dirty;
+        if (old_row->dirty)
+            grid_row_dirty(new_row);
         new_row->shell_integration.prompt_marker = old_row->shell_integration.prompt_marker;
         new_row->shell_integration.cmd_start = min(old_row->shell_integration.cmd_start, new_cols - 1);
         new_row->shell_integration.cmd_end = min(old_row->shell_integration.cmd_end, new_cols - 1);
@@ -509,7 +1119,7 @@ grid_resize_without_reflow(
             /* Clear "new" columns */
             memset(&new_row->cells[old_cols], 0,
                    sizeof(struct cell) * (new_cols - old_cols));
-            new_row->dirty = true;
+            grid_row_dirty(new_row);
         } else if (old_cols > new_cols) {
             /* Make sure we don't cut a multi-column character in two */
             for (int i = new_cols; i > 0 && old_row->cells[i].wc > CELL_SPACER; i--)
@@ -571,11 +1181,11 @@ grid_resize_without_reflow(
 
     /* Clear "new" lines */
     for (int r = min(old_screen_rows, new_screen_rows); r < new_screen_rows; r++) {
-        struct row *new_row = grid_row_alloc(new_cols, false);
+        struct row *new_row = grid_row_alloc(new_slab, new_cols, false);
         new_grid[(new_offset + r) & (new_rows - 1)] = new_row;
 
         memset(new_row->cells, 0, sizeof(struct cell) * new_cols);
-        new_row->dirty = true;
+        grid_row_dirty(new_row);
     }
 
 #if defined(_DEBUG)
@@ -593,13 +1203,14 @@ grid_resize_without_reflow(
 #endif
 
     /* Free old grid */
-    for (int r = 0; r < grid->num_rows; r++)
-        grid_row_free(old_grid[r]);
+    rows_free_with_slab(grid->rows, grid->num_rows, grid->slab);
     free(grid->rows);
 
     grid->rows = new_grid;
+    grid->slab = new_slab;
     grid->num_rows = new_rows;
     grid->num_cols = new_cols;
+    grid->packed_bytes = grid->unpacked_bytes = 0;
 
     grid->view = grid->offset = new_offset;
 
@@ -696,8 +1307,9 @@ reflow_range_end(struct row_range *range, enum row_range_type type,
 }
 
 static struct row *
-_line_wrap(struct grid *old_grid, struct row **new_grid, struct row *row,
-           int *row_idx, int *col_idx, int row_count, int col_count)
+_line_wrap(struct grid *old_grid, struct row **new_grid, struct row_slab *slab,
+           struct row *row, int *row_idx, int *col_idx, int row_count,
+           int col_count)
 {
     *col_idx = 0;
     *row_idx = (*row_idx + 1) & (row_count - 1);
@@ -706,7 +1318,7 @@ _line_wrap(struct grid *old_grid, struct row **new_grid, struct row *row,
 
     if (new_row == NULL) {
         /* Scrollback not yet full, allocate a completely new row */
-        new_row = grid_row_alloc(col_count, false);
+        new_row = grid_row_alloc(slab, col_count, false);
         new_grid[*row_idx] = new_row;
     } else {
         /* Scrollback is full, need to reuse a row */
@@ -774,7 +1386,7 @@ _line_wrap(struct grid *old_grid, struct row **new_grid, struct row *row,
     return new_row;
 }
 
-static struct {
+static thread_local struct {
     int scrollback_start;
     int rows;
 } tp_cmp_ctx;
@@ -812,12 +1424,12 @@ tp_cmp(const void *_a, const void *_b)
     return 0;
 }
 
-void
-grid_resize_and_reflow(
-    struct grid *grid, const struct terminal *term, int new_rows, int new_cols,
-    int old_screen_rows, int new_screen_rows,
-    size_t tracking_points_count,
-    struct coord *const _tracking_points[static tracking_points_count])
+static void
+reflow(struct grid *grid, bool shared_rows,
+       const struct composed_table *composed,
+       int new_rows, int new_cols, int old_screen_rows, int new_screen_rows,
+       size_t tracking_points_count,
+       struct coord *const _tracking_points[static tracking_points_count])
 {
 #if defined(TIME_REFLOW) && TIME_REFLOW
     struct timespec start;
@@ -835,10 +1447,12 @@ grid_resize_and_reflow(
     int new_row_idx = 0;
 
     struct row **new_grid = xcalloc(new_rows, sizeof(new_grid[0]));
+    struct row_slab *new_slab = grid_row_slab_new(new_cols);
     struct row *new_row = new_grid[new_row_idx];
+    struct cell *unpacked = xmalloc(old_cols * sizeof(unpacked[0]));
 
     xassert(new_row == NULL);
-    new_row = grid_row_alloc(new_cols, false);
+    new_row = grid_row_alloc(new_slab, new_cols, false);
     new_grid[new_row_idx] = new_row;
 
     /* Start at the beginning of the old grid's scrollback. That is,
@@ -867,7 +1481,8 @@ grid_resize_and_reflow(
         1;                        /* terminator */
 
     struct coord *tracking_points[tp_count];
-    memcpy(tracking_points, _tracking_points, tracking_points_count * sizeof(_tracking_points[0]));
+    if (tracking_points_count > 0)
+        memcpy(tracking_points, _tracking_points, tracking_points_count * sizeof(_tracking_points[0]));
     tracking_points[tracking_points_count] = &cursor;
     tracking_points[tracking_points_count + 1] = &saved_cursor;
 
@@ -875,7 +1490,6 @@ grid_resize_and_reflow(
     if (!view_follows)
         tracking_points[tracking_points_count + 2] = &viewport;
 
-    /* Not thread safe! */
     tp_cmp_ctx.scrollback_start = offset;
     tp_cmp_ctx.rows = old_rows;
     qsort(
@@ -906,6 +1520,18 @@ grid_resize_and_reflow(
         if (old_row == NULL)
             continue;
 
+        /*
+         * Packed rows are unpacked to a scratch buffer, rather than
+         * in-place, since the row is free:d when we're done with it
+         * anyway (and since unpacking in-place would allocate from
+         * the row's slab, which may be shared with other threads).
+         */
+        const struct cell *old_cells = old_row->cells;
+        if (old_cells == NULL) {
+            grid_row_unpack_to(grid, old_row, unpacked);
+            old_cells = unpacked;
+        }
+
         /* Map sixels on current "old" row to current "new row" */
         tll_foreach(untranslated_sixels, it) {
             if (it->item.pos.row != old_row_idx)
@@ -920,13 +1546,13 @@ grid_resize_and_reflow(
 
 #define line_wrap()                                                 \
         new_row = _line_wrap(                                       \
-            grid, new_grid, new_row, &new_row_idx, &new_col_idx,    \
-            new_rows, new_cols)
+            grid, new_grid, new_slab, new_row, &new_row_idx,        \
+            &new_col_idx, new_rows, new_cols)
 
         /* Find last non-empty cell */
         int col_count = 0;
         for (int c = old_cols - 1; c >= 0; c--) {
-            const struct cell *cell = &old_row->cells[c];
+            const struct cell *cell = &old_cells[c];
             if (!(cell->wc == 0 || cell->wc == CELL_SPACER)) {
                 col_count = c + 1;
                 break;
@@ -935,7 +1561,7 @@ grid_resize_and_reflow(
 
         if (!old_row->linebreak && col_count > 0) {
             /* Don't truncate logical lines */
-            while (col_count < old_cols && old_row->cells[col_count].wc == 0)
+            while (col_count < old_cols && old_cells[col_count].wc == 0)
                 col_count++;
         }
 
@@ -997,7 +1623,7 @@ grid_resize_and_reflow(
         }
 
         for (int c = 0; c < col_count;) {
-            const struct cell *old = &old_row->cells[c];
+            const struct cell *old = &old_cells[c];
 
             /* Row full, emit newline and get a new, fresh, row */
             xassert(new_col_idx <= new_cols);
@@ -1008,23 +1634,30 @@ grid_resize_and_reflow(
             int width = 1;
 
             if (unlikely(wc >= CELL_COMB_CHARS_LO && wc <= CELL_COMB_CHARS_HI)) {
-                const struct composed *composed =
-                    composed_lookup(term->composed, wc - CELL_COMB_CHARS_LO);
+                const struct composed *cc =
+                    composed_lookup(composed, wc - CELL_COMB_CHARS_LO);
 
-                width = composed->forced_width > 0 ? composed->forced_width : composed->width;
+                width = cc->forced_width > 0 ? cc->forced_width : cc->width;
             } else if (unlikely(c + 1 < col_count && (old + 1)->wc >= CELL_SPACER + 1)) {
                 /* Wide character, get its width from the next cell's
                    SPACER value */
                 width = (old + 1)->wc - CELL_SPACER + 1;
             }
 
+            /*
+             * A grapheme cluster may have grown wide after it was
+             * printed in the last column; there are no spacers to
+             * copy, and we must not read past the end of the old row
+             */
+            width = min(width, old_cols - c);
+
             /*
              * Check if character fits, if not, emit spacers, and push
                the character to the next row */
             if (unlikely(new_col_idx + width > new_cols && width <= new_cols)) {
                 for (; new_col_idx < new_cols; new_col_idx++) {
                     new_row->cells[new_col_idx].wc = CELL_SPACER;
-                    new_row->cells[new_col_idx].attrs = (struct attributes){0};
+                    new_row->cells[new_col_idx].attrs = (cell_attrs_t){0};
                 }
                 line_wrap();
             }
@@ -1089,7 +1722,7 @@ grid_resize_and_reflow(
                 if (unlikely(width > new_cols)) {
                     /* Wide character no longer fits on a row, replace
                        it with a single space */
-                    new_row->cells[new_col_idx++].wc = 0;
+                    new_row->cells[new_col_idx++] = (struct cell){.attrs = old->attrs};
                     c++;
 
                     /* Walk past the SPACER cells */
@@ -1158,7 +1791,23 @@ grid_resize_and_reflow(
             }
         }
 
-        grid_row_free(old_grid[old_row_idx]);
+        if (old_row->cells == NULL) {
+            grid->packed_bytes -= old_row->packed_size;
+            grid->unpacked_bytes -= old_cols * sizeof(old_row->cells[0]);
+        }
+
+        /*
+         * Rows allocated from our own slab are released along with
+         * it, below. Slabs are not thread safe; rows from a slab
+         * shared with other threads are released when its owner
+         * destroys it.
+         */
+        if (old_row->slab != NULL &&
+            (old_row->slab == grid->slab || shared_rows))
+        {
+            row_free_data(old_grid[old_row_idx]);
+        } else
+            grid_row_free(old_grid[old_row_idx]);
         grid->rows[old_row_idx] = NULL;
 
 #undef line_wrap
@@ -1210,13 +1859,16 @@ grid_resize_and_reflow(
     for (int r = 0; r < new_screen_rows; r++) {
         int idx = (grid->offset + r) & (new_rows - 1);
         if (new_grid[idx] == NULL)
-            new_grid[idx] = grid_row_alloc(new_cols, true);
+            new_grid[idx] = grid_row_alloc(new_slab, new_cols, true);
     }
 
     /* Free old grid (rows already free:d) */
+    free(unpacked);
     free(grid->rows);
+    grid_row_slab_destroy(grid->slab);
 
     grid->rows = new_grid;
+    grid->slab = new_slab;
     grid->num_rows = new_rows;
     grid->num_cols = new_cols;
 
@@ -1264,6 +1916,11 @@ grid_resize_and_reflow(
     grid->cursor.point = cursor;
     grid->saved_cursor.point = saved_cursor;
 
+    /* All rows were unpacked by the reflow; re-pack the cold ones */
+    xassert(grid->packed_bytes == 0);
+    xassert(grid->unpacked_bytes == 0);
+    grid_pack_cold_rows(grid, new_screen_rows, new_rows);
+
     /* Free sixels we failed to "map" to the new grid */
     tll_foreach(untranslated_sixels, it)
         sixel_destroy(&it->item);
@@ -1282,6 +1939,635 @@ grid_resize_and_reflow(
 #endif
 }
 
+void
+grid_resize_and_reflow(
+    struct grid *grid, const struct composed_table *composed,
+    int new_rows, int new_cols, int old_screen_rows, int new_screen_rows,
+    size_t tracking_points_count,
+    struct coord *const _tracking_points[static tracking_points_count])
+{
+    reflow(grid, false, composed, new_rows, new_cols,
+           old_screen_rows, new_screen_rows,
+           tracking_points_count, _tracking_points);
+}
+
+UNITTEST
+{
+    /* Packed scrollback rows freed (like term_reset() does), then reflowed */
+    const int cols = 4;
+    const int screen_rows = 4;
+    const int num_rows = 16;
+
+    struct grid grid = {
+        .num_rows = num_rows,
+        .num_cols = cols,
+        .rows = xcalloc(num_rows, sizeof(grid.rows[0])),
+        .slab = grid_row_slab_new(cols),
+    };
+
+    for (int r = 0; r < num_rows; r++) {
+        struct row *row = grid_row_alloc(grid.slab, cols, true);
+        row->cells[0].wc = U'a' + r;
+        row->linebreak = true;
+        grid.rows[r] = row;
+    }
+
+    for (int r = screen_rows; r < num_rows; r += 2)
+        xassert(grid_row_pack(&grid, grid.rows[r]));
+
+    xassert(grid.packed_bytes > 0);
+    xassert(grid.unpacked_bytes > 0);
+
+    grid_free_rows(&grid, screen_rows, num_rows);
+
+    xassert(grid.packed_bytes == 0);
+    xassert(grid.unpacked_bytes == 0);
+    for (int r = screen_rows; r < num_rows; r++)
+        xassert(grid.rows[r] == NULL);
+
+    grid.cur_row = grid.rows[0];
+    grid_resize_and_reflow(
+        &grid, NULL, num_rows, 2 * cols, screen_rows, screen_rows,
+        0, (struct coord *const[]){NULL});
+
+    xassert(grid.num_cols == 2 * cols);
+    for (int r = 0; r < screen_rows; r++)
+        xassert(grid_row_unpacked(&grid, r)->cells[0].wc == U'a' + r);
+
+    grid_free(&grid);
+}
+
+/* Moves 'row' (including its extra data) to a new slab */
+static struct row *
+row_move_to_slab(struct row_slab *slab, struct row *row, int cols)
+{
+    struct row *new_row = row_header_alloc(slab);
+    *new_row = *row;
+    new_row->slab = slab;
+    grid_row_dirty(new_row);
+
+    if (row->cells != NULL) {
+        new_row->cells = row_cells_alloc(slab, cols);
+        memcpy(new_row->cells, row->cells, cols * sizeof(row->cells[0]));
+        row_cells_free(row->slab, row->cells);
+    }
+
+    if (row->slab != NULL)
+        slab_pool_free(&row->slab->rows, row);
+    else
+        free(row);
+
+    return new_row;
+}
+
+void
+grid_move_rows(struct grid *dst, struct grid *src, int start, int count)
+{
+    xassert(dst->num_rows == src->num_rows);
+    xassert(dst->num_cols == src->num_cols);
+
+    const int mask = src->num_rows - 1;
+    const size_t unpacked_size = src->num_cols * sizeof(struct cell);
+
+    for (int r = 0; r < count; r++) {
+        const int idx = (start + r) & mask;
+        struct row *row = src->rows[idx];
+
+        xassert(dst->rows[idx] == NULL);
+
+        if (row != NULL && row->cells == NULL) {
+            src->packed_bytes -= row->packed_size;
+            src->unpacked_bytes -= unpacked_size;
+            dst->packed_bytes += row->packed_size;
+            dst->unpacked_bytes += unpacked_size;
+        }
+
+        dst->rows[idx] = row;
+        src->rows[idx] = NULL;
+    }
+}
+
+bool
+grid_splice_history(struct grid *grid, struct grid *history)
+{
+    xassert(grid->num_rows == history->num_rows);
+    xassert(grid->num_cols == history->num_cols);
+
+    const int cols = grid->num_cols;
+    const int mask = grid->num_rows - 1;
+
+    /* Find the first unused row above the oldest row */
+    int dst = -1;
+    for (int r = 1; r < grid->num_rows; r++) {
+        const int idx = (grid->offset - r) & mask;
+        if (grid->rows[idx] == NULL) {
+            dst = idx;
+            break;
+        }
+    }
+
+    int src = history->offset;
+    while (dst >= 0 && grid->rows[dst] == NULL && history->rows[src] != NULL) {
+        struct row *row = history->rows[src];
+        history->rows[src] = NULL;
+
+        if (row->cells == NULL) {
+            grid->packed_bytes += row->packed_size;
+            grid->unpacked_bytes += cols * sizeof(row->cells[0]);
+            history->packed_bytes -= row->packed_size;
+            history->unpacked_bytes -= cols * sizeof(row->cells[0]);
+        }
+
+        grid->rows[dst] = row_move_to_slab(grid->slab, row, cols);
+
+        dst = (dst - 1) & mask;
+        src = (src - 1) & mask;
+    }
+
+    const bool all_moved = history->rows[src] == NULL;
+    grid_free(history);
+    return all_moved;
+}
+
+UNITTEST
+{
+    const int cols = 4;
+    struct grid grid = {
+        .num_rows = 8,
+        .num_cols = cols,
+        .offset = 6,
+        .view = 6,
+        .rows = xcalloc(8, sizeof(grid.rows[0])),
+        .slab = grid_row_slab_new(cols),
+    };
+    struct grid history = {
+        .num_rows = 8,
+        .num_cols = cols,
+        .offset = 2,
+        .view = 2,
+        .rows = xcalloc(8, sizeof(history.rows[0])),
+        .slab = grid_row_slab_new(cols),
+    };
+
+    /* Three live rows: 6, 7 and 0 */
+    for (int r = 0; r < 3; r++) {
+        struct row *row = grid_row_alloc(grid.slab, cols, true);
+        row->cells[0].wc = U'a' + r;
+        grid.rows[(6 + r) & 7] = row;
+    }
+
+    /* Six history rows, oldest first: 5, 6, 7, 0, 1, 2 */
+    for (int r = 0; r < 6; r++) {
+        struct row *row = grid_row_alloc(history.slab, cols, true);
+        row->cells[0].wc = U'0' + r;
+        history.rows[(5 + r) & 7] = row;
+    }
+
+    /* Pack one of the rows that will be moved */
+    history.rows[1]->cells[1].wc = U'x';
+    xassert(grid_row_pack(&history, history.rows[1]));
+    const size_t packed_size = history.rows[1]->packed_size;
+
+    xassert(!grid_splice_history(&grid, &history));
+    xassert(history.slab == NULL);
+
+    /* Only the five newest history rows fit */
+    xassert(grid.packed_bytes == packed_size);
+    xassert(grid.rows[4]->cells == NULL);
+
+    for (int r = 1; r < 6; r++) {
+        xassert(grid.rows[r] != NULL);
+        xassert(grid.rows[r]->slab == grid.slab);
+
+        const struct row *row = grid_row_unpacked(&grid, r);
+        xassert(row->cells[0].wc == U'0' + r);
+    }
+
+    xassert(grid.rows[4]->cells[1].wc == U'x');
+    xassert(grid.packed_bytes == 0);
+
+    grid_free(&grid);
+}
+
+/*
+ * Don't bother reflowing in parallel unless each thread gets at least
+ * this many rows
+ */
+#define REFLOW_PARALLEL_MIN_ROWS 4096
+
+struct reflow_chunk {
+    struct grid grid;
+    bool shared_rows;
+    const struct composed_table *composed;
+    int new_rows;
+    int new_cols;
+    thrd_t thread;
+    bool threaded;
+};
+
+static void
+reflow_chunk(struct reflow_chunk *chunk)
+{
+    /* The newest row is the bottom of a single row "screen" */
+    chunk->grid.view = chunk->grid.offset;
+    chunk->grid.cursor = chunk->grid.saved_cursor = (struct cursor){0};
+
+    reflow(&chunk->grid, chunk->shared_rows, chunk->composed,
+           chunk->new_rows, chunk->new_cols, 1, 1, 0, NULL);
+}
+
+static int
+reflow_chunk_thread(void *data)
+{
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_SETMASK, &mask, NULL);
+
+    reflow_chunk(data);
+    return 0;
+}
+
+/*
+ * Splits the 'total' rows of the history into (at most) 'max_chunks'
+ * chunks of (roughly) equal size, at hard linebreaks. Logical lines
+ * don't span chunks, and thus each chunk can be reflowed on its own,
+ * in a thread of its own. All rows are moved to the chunks, newest
+ * chunk first. Returns the number of chunks.
+ */
+static size_t
+reflow_split(struct grid *history, int total, size_t max_chunks,
+             const struct composed_table *composed, int new_rows,
+             int new_cols, struct reflow_chunk chunks[static max_chunks])
+{
+    const int mask = history->num_rows - 1;
+    const int target = total / max_chunks;
+
+    size_t count = 0;
+    int newest = history->offset;
+    int left = total;
+
+    while (left > 0) {
+        /* Last chunk takes whatever is left */
+        int rows = count + 1 < max_chunks ? min(target, left) : left;
+
+        /* Extend the chunk up to the start of the logical line */
+        while (rows < left && !history->rows[(newest - rows) & mask]->linebreak)
+            rows++;
+
+        struct reflow_chunk *chunk = &chunks[count++];
+        *chunk = (struct reflow_chunk){
+            .grid = {
+                .num_rows = history->num_rows,
+                .num_cols = history->num_cols,
+                .offset = newest,
+                .rows = xcalloc(history->num_rows, sizeof(chunk->grid.rows[0])),
+            },
+            .shared_rows = true,
+            .composed = composed,
+            .new_rows = new_rows,
+            .new_cols = new_cols,
+        };
+
+        grid_move_rows(&chunk->grid, history, newest - rows + 1, rows);
+        newest = (newest - rows) & mask;
+        left -= rows;
+    }
+
+    return count;
+}
+
+/*
+ * Replaces the (now empty) history with the reflowed chunks, stitched
+ * together
+ */
+static void
+reflow_stitch(struct grid *history, struct reflow_chunk *chunks, size_t count)
+{
+    /*
+     * All rows have been moved to the chunks; this releases the slab,
+     * and with it, the old rows
+     */
+    grid_free(history);
+
+    /* Newest first */
+    *history = chunks[0].grid;
+
+    bool fits = true;
+    for (size_t i = 1; i < count; i++) {
+        if (fits)
+            fits = grid_splice_history(history, &chunks[i].grid);
+        else
+            grid_free(&chunks[i].grid);
+    }
+}
+
+void
+grid_reflow_history(struct grid *history, const struct composed_table *composed,
+                    int new_rows, int new_cols, size_t thread_count)
+{
+#if defined(TIME_REFLOW) && TIME_REFLOW
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+#endif
+
+    const int mask = history->num_rows - 1;
+    xassert(tll_length(history->sixel_images) == 0);
+
+    int total = 0;
+    while (total < history->num_rows &&
+           history->rows[(history->offset - total) & mask] != NULL)
+    {
+        total++;
+    }
+
+    const size_t max_chunks = min(thread_count, (size_t)total / REFLOW_PARALLEL_MIN_ROWS);
+
+    if (max_chunks <= 1) {
+        struct reflow_chunk chunk = {
+            .grid = *history,
+            .composed = composed,
+            .new_rows = new_rows,
+            .new_cols = new_cols,
+        };
+
+        reflow_chunk(&chunk);
+        *history = chunk.grid;
+        return;
+    }
+
+    struct reflow_chunk chunks[max_chunks];
+    const size_t count = reflow_split(
+        history, total, max_chunks, composed, new_rows, new_cols, chunks);
+
+    for (size_t i = 1; i < count; i++) {
+        int ret = thrd_create(&chunks[i].thread, &reflow_chunk_thread, &chunks[i]);
+        if (ret == thrd_success)
+            chunks[i].threaded = true;
+        else {
+            LOG_ERR("failed to create reflow thread: %s (%d)",
+                    thrd_err_as_string(ret), ret);
+        }
+    }
+
+    reflow_chunk(&chunks[0]);
+
+    for (size_t i = 1; i < count; i++) {
+        if (chunks[i].threaded)
+            thrd_join(chunks[i].thread, NULL);
+        else
+            reflow_chunk(&chunks[i]);
+    }
+
+    reflow_stitch(history, chunks, count);
+
+#if defined(TIME_REFLOW) && TIME_REFLOW
+    struct timespec stop;
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    struct timespec diff;
+    timespec_sub(&stop, &start, &diff);
+    LOG_INFO("reflowed %d history rows in %zu chunks in %lds %ldns",
+             total, count, (long)diff.tv_sec, diff.tv_nsec);
+#endif
+}
+
+UNITTEST
+{
+    /*
+     * Split a history into chunks, and reflow them (without spawning
+     * any threads; this runs on each startup of debug builds)
+     */
+    const int old_cols = 4;
+    const int new_cols = 8;
+    const int line_count = 48;
+    const int num_rows = 128;
+
+    struct grid history = {
+        .num_rows = num_rows,
+        .num_cols = old_cols,
+        .rows = xcalloc(num_rows, sizeof(history.rows[0])),
+        .slab = grid_row_slab_new(old_cols),
+    };
+
+    /*
+     * Logical lines, oldest first, of alternating length (one and
+     * two rows), each filled with its own line number
+     */
+    int row_idx = 0;
+    for (int l = 0; l < line_count; l++) {
+        const int row_count = 1 + (l & 1);
+
+        for (int r = 0; r < row_count; r++) {
+            struct row *row = grid_row_alloc(history.slab, old_cols, true);
+            for (int c = 0; c < old_cols; c++)
+                row->cells[c].wc = U'0' + l;
+
+            row->linebreak = r + 1 == row_count;
+            history.rows[row_idx++] = row;
+        }
+    }
+
+    history.offset = row_idx - 1;
+
+    /* Pack some of the rows */
+    for (int r = 0; r < row_idx; r += 3)
+        grid_row_pack(&history, history.rows[r]);
+
+    struct reflow_chunk chunks[4];
+    const size_t count = reflow_split(
+        &history, row_idx, ALEN(chunks), NULL, num_rows, new_cols, chunks);
+    xassert(count == ALEN(chunks));
+
+    for (size_t i = 0; i < count; i++) {
+        /* Logical lines are never split */
+        const struct grid *chunk = &chunks[i].grid;
+        xassert(chunk->rows[chunk->offset]->linebreak);
+
+        reflow_chunk(&chunks[i]);
+    }
+
+    reflow_stitch(&history, chunks, count);
+    xassert(history.num_cols == new_cols);
+
+    /* Each logical line is now a single row, in the same order */
+    for (int l = 0; l < line_count; l++) {
+        const int idx = (history.offset - line_count + 1 + l) & (num_rows - 1);
+        const struct row *row = grid_row_unpacked(&history, idx);
+
+        xassert(row != NULL);
+        xassert(row->linebreak);
+        xassert(row->cells[0].wc == U'0' + l);
+        xassert(row->cells[old_cols - 1].wc == U'0' + l);
+
+        const bool wrapped = l & 1;
+        xassert(row->cells[old_cols].wc == (wrapped ? U'0' + l : 0));
+    }
+
+    xassert(history.rows[(history.offset - line_count) & (num_rows - 1)] == NULL);
+    grid_free(&history);
+}
+
+bool
+grid_reflow_history_chunk(struct grid *grid, struct grid *history,
+                          const struct composed_table *composed,
+                          int min_rows, size_t thread_count)
+{
+    const int newest = history->offset;
+    const int mask = history->num_rows - 1;
+
+    xassert(history->rows[newest] != NULL);
+
+    /* Don't split logical lines */
+    int count = 1;
+    for (; count < history->num_rows; count++) {
+        const struct row *above = history->rows[(newest - count) & mask];
+        if (above == NULL || (count >= min_rows && above->linebreak))
+            break;
+    }
+
+    struct grid chunk = {
+        .num_rows = history->num_rows,
+        .num_cols = history->num_cols,
+        .offset = newest,
+        .view = newest,
+        .rows = xcalloc(history->num_rows, sizeof(chunk.rows[0])),
+    };
+
+    grid_move_rows(&chunk, history, newest - count + 1, count);
+
+    history->offset = (newest - count) & mask;
+    history->view = history->offset;
+
+    /* Note: the chunk's (old) rows are in the history's slab; it must
+     * not be free:d before this */
+    grid_reflow_history(
+        &chunk, composed, grid->num_rows, grid->num_cols, thread_count);
+
+    return grid_splice_history(grid, &chunk);
+}
+
+/*
+ * Logical lines, oldest first, of one to three rows. Each cell holds
+ * its line number, and its position in the line.
+ */
+static void UNUSED
+unittest_history_fill(struct grid *history, int line_count)
+{
+    const int cols = history->num_cols;
+    int row_idx = 0;
+
+    for (int l = 0; l < line_count; l++) {
+        const int row_count = 1 + l % 3;
+
+        for (int r = 0; r < row_count; r++) {
+            struct row *row = grid_row_alloc(history->slab, cols, true);
+
+            /* The last row of a line is only partially filled */
+            const int used = r + 1 < row_count ? cols : 1 + l % cols;
+            for (int c = 0; c < used; c++)
+                row->cells[c].wc = 0x10000 + l * 16 + r * cols + c;
+
+            row->linebreak = r + 1 == row_count;
+            history->rows[row_idx++] = row;
+        }
+    }
+
+    history->offset = history->view = row_idx - 1;
+
+    for (int r = 0; r < row_idx; r += 5)
+        grid_row_pack(history, history->rows[r]);
+}
+
+UNITTEST
+{
+    /*
+     * Lazily reflow a history, a chunk at a time, with new output
+     * in between, and compare with reflowing all of it at once
+     */
+    const int old_cols = 4;
+    const int new_cols = 6;
+    const int num_rows = 256;
+    const int mask = num_rows - 1;
+    const int line_count = 64;
+    const int screen_rows = 4;
+
+    struct grid all_at_once = {
+        .num_rows = num_rows,
+        .num_cols = old_cols,
+        .rows = xcalloc(num_rows, sizeof(all_at_once.rows[0])),
+        .slab = grid_row_slab_new(old_cols),
+    };
+    struct grid history = {
+        .num_rows = num_rows,
+        .num_cols = old_cols,
+        .rows = xcalloc(num_rows, sizeof(history.rows[0])),
+        .slab = grid_row_slab_new(old_cols),
+    };
+
+    unittest_history_fill(&all_at_once, line_count);
+    unittest_history_fill(&history, line_count);
+
+    grid_reflow_history(&all_at_once, NULL, num_rows, new_cols, 1);
+
+    /* The (already reflowed) screen */
+    struct grid grid = {
+        .num_rows = num_rows,
+        .num_cols = new_cols,
+        .rows = xcalloc(num_rows, sizeof(grid.rows[0])),
+        .slab = grid_row_slab_new(new_cols),
+    };
+
+    for (int r = 0; r < screen_rows; r++) {
+        grid.rows[r] = grid_row_alloc(grid.slab, new_cols, true);
+        grid.rows[r]->cells[0].wc = U'S';
+        grid.rows[r]->linebreak = true;
+    }
+
+    /* A couple of chunks, each followed by a line of output */
+    for (int i = 0; i < 3; i++) {
+        xassert(grid_reflow_history_chunk(&grid, &history, NULL, 16, 1));
+        xassert(history.rows[history.offset] != NULL);
+
+        grid.offset = grid.view = (grid.offset + 1) & mask;
+
+        const int bottom = (grid.offset + screen_rows - 1) & mask;
+        xassert(grid.rows[bottom] == NULL);
+        grid.rows[bottom] = grid_row_alloc(grid.slab, new_cols, true);
+        grid.rows[bottom]->cells[0].wc = U'o';
+        grid.rows[bottom]->linebreak = true;
+    }
+
+    /* ... and then the rest of it */
+    while (history.rows[history.offset] != NULL)
+        xassert(grid_reflow_history_chunk(&grid, &history, NULL, INT_MAX, 1));
+    grid_free(&history);
+
+    int reflowed_rows = 0;
+    while (all_at_once.rows[(all_at_once.offset - reflowed_rows) & mask] != NULL)
+        reflowed_rows++;
+
+    int oldest = grid.offset;
+    while (grid.rows[(oldest - 1) & mask] != NULL)
+        oldest = (oldest - 1) & mask;
+
+    for (int r = 0; r < reflowed_rows; r++) {
+        const struct row *expected = grid_row_unpacked(
+            &all_at_once, (all_at_once.offset - reflowed_rows + 1 + r) & mask);
+        const struct row *row = grid_row_unpacked(&grid, (oldest + r) & mask);
+
+        xassert(row->linebreak == expected->linebreak);
+        for (int c = 0; c < new_cols; c++)
+            xassert(row->cells[c].wc == expected->cells[c].wc);
+    }
+
+    /* Followed by the screen, as it was before the new output */
+    xassert(grid_row_unpacked(
+        &grid, (oldest + reflowed_rows) & mask)->cells[0].wc == U'S');
+
+    grid_free(&all_at_once);
+    grid_free(&grid);
+}
+
 static bool
 ranges_match(const struct row_range *r1, const struct row_range *r2,
              enum row_range_type type)
@@ -2,25 +2,101 @@
 
 #include <stddef.h>
 #include "debug.h"
+#include "util.h"
 #include "terminal.h"
 
 struct grid *grid_snapshot(const struct grid *grid);
 void grid_free(struct grid *grid);
 
 void grid_swap_row(struct grid *grid, int row_a, int row_b);
-struct row *grid_row_alloc(int cols, bool initialize);
+/*
+ * Per-grid allocator for row headers and (fixed size) cell arrays. All
+ * rows allocated from a slab must have 'cols' columns. A NULL slab
+ * means rows are allocated with malloc().
+ */
+struct row_slab *grid_row_slab_new(int cols);
+void grid_row_slab_destroy(struct row_slab *slab);
+
+struct row *grid_row_alloc(struct row_slab *slab, int cols, bool initialize);
 void grid_row_free(struct row *row);
 
+/*
+ * Rows more than this many screens above the active screen are
+ * packed (compressed), see grid_pack_cold_rows()
+ */
+#define GRID_PACK_DISTANCE_SCREENS 4
+
+bool grid_row_pack(struct grid *grid, struct row *row);
+void grid_row_unpack(struct grid *grid, struct row *row);
+void grid_row_unpack_to(
+    const struct grid *grid, const struct row *row, struct cell *cells);
+void grid_row_discard_packed(struct grid *grid, struct row *row);
+
+/*
+ * Frees rows[start..end) (raw row indices), keeping the grid's
+ * packed/unpacked byte counters in sync
+ */
+void grid_free_rows(struct grid *grid, int start, int end);
+
+/*
+ * Packs up to 'count' rows, starting with the newest row that is
+ * GRID_PACK_DISTANCE_SCREENS screens above the active screen, and
+ * moving up into the scrollback. Rows in the view are never packed.
+ */
+void grid_pack_cold_rows(struct grid *grid, int screen_rows, int count);
+
 void grid_resize_without_reflow(
     struct grid *grid, int new_rows, int new_cols,
     int old_screen_rows, int new_screen_rows);
 
+/*
+ * Only touches 'grid', and reads 'composed'; may be called from a
+ * worker thread, as long as no one else is accessing either of them.
+ */
 void grid_resize_and_reflow(
-    struct grid *grid, const struct terminal *term, int new_rows, int new_cols,
-    int old_screen_rows, int new_screen_rows,
+    struct grid *grid, const struct composed_table *composed,
+    int new_rows, int new_cols, int old_screen_rows, int new_screen_rows,
     size_t tracking_points_count,
     struct coord *const _tracking_points[static tracking_points_count]);
 
+/*
+ * Reflows a scrollback history (i.e. a grid without a screen) whose
+ * newest row is at history->offset. The newest row is at the new
+ * offset when done. The history is split into chunks of logical
+ * lines, that are reflowed in parallel, in up to 'thread_count'
+ * threads. Sixels are not supported.
+ */
+void grid_reflow_history(
+    struct grid *history, const struct composed_table *composed,
+    int new_rows, int new_cols, size_t thread_count);
+
+/*
+ * Moves 'count' rows, starting at absolute row 'start', from 'src' to
+ * the same (unused) rows in 'dst'. Both grids must have the same
+ * dimensions.
+ */
+void grid_move_rows(struct grid *dst, struct grid *src, int start, int count);
+
+/*
+ * Moves the rows of 'history' into the unused rows above the oldest
+ * row in 'grid'. 'history' must have the same dimensions as 'grid',
+ * and its newest row at history->offset. Rows that don't fit are
+ * free:d, along with everything else in 'history' (but not the
+ * struct itself). Returns false if not all rows fit.
+ */
+bool grid_splice_history(struct grid *grid, struct grid *history);
+
+/*
+ * Reflows the newest logical lines, at least 'min_rows' (old) rows, of
+ * 'history' to the dimensions of 'grid', and splices them in above
+ * the oldest row of 'grid'. The reflowed rows are removed from
+ * 'history'; it is empty when history->rows[history->offset] is
+ * NULL. Returns false if not all reflowed rows fit.
+ */
+bool grid_reflow_history_chunk(
+    struct grid *grid, struct grid *history,
+    const struct composed_table *composed, int min_rows, size_t thread_count);
+
 /* Convert row numbers between scrollback-relative and absolute coordinates */
 int grid_row_abs_to_sb(const struct grid *grid, int screen_rows, int abs_row);
 int grid_row_sb_to_abs(const struct grid *grid, int screen_rows, int sb_rel_row);
@@ -52,11 +128,20 @@ _grid_row_maybe_alloc(struct grid *grid, int row_no, bool alloc_if_null)
     struct row *row = grid->rows[real_row];
 
     if (row == NULL && alloc_if_null) {
-        row = grid_row_alloc(grid->num_cols, false);
+        row = grid_row_alloc(grid->slab, grid->num_cols, false);
         grid->rows[real_row] = row;
     }
 
     xassert(row != NULL);
+
+    if (unlikely(row->cells == NULL)) {
+        /* Rows are only allocated to be erased; don't bother unpacking */
+        if (alloc_if_null)
+            grid_row_discard_packed(grid, row);
+        else
+            grid_row_unpack(grid, row);
+    }
+
     return row;
 }
 
@@ -81,9 +166,62 @@ grid_row_in_view(struct grid *grid, int row_no)
     struct row *row = grid->rows[real_row];
 
     xassert(row != NULL);
+
+    if (unlikely(row->cells == NULL))
+        grid_row_unpack(grid, row);
+
     return row;
 }
 
+/*
+ * Returns the row at the absolute row index 'abs_row' (i.e. an index
+ * into grid->rows), unpacking it if necessary. Returns NULL if the
+ * row hasn't been allocated.
+ *
+ * Unpacking doesn't change the row's content, which is why this
+ * takes a const grid.
+ */
+static inline struct row *
+grid_row_unpacked(const struct grid *grid, int abs_row)
+{
+    struct row *row = grid->rows[abs_row];
+
+    if (unlikely(row != NULL && row->cells == NULL))
+        grid_row_unpack((struct grid *)grid, row);
+
+    return row;
+}
+
+/*
+ * Marks columns start..end (inclusive) of the row as dirty. The
+ * renderer only looks at (and damages) cells within the row's dirty
+ * span, thus any cell whose 'clean' bit is cleared must be covered
+ * by it. grid_row_dirty() dirties the whole row.
+ */
+static inline void
+grid_row_dirty_cols(struct row *row, int start, int end)
+{
+    xassert(start >= 0);
+    xassert(start <= end);
+
+    if (!row->dirty) {
+        row->dirty = true;
+        row->dirty_start = start;
+        row->dirty_end = min(end, UINT16_MAX);
+    } else {
+        row->dirty_start = min(row->dirty_start, start);
+        row->dirty_end = max(row->dirty_end, min(end, UINT16_MAX));
+    }
+}
+
+static inline void
+grid_row_dirty(struct row *row)
+{
+    row->dirty = true;
+    row->dirty_start = 0;
+    row->dirty_end = UINT16_MAX;
+}
+
 void grid_row_uri_range_put(
     struct row *row, int col, const char *uri, uint64_t id);
 void grid_row_uri_range_erase(struct row *row, int start, int end);
@@ -249,12 +249,12 @@ done(void *data, struct zwp_text_input_v3 *zwp_text_input_v3,
         int width = widths[i];
 
         cell->wc = seat->ime.preedit.text[i];
-        cell->attrs = (struct attributes){.clean = 0};
+        cell->attrs = (cell_attrs_t){.clean = 0};
 
         for (int j = 1; j < width; j++) {
             cell = &seat->ime.preedit.cells[cell_idx + j];
             cell->wc = CELL_SPACER + width - j;
-            cell->attrs = (struct attributes){.clean = 1};
+            cell->attrs = (cell_attrs_t){.clean = 1};
         }
 
         cell_idx += width;
@@ -357,10 +357,15 @@ done(void *data, struct zwp_text_input_v3 *zwp_text_input_v3,
     int start = seat->ime.preedit.cursor.start;
     int end = seat->ime.preedit.cursor.end;
 
+    /* Pre-edit text is only rendered in the IME focused terminal */
+    const cell_attrs_t underline = term != NULL
+        ? term_attrs_to_cell(term, &(struct attributes){.underline = true})
+        : (cell_attrs_t){0};
+
     for (size_t i = 0, cell_idx = 0; i < wchars; cell_idx += widths[i], i++) {
         if (hidden || start == end || cell_idx < start || cell_idx >= end) {
             struct cell *cell = &seat->ime.preedit.cells[cell_idx];
-            cell->attrs.underline = true;
+            cell->attrs = underline;
         }
     }
 
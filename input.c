@@ -266,6 +266,7 @@ execute_binding(struct seat *seat, struct terminal *term,
         bool success;
         switch (action) {
         case BIND_ACTION_PIPE_SCROLLBACK:
+            render_reflow_finish(term);
             success = term_scrollback_to_text(term, &text, &len);
             break;
 
@@ -374,30 +375,41 @@ execute_binding(struct seat *seat, struct terminal *term,
             return false;
 
         struct grid *grid = term->grid;
-        const int sb_start =
-            grid_sb_start_ignore_uninitialized(grid, term->rows);
+        int sb_start = grid_sb_start_ignore_uninitialized(grid, term->rows);
 
         /* Check each row from current view-1 (that is, the first
          * currently not visible row), up to, and including, the
          * scrollback start */
-        for (int r_sb_rel =
-                 grid_row_abs_to_sb_precalc_sb_start(
-                     grid, sb_start, grid->view) - 1;
-             r_sb_rel >= 0; r_sb_rel--)
-        {
-            const int r_abs =
-                grid_row_sb_to_abs_precalc_sb_start(grid, sb_start, r_sb_rel);
+        int r_sb_rel =
+            grid_row_abs_to_sb_precalc_sb_start(grid, sb_start, grid->view) - 1;
 
-            const struct row *row = grid->rows[r_abs];
-            xassert(row != NULL);
+        while (true) {
+            for (; r_sb_rel >= 0; r_sb_rel--) {
+                const int r_abs =
+                    grid_row_sb_to_abs_precalc_sb_start(grid, sb_start, r_sb_rel);
 
-            if (!row->shell_integration.prompt_marker)
-                continue;
+                const struct row *row = grid_row_unpacked(grid, r_abs);
+                xassert(row != NULL);
 
-            grid->view = r_abs;
-            term_damage_view(term);
-            render_refresh(term);
-            break;
+                if (!row->shell_integration.prompt_marker)
+                    continue;
+
+                grid->view = r_abs;
+                term_damage_view(term);
+                render_refresh(term);
+                return true;
+            }
+
+            if (!render_reflow_pending(term, term->rows))
+                break;
+
+            /* Continue with the lazily reflowed rows, above the old
+             * scrollback start */
+            const int new_sb_start =
+                grid_sb_start_ignore_uninitialized(grid, term->rows);
+            r_sb_rel = grid_row_abs_to_sb_precalc_sb_start(
+                grid, new_sb_start, sb_start) - 1;
+            sb_start = new_sb_start;
         }
 
         return true;
@@ -420,7 +432,7 @@ execute_binding(struct seat *seat, struct terminal *term,
              ;
              r_abs = (r_abs + 1) & (num_rows - 1))
         {
-            const struct row *row = grid->rows[r_abs];
+            const struct row *row = grid_row_unpacked(grid, r_abs);
             xassert(row != NULL);
 
             if (!row->shell_integration.prompt_marker) {
@@ -606,6 +606,8 @@ main(int argc, char *const *argv)
 
     shm_set_max_pool_size(conf.tweak.max_shm_pool_size);
     shm_set_min_stride_alignment(conf.tweak.min_stride_alignment);
+    shm_set_hugepages(conf.tweak.shm_hugepages);
+    shm_set_prefault(conf.tweak.shm_prefault);
 
     if ((fdm = fdm_init()) == NULL)
         goto out;
@@ -626,8 +628,8 @@ main(int argc, char *const *argv)
         goto out;
 
     if (!as_server && (term = term_init(
-                           &conf, fdm, reaper, wayl, "foot", cwd, token, pty_path,
-                           argc, argv, NULL,
+                           &conf, fdm, reaper, wayl, NULL, "foot", cwd, token,
+                           pty_path, argc, argv, NULL,
                            &term_shutdown_cb, &shutdown_ctx)) == NULL) {
         goto out;
     }
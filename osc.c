@@ -1202,8 +1202,7 @@ kitty_text_size(struct terminal *term, char *string)
          * protocol, that means we just process the string as if it
          * has been printed without this OSC.
          */
-        for (size_t i = 0; i < len; i++)
-            term_process_and_print_non_ascii(term, wchars[i]);
+        term_process_and_print_non_ascii_run(term, wchars, len);
         free(wchars);
         return;
     }
@@ -1246,27 +1245,28 @@ kitty_text_size(struct terminal *term, char *string)
     uint32_t key = composed_key_from_chars(wchars, len);
 
     const struct composed *composed = composed_lookup_without_collision(
-        term->composed, &key, wchars, len - 1, wchars[len - 1], forced_width);
+        &term->composed, &key, wchars, len - 1, wchars[len - 1], forced_width);
 
     if (composed == NULL) {
-        struct composed *new_cc = xmalloc(sizeof(*new_cc));
-        new_cc->chars = wchars;
-        new_cc->count = len;
-        new_cc->key = key;
-        new_cc->width = width;
-        new_cc->forced_width = forced_width;
-
-        term->composed_count++;
-        composed_insert(&term->composed, new_cc);
-        composed = new_cc;
-    } else if (composed->width == width) {
-        free(wchars);
+        composed = composed_insert(
+            &term->composed, &(struct composed){
+                .chars = wchars,
+                .count = len,
+                .key = key,
+                .width = width,
+                .forced_width = forced_width,
+            });
     }
 
+    free(wchars);
+
     term_print(
         term, CELL_COMB_CHARS_LO + composed->key,
         composed->forced_width > 0 ? composed->forced_width : composed->width,
         false);
+
+    if (unlikely(term->composed.count >= term->composed_gc_threshold))
+        term_composed_gc(term);
 }
 
 void
@@ -10,13 +10,10 @@
 #include <sys/timerfd.h>
 #include <sys/mman.h>
 #include <fcntl.h>
+#include <time.h>
 
-#include "async.h"
 #include "config.h"
-#include "key-binding.h"
-#include "reaper.h"
 #include "sixel.h"
-#include "user-notification.h"
 #include "vt.h"
 
 extern bool fdm_ptmx(struct fdm *fdm, int fd, int events, void *data);
@@ -29,230 +26,34 @@ usage(const char *prog_name)
         prog_name);
 }
 
-enum async_write_status
-async_write(int fd, const void *data, size_t len, size_t *idx)
-{
-    return ASYNC_WRITE_DONE;
-}
-
-bool
-fdm_add(struct fdm *fdm, int fd, int events, fdm_fd_handler_t handler, void *data)
-{
-    return true;
-}
-
-bool
-fdm_del(struct fdm *fdm, int fd)
-{
-    return true;
-}
-
-bool
-fdm_event_add(struct fdm *fdm, int fd, int events)
-{
-    return true;
-}
-
-bool
-fdm_event_del(struct fdm *fdm, int fd, int events)
-{
-    return true;
-}
-
-bool
-render_resize(
-    struct terminal *term, int width, int height, uint8_t resize_options)
-{
-    return true;
-}
-
-void render_refresh(struct terminal *term) {}
-void render_refresh_csd(struct terminal *term) {}
-void render_refresh_title(struct terminal *term) {}
-void render_refresh_app_id(struct terminal *term) {}
-void render_refresh_icon(struct terminal *term) {}
-
-void render_overlay(struct terminal *term) {}
-
-void render_buffer_release_callback(struct buffer *buf, void *data) {}
-
-bool
-render_xcursor_is_valid(const struct seat *seat, const char *cursor)
-{
-    return true;
-}
-
-bool
-render_xcursor_set(struct seat *seat, struct terminal *term, enum cursor_shape shape)
-{
-    return true;
-}
-
-enum cursor_shape
-xcursor_for_csd_border(struct terminal *term, int x, int y)
-{
-    return CURSOR_SHAPE_LEFT_PTR;
-}
-
-struct wl_window *
-wayl_win_init(struct terminal *term, const char *token)
-{
-    return NULL;
-}
-
-void wayl_win_destroy(struct wl_window *win) {}
-void wayl_win_alpha_changed(struct wl_window *win) {}
-bool wayl_win_set_urgent(struct wl_window *win) { return true; }
-bool wayl_win_ring_bell(const struct wl_window *win) { return true; }
-bool wayl_fractional_scaling(const struct wayland *wayl) { return true; }
-
-pid_t
-spawn(struct reaper *reaper, const char *cwd, char *const argv[],
-      int stdin_fd, int stdout_fd, int stderr_fd,
-      reaper_cb cb, void *cb_data, const char *xdg_activation_token)
-{
-    return 2;
-}
-
-pid_t
-slave_spawn(
-    int ptmx, int argc, const char *cwd, char *const *argv, char *const *envp,
-    const env_var_list_t *extra_env_vars, const char *term_env,
-    const char *conf_shell, bool login_shell,
-    const user_notifications_t *notifications)
-{
-    return 0;
-}
-
-int
-render_worker_thread(void *_ctx)
-{
-    return 0;
-}
-
-bool
-wayl_do_linear_blending(const struct wayland *wayl, const struct config *conf)
-{
-    return false;
-}
-
-struct extraction_context *
-extract_begin(enum selection_kind kind, bool strip_trailing_empty)
-{
-    return NULL;
-}
-
-bool
-extract_one(
-    const struct terminal *term, const struct row *row, const struct cell *cell,
-    int col, void *context)
-{
-    return true;
-}
-
-bool
-extract_finish(struct extraction_context *context, char **text, size_t *len)
-{
-    return true;
-}
-
-void cmd_scrollback_up(struct terminal *term, int rows) {}
-void cmd_scrollback_down(struct terminal *term, int rows) {}
-
-void ime_enable(struct seat *seat) {}
-void ime_disable(struct seat *seat) {}
-void ime_reset_preedit(struct seat *seat) {}
-
-bool
-notify_notify(struct terminal *term, struct notification *notif)
-{
-    return true;
-}
-
-void
-notify_close(struct terminal *term, const char *id)
-{
-}
-
-void
-notify_free(struct terminal *term, struct notification *notif)
-{
-}
-
-void
-notify_icon_add(struct terminal *term, const char *id,
-                const char *symbolic_name, const uint8_t *data,
-                size_t data_sz)
-{
-}
-
-void
-notify_icon_del(struct terminal *term, const char *id)
-{
-}
-
-void
-notify_icon_free(struct notification_icon *icon)
-{
-}
-
-void reaper_add(struct reaper *reaper, pid_t pid, reaper_cb cb, void *cb_data) {}
-void reaper_del(struct reaper *reaper, pid_t pid) {}
-
-void urls_reset(struct terminal *term) {}
-
-void shm_unref(struct buffer *buf) {}
-void shm_chain_free(struct buffer_chain *chain) {}
-enum shm_bit_depth shm_chain_bit_depth(const struct buffer_chain *chain) { return SHM_BITS_8; }
-
-struct buffer_chain *
-shm_chain_new(
-    struct wayland *wayl, bool scrollable, size_t pix_instances,
-    enum shm_bit_depth desired_bit_depth,
-    void (*release_cb)(struct buffer *buf, void *data), void *cb_data)
+/* Memory used by the normal grid's cells, i.e. the scrollback */
+static void
+print_cell_memory(const struct terminal *term)
 {
-    return NULL;
-}
-
+    const struct grid *grid = &term->normal;
+    size_t bytes = 0;
 
-void search_selection_cancelled(struct terminal *term) {}
+    for (int r = 0; r < grid->num_rows; r++) {
+        const struct row *row = grid->rows[r];
+        if (row == NULL)
+            continue;
 
-void get_current_modifiers(const struct seat *seat,
-                           xkb_mod_mask_t *effective,
-                           xkb_mod_mask_t *consumed, uint32_t key,
-                           bool filter_locked) {}
-
-static struct key_binding_set kbd;
-static bool kbd_initialized = false;
-
-struct key_binding_set *
-key_binding_for(
-    struct key_binding_manager *mgr, const struct config *conf,
-    const struct seat *seat)
-{
-    return &kbd;
-}
-
-void
-key_binding_new_for_conf(
-    struct key_binding_manager *mgr, const struct wayland *wayl,
-    const struct config *conf)
-{
-    if (!kbd_initialized) {
-        kbd_initialized = true;
-        kbd = (struct key_binding_set){
-            .key = tll_init(),
-            .search = tll_init(),
-            .url = tll_init(),
-            .mouse = tll_init(),
-            .selection_overrides = 0,
-        };
+        bytes += row->cells != NULL
+            ? grid->num_cols * sizeof(row->cells[0])
+            : row->packed_size;
     }
-}
 
-void
-key_binding_unref(struct key_binding_manager *mgr, const struct config *conf)
-{
+#if defined(FOOT_COMPACT_CELLS)
+    const struct attr_palette *palette = &term->attrs_palette;
+    bytes += palette->allocated * sizeof(palette->values[0]) +
+             palette->size * sizeof(palette->slots[0]);
+
+    printf("  cells: %.1f KiB (%zu bytes/cell, %u palette entries)\n",
+           bytes / 1024., sizeof(struct cell), palette->count);
+#else
+    printf("  cells: %.1f KiB (%zu bytes/cell)\n",
+           bytes / 1024., sizeof(struct cell));
+#endif
 }
 
 int
@@ -408,6 +209,9 @@ main(int argc, const char *const *argv)
         printf("Feeding VT parser with %s (%lld bytes)\n",
                argv[i], (long long)st.st_size);
 
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
         while (lseek(mem_fd, 0, SEEK_CUR) < st.st_size) {
             if (!fdm_ptmx(NULL, -1, EPOLLIN, &term)) {
                 fprintf(stderr, "error: fdm_ptmx() failed\n");
@@ -415,6 +219,18 @@ main(int argc, const char *const *argv)
                 goto out;
             }
         }
+
+        struct timespec stop;
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+
+        const double elapsed =
+            (double)(stop.tv_sec - start.tv_sec) +
+            (double)(stop.tv_nsec - start.tv_nsec) / 1000000000.;
+
+        printf("  %.3fs, %.1f MB/s\n",
+               elapsed, (double)st.st_size / elapsed / 1000000.);
+        print_cell_memory(&term);
+
         close(mem_fd);
     }
 
@@ -424,12 +240,16 @@ out:
     tll_free(wayl.terms);
 
     for (int i = 0; i < grid_row_count; i++) {
-        if (normal_rows[i] != NULL)
+        if (normal_rows[i] != NULL) {
             free(normal_rows[i]->cells);
+            free(normal_rows[i]->packed);
+        }
         free(normal_rows[i]);
 
-        if (alt_rows[i] != NULL)
+        if (alt_rows[i] != NULL) {
             free(alt_rows[i]->cells);
+            free(alt_rows[i]->packed);
+        }
         free(alt_rows[i]);
     }
 
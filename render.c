@@ -1,10 +1,12 @@
 #include "render.h"
 
+#include <inttypes.h>
 #include <limits.h>
 #include <signal.h>
 #include <string.h>
 #include <unistd.h>
 
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
 #include <sys/time.h>
 #include <sys/timerfd.h>
@@ -222,11 +224,59 @@ static const struct wp_presentation_feedback_listener presentation_feedback_list
     .discarded = &discarded,
 };
 
+static inline int
+attrs_to_font_idx(const struct attributes *attrs)
+{
+    return attrs->italic << 1 | attrs->bold;
+}
+
 static struct fcft_font *
 attrs_to_font(const struct terminal *term, const struct attributes *attrs)
 {
-    int idx = attrs->italic << 1 | attrs->bold;
-    return term->fonts[idx];
+    return term->fonts[attrs_to_font_idx(attrs)];
+}
+
+static const struct fcft_glyph *
+glyph_lookup(const struct terminal *term, struct glyph_lookup_cache *cache,
+             int font_idx, char32_t wc)
+{
+    const enum fcft_subpixel subpixel = term->font_subpixel;
+    const struct fcft_glyph **slot;
+
+    if (likely(wc < ALEN(cache->ascii[0]))) {
+        if (unlikely(cache->ascii_subpixel != subpixel)) {
+            memset(cache->ascii, 0, sizeof(cache->ascii));
+            cache->ascii_subpixel = subpixel;
+        }
+
+        slot = &cache->ascii[font_idx][wc];
+        if (likely(*slot != NULL)) {
+            cache->hits++;
+            return *slot;
+        }
+    } else {
+        const size_t idx =
+            (wc * 4 + font_idx) & (ALEN(cache->entries) - 1);
+
+        struct glyph_lookup_entry *entry = &cache->entries[idx];
+        if (entry->glyph != NULL &&
+            entry->wc == wc &&
+            entry->font_idx == font_idx &&
+            entry->subpixel == subpixel)
+        {
+            cache->hits++;
+            return entry->glyph;
+        }
+
+        entry->wc = wc;
+        entry->font_idx = font_idx;
+        entry->subpixel = subpixel;
+        slot = &entry->glyph;
+    }
+
+    cache->misses++;
+    *slot = fcft_rasterize_char_utf32(term->fonts[font_idx], wc, subpixel);
+    return *slot;
 }
 
 static pixman_color_t
@@ -338,6 +388,153 @@ color_brighten(const struct terminal *term, uint32_t color)
     return color_blend_towards(color, 0x00ffffff, term->conf->bold_in_bright.amount);
 }
 
+/*
+ * Re-computes the palette cache, if the palette (or anything else
+ * affecting the cached colors) has changed since the last frame.
+ *
+ * Must be called from the main thread, before any rendering threads
+ * are started.
+ */
+static void
+palette_cache_update(struct terminal *term, bool srgb)
+{
+    struct palette_cache *cache = &term->render.palette;
+    const struct color_theme *theme = term_theme_get(term);
+
+    if (likely(cache->valid &&
+               cache->srgb == srgb &&
+               cache->alpha == term->colors.alpha &&
+               cache->fg == term->colors.fg &&
+               cache->bg == term->colors.bg &&
+               cache->theme == theme &&
+               memcmp(cache->table, term->colors.table,
+                      sizeof(cache->table)) == 0))
+    {
+        return;
+    }
+
+    cache->valid = true;
+    cache->srgb = srgb;
+    cache->alpha = term->colors.alpha;
+    cache->fg = term->colors.fg;
+    cache->bg = term->colors.bg;
+    cache->theme = theme;
+    memcpy(cache->table, term->colors.table, sizeof(cache->table));
+
+    for (size_t i = 0; i < PALETTE_CACHE_SIZE; i++) {
+        const uint32_t color =
+            i == PALETTE_CACHE_FG ? term->colors.fg :
+            i == PALETTE_CACHE_BG ? term->colors.bg :
+            term->colors.table[i];
+
+        cache->hex[PALETTE_NORMAL][i] = color;
+        cache->hex[PALETTE_DIM][i] = color_dim(term, color);
+        cache->hex[PALETTE_BRIGHT][i] = color_brighten(term, color);
+
+        for (size_t v = 0; v < PALETTE_VARIANT_COUNT; v++)
+            cache->pixman[v][i] = color_hex_to_pixman(cache->hex[v][i], srgb);
+
+        cache->pixman_alpha[i] = color_hex_to_pixman_with_alpha(
+            color, term->colors.alpha, srgb);
+    }
+}
+
+/* Converts an RGB color, via the calling thread's LRU cache */
+static pixman_color_t
+color_lru_to_pixman(struct color_lru *lru, uint32_t color, uint16_t alpha,
+                    bool srgb)
+{
+    color &= 0x00ffffff;
+
+    size_t i;
+    for (i = 0; i < lru->count; i++) {
+        if (lru->entries[i].color == color &&
+            lru->entries[i].alpha == alpha &&
+            lru->entries[i].srgb == srgb)
+        {
+            break;
+        }
+    }
+
+    if (i == lru->count) {
+        /* Miss; evict the least recently used entry */
+        if (lru->count < ALEN(lru->entries))
+            lru->count++;
+        i = lru->count - 1;
+
+        lru->entries[i].color = color;
+        lru->entries[i].alpha = alpha;
+        lru->entries[i].srgb = srgb;
+        lru->entries[i].pixman = color_hex_to_pixman_with_alpha(color, alpha, srgb);
+    }
+
+    /* Move to front */
+    if (i > 0) {
+        const struct color_lru_entry entry = lru->entries[i];
+        memmove(&lru->entries[1], &lru->entries[0], i * sizeof(lru->entries[0]));
+        lru->entries[0] = entry;
+    }
+
+    return lru->entries[0].pixman;
+}
+
+static inline bool
+pixman_color_equal(const pixman_color_t *a, const pixman_color_t *b)
+{
+    return a->red == b->red && a->green == b->green &&
+           a->blue == b->blue && a->alpha == b->alpha;
+}
+
+/* Returns a (borrowed) solid-fill image, from the calling thread's cache */
+static pixman_image_t *
+solid_fill_get(struct solid_fill_cache *cache, const pixman_color_t *color)
+{
+    const uint32_t hash =
+        ((color->red * 31u + color->green) * 31u + color->blue) * 31u +
+        color->alpha;
+
+    struct solid_fill_entry *entry =
+        &cache->entries[hash & (ALEN(cache->entries) - 1)];
+
+    if (likely(entry->pix != NULL && pixman_color_equal(&entry->color, color)))
+        return entry->pix;
+
+    if (entry->pix != NULL)
+        pixman_image_unref(entry->pix);
+
+    entry->color = *color;
+    entry->pix = pixman_image_create_solid_fill(color);
+    return entry->pix;
+}
+
+/*
+ * Like pixman_image_fill_rectangles(PIXMAN_OP_SRC, ...).
+ *
+ * pixman only fills 8-bit formats directly. For all other formats
+ * (e.g. the 10- and 16-bit formats used with gamma-correct blending),
+ * it instantiates, and destroys, a solid-fill image on each call. We
+ * use a cached one instead.
+ */
+static void
+fill_solid_rectangles(struct solid_fill_cache *cache, pixman_image_t *pix,
+                      const pixman_color_t *color, int count,
+                      const pixman_rectangle16_t *rects)
+{
+    const pixman_format_code_t fmt = pixman_image_get_format(pix);
+
+    if (cache == NULL || fmt == PIXMAN_a8r8g8b8 || fmt == PIXMAN_x8r8g8b8) {
+        pixman_image_fill_rectangles(PIXMAN_OP_SRC, pix, color, count, rects);
+        return;
+    }
+
+    pixman_image_t *src = solid_fill_get(cache, color);
+    for (int i = 0; i < count; i++) {
+        pixman_image_composite32(
+            PIXMAN_OP_SRC, src, NULL, pix, 0, 0, 0, 0,
+            rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+    }
+}
+
 static void
 draw_hollow_block(const struct terminal *term, pixman_image_t *pix,
                   const pixman_color_t *color, int x, int y, int cell_cols)
@@ -400,7 +597,7 @@ draw_underline_cursor(const struct terminal *term, pixman_image_t *pix,
 
 static void
 draw_underline(const struct terminal *term, pixman_image_t *pix,
-               const struct fcft_font *font,
+               struct solid_fill_cache *fills, const struct fcft_font *font,
                const pixman_color_t *color, int x, int y, int cols)
 {
     const int thickness = term->conf->underline_thickness.px >= 0
@@ -412,14 +609,15 @@ draw_underline(const struct terminal *term, pixman_image_t *pix,
     const int y_ofs = min(underline_offset(term, font),
                           term->cell_height - thickness);
 
-    pixman_image_fill_rectangles(
-        PIXMAN_OP_SRC, pix, color,
+    fill_solid_rectangles(
+        fills, pix, color,
         1, &(pixman_rectangle16_t){
             x, y + y_ofs, cols * term->cell_width, thickness});
 }
 
 static void
 draw_styled_underline(const struct terminal *term, pixman_image_t *pix,
+                      struct solid_fill_cache *fills,
                       const struct fcft_font *font,
                       const pixman_color_t *color,
                       enum underline_style style, int x, int y, int cols)
@@ -427,7 +625,7 @@ draw_styled_underline(const struct terminal *term, pixman_image_t *pix,
     xassert(style != UNDERLINE_NONE);
 
     if (style == UNDERLINE_SINGLE) {
-        draw_underline(term, pix, font, color, x, y, cols);
+        draw_underline(term, pix, fills, font, color, x, y, cols);
         return;
     }
 
@@ -466,7 +664,7 @@ draw_styled_underline(const struct terminal *term, pixman_image_t *pix,
         const pixman_rectangle16_t rects[] = {
             {x, y + y_ofs, ceil_w, thickness},
             {x, y + y_ofs + thickness * 2, ceil_w, thickness}};
-        pixman_image_fill_rectangles(PIXMAN_OP_SRC, pix, color, 2, rects);
+        fill_solid_rectangles(fills, pix, color, 2, rects);
         break;
     }
 
@@ -477,8 +675,7 @@ draw_styled_underline(const struct terminal *term, pixman_image_t *pix,
             {x, y + y_ofs, dash_w, thickness},
             {x + dash_w * 2, y + y_ofs, dash_w, thickness},
         };
-        pixman_image_fill_rectangles(
-            PIXMAN_OP_SRC, pix, color, 2, rects);
+        fill_solid_rectangles(fills, pix, color, 2, rects);
         break;
     }
 
@@ -517,7 +714,7 @@ draw_styled_underline(const struct terminal *term, pixman_image_t *pix,
             dot_x += thickness + spacing[i];
         }
 
-        pixman_image_fill_rectangles(PIXMAN_OP_SRC, pix, color, per_cell, rects);
+        fill_solid_rectangles(fills, pix, color, per_cell, rects);
         break;
     }
 
@@ -558,7 +755,10 @@ draw_styled_underline(const struct terminal *term, pixman_image_t *pix,
 #endif
         };
 
-        pixman_image_t *fill = pixman_image_create_solid_fill(color);
+        pixman_image_t *fill = fills != NULL
+            ? pixman_image_ref(solid_fill_get(fills, color))
+            : pixman_image_create_solid_fill(color);
+
         pixman_composite_trapezoids(
             PIXMAN_OP_OVER, fill, pix, PIXMAN_a8, 0, 0, 0, 0,
             sizeof(traps) / sizeof(traps[0]), traps);
@@ -576,7 +776,7 @@ draw_styled_underline(const struct terminal *term, pixman_image_t *pix,
 
 static void
 draw_strikeout(const struct terminal *term, pixman_image_t *pix,
-               const struct fcft_font *font,
+               struct solid_fill_cache *fills, const struct fcft_font *font,
                const pixman_color_t *color, int x, int y, int cols)
 {
     const int thickness = term->conf->strikeout_thickness.px >= 0
@@ -589,8 +789,8 @@ draw_strikeout(const struct terminal *term, pixman_image_t *pix,
         ? font->strikeout.position - round(font->strikeout.thickness / 2.) + round(thickness / 2.)
         : font->strikeout.position;
 
-    pixman_image_fill_rectangles(
-        PIXMAN_OP_SRC, pix, color,
+    fill_solid_rectangles(
+        fills, pix, color,
         1, &(pixman_rectangle16_t){
             x, y + term->font_baseline - position,
             cols * term->cell_width, thickness});
@@ -691,18 +891,350 @@ draw_cursor(const struct terminal *term, const struct cell *cell,
     }
 }
 
+/*
+ * Horizontal run of damaged pixels, within a single cell row. Cells
+ * are rendered one at a time, but adjacent cells are added to the
+ * damage region as a single rectangle.
+ */
+struct damage_run {
+    pixman_region32_t *region;
+    int y;
+    int height;
+    int x1;
+    int x2;  /* x1 == x2: empty */
+};
+
+static inline void
+damage_run_init(struct damage_run *run, pixman_region32_t *region,
+                int y, int height)
+{
+    *run = (struct damage_run){
+        .region = region,
+        .y = y,
+        .height = height,
+    };
+}
+
+static inline void
+damage_run_flush(struct damage_run *run)
+{
+    if (run->x1 == run->x2)
+        return;
+
+    pixman_region32_union_rect(
+        run->region, run->region,
+        run->x1, run->y, run->x2 - run->x1, run->height);
+    run->x1 = run->x2 = 0;
+}
+
+static inline void
+damage_run_add(struct damage_run *run, int x, int width)
+{
+    const int x2 = x + width;
+
+    if (run->x1 != run->x2 && x <= run->x2 && x2 >= run->x1) {
+        /* Adjacent to, or overlapping, the current run */
+        run->x1 = min(run->x1, x);
+        run->x2 = max(run->x2, x2);
+        return;
+    }
+
+    damage_run_flush(run);
+    run->x1 = x;
+    run->x2 = x2;
+}
+
+/*
+ * Batched rendering of "simple" cells (no cursor, no decorations, and
+ * glyphs that fit inside the area the cell is allowed to render to):
+ * adjacent backgrounds with the same color are merged into a single
+ * fill, and consecutive glyphs with the same color are composited
+ * with a single pixman_composite_glyphs_no_mask() call, through a
+ * per-thread pixman glyph cache.
+ *
+ * Cells are rendered right-to-left. Since a batched glyph never
+ * reaches into a cell to its left, pending backgrounds are always
+ * filled before pending glyphs, and all pending work is flushed
+ * before a non-batched cell is rendered, the end result is the same
+ * as when rendering one cell at a time.
+ */
+struct row_batch {
+    pixman_image_t *pix;
+    pixman_glyph_cache_t *glyph_cache;
+    struct solid_fill_cache *fills;
+    int y;
+    int height;
+
+    /* Pending background fill */
+    pixman_color_t bg;
+    int bg_x1;
+    int bg_x2;  /* bg_x1 == bg_x2: empty */
+
+    /* Pending glyphs, all with the same color */
+    pixman_color_t fg;
+    size_t glyph_count;
+    pixman_glyph_t glyphs[128];
+};
+
+static void
+row_batch_flush_bg(struct row_batch *batch)
+{
+    if (batch->bg_x1 == batch->bg_x2)
+        return;
+
+    fill_solid_rectangles(
+        batch->fills, batch->pix, &batch->bg, 1,
+        &(pixman_rectangle16_t){
+            batch->bg_x1, batch->y,
+            batch->bg_x2 - batch->bg_x1, batch->height});
+
+    batch->bg_x1 = batch->bg_x2 = 0;
+}
+
+static void
+row_batch_flush(struct row_batch *batch)
+{
+    row_batch_flush_bg(batch);
+
+    if (batch->glyph_count == 0)
+        return;
+
+    pixman_composite_glyphs_no_mask(
+        PIXMAN_OP_OVER, solid_fill_get(batch->fills, &batch->fg), batch->pix,
+        0, 0, 0, 0, batch->glyph_cache, batch->glyph_count, batch->glyphs);
+
+    batch->glyph_count = 0;
+}
+
+static void
+row_batch_add_bg(struct row_batch *batch, const pixman_color_t *bg,
+                 int x, int width)
+{
+    if (batch->bg_x1 != batch->bg_x2 &&
+        x + width == batch->bg_x1 &&
+        pixman_color_equal(bg, &batch->bg))
+    {
+        batch->bg_x1 = x;
+        return;
+    }
+
+    row_batch_flush_bg(batch);
+    batch->bg = *bg;
+    batch->bg_x1 = x;
+    batch->bg_x2 = x + width;
+}
+
+static void
+row_batch_add_glyph(struct row_batch *batch, const pixman_color_t *fg,
+                    void *font_key, const struct fcft_glyph *glyph,
+                    int x, int y)
+{
+    if (batch->glyph_count > 0 &&
+        (batch->glyph_count >= ALEN(batch->glyphs) ||
+         !pixman_color_equal(fg, &batch->fg)))
+    {
+        row_batch_flush(batch);
+    }
+
+    const void *cached = pixman_glyph_cache_lookup(
+        batch->glyph_cache, font_key, (void *)glyph);
+
+    if (cached == NULL) {
+        cached = pixman_glyph_cache_insert(
+            batch->glyph_cache, font_key, (void *)glyph, 0, 0, glyph->pix);
+
+        if (unlikely(cached == NULL)) {
+            /* Out of memory - render it directly */
+            row_batch_flush(batch);
+            pixman_image_composite32(
+                PIXMAN_OP_OVER, solid_fill_get(batch->fills, fg), glyph->pix,
+                batch->pix, 0, 0, 0, 0, x, y, glyph->width, glyph->height);
+            return;
+        }
+    }
+
+    batch->fg = *fg;
+    batch->glyphs[batch->glyph_count++] = (pixman_glyph_t){
+        .x = x,
+        .y = y,
+        .glyph = cached,
+    };
+}
+
+/*
+ * Copies the damaged areas of the last frame to the new buffer.
+ *
+ * The clip region is reset afterwards; the batched row rendering
+ * (fills and glyph composites) does not set a clip of its own, and
+ * would otherwise only update the cells inside the last frame's
+ * damage.
+ */
+static void
+preapply_copy_damage(pixman_image_t *dst, pixman_image_t *src,
+                     pixman_region32_t *dmg, int width, int height)
+{
+    pixman_image_set_clip_region32(dst, dmg);
+    pixman_image_composite32(
+        PIXMAN_OP_SRC, src, NULL, dst, 0, 0, 0, 0, 0, 0, width, height);
+    pixman_image_set_clip_region32(dst, NULL);
+}
+
+UNITTEST
+{
+    /*
+     * Render a batched row into a buffer that has had the last
+     * frame's damage pre-applied, and verify the whole row was
+     * updated, not only the part inside the old damage.
+     */
+    enum { width = 8, height = 2 };
+    uint32_t last_data[width * height];
+    uint32_t data[width * height];
+
+    for (size_t i = 0; i < ALEN(last_data); i++) {
+        last_data[i] = 0xffff0000;
+        data[i] = 0;
+    }
+
+    pixman_image_t *last = pixman_image_create_bits_no_clear(
+        PIXMAN_a8r8g8b8, width, height, last_data, width * sizeof(uint32_t));
+    pixman_image_t *pix = pixman_image_create_bits_no_clear(
+        PIXMAN_a8r8g8b8, width, height, data, width * sizeof(uint32_t));
+
+    pixman_region32_t dmg;
+    pixman_region32_init_rect(&dmg, 0, 0, 2, height);
+    preapply_copy_damage(pix, last, &dmg, width, height);
+    pixman_region32_fini(&dmg);
+
+    xassert(data[0] == 0xffff0000);
+    xassert(data[width - 1] == 0);
+
+    struct row_batch batch = {.pix = pix, .y = 0, .height = height};
+    const pixman_color_t blue = {.blue = 0xffff, .alpha = 0xffff};
+    for (int x = width - 1; x >= 0; x--)
+        row_batch_add_bg(&batch, &blue, x, 1);
+    row_batch_flush(&batch);
+
+    for (size_t i = 0; i < ALEN(data); i++)
+        xassert(data[i] == 0xff0000ff);
+
+    pixman_image_unref(pix);
+    pixman_image_unref(last);
+}
+
+/*
+ * Adds the cell to the row batch, if it can be batched. Otherwise,
+ * flushes the batch (the cell will be rendered directly), and returns
+ * false.
+ */
+static bool
+row_batch_add_cell(struct terminal *term, struct row_batch *batch,
+                   const struct cell *cell, const struct attributes *attrs,
+                   bool has_cursor, bool draw_glyphs, struct fcft_font *font,
+                   const struct fcft_glyph **glyphs, unsigned glyph_count,
+                   const struct composed *composed,
+                   const pixman_color_t *fg, const pixman_color_t *bg,
+                   int x, int y, int cell_cols, int render_width)
+{
+    if (has_cursor ||
+        attrs->underline ||
+        attrs->strikethrough ||
+        (cell->attrs.url && term->conf->url.style != UNDERLINE_NONE) ||
+        composed != NULL)
+    {
+        goto no_batch;
+    }
+
+    if (!draw_glyphs)
+        glyph_count = 0;
+
+    struct {
+        const struct fcft_glyph *glyph;
+        int x;
+        int y;
+    } positioned[4];
+
+    if (glyph_count > ALEN(positioned))
+        goto no_batch;
+
+    /* Glyph positions; must match the non-batched path in render_cell() */
+    size_t count = 0;
+    int pen_x = x;
+    for (unsigned i = 0; i < glyph_count; i++) {
+        const int letter_x_ofs = i == 0 ? term->font_x_ofs : 0;
+
+        const struct fcft_glyph *glyph = glyphs[i];
+        if (glyph == NULL)
+            continue;
+
+        if (glyph->is_color_glyph)
+            goto no_batch;
+
+        /* Component alpha (subpixel antialiased) glyphs aren't
+         * composited correctly without a mask */
+        const pixman_format_code_t fmt = pixman_image_get_format(glyph->pix);
+        if (fmt != PIXMAN_a8 && fmt != PIXMAN_a1)
+            goto no_batch;
+
+        int g_x = glyph->x;
+        if (i > 0 && glyph->x >= 0 && cell_cols == 1)
+            g_x -= term->cell_width;
+
+        const int gx = pen_x + letter_x_ofs + g_x;
+        const int gy = y + term->font_baseline - glyph->y;
+
+        /* Must not draw outside the cell's render area (which is
+         * otherwise enforced with a clip region) */
+        if (gx < x || gx + glyph->width > x + render_width ||
+            gy < y || gy + glyph->height > y + term->cell_height)
+        {
+            goto no_batch;
+        }
+
+        positioned[count].glyph = glyph;
+        positioned[count].x = gx;
+        positioned[count].y = gy;
+        count++;
+
+        pen_x += cell_cols > 1 ? term->cell_width : glyph->advance.x;
+    }
+
+    row_batch_add_bg(batch, bg, x, cell_cols * term->cell_width);
+
+    for (size_t i = 0; i < count; i++) {
+        row_batch_add_glyph(
+            batch, fg, font, positioned[i].glyph,
+            positioned[i].x, positioned[i].y);
+    }
+
+    return true;
+
+no_batch:
+    row_batch_flush(batch);
+    return false;
+}
+
 static int
 render_cell(struct terminal *term, pixman_image_t *pix,
-            pixman_region32_t *damage, struct row *row, int row_no, int col,
+            struct damage_run *damage, struct row_batch *batch,
+            int thread_idx, struct row *row, int row_no, int col,
             bool has_cursor)
 {
     struct cell *cell = &row->cells[col];
     if (cell->attrs.clean)
         return 0;
 
+    struct glyph_lookup_cache *lookup =
+        &term->render.workers.glyph_lookup[thread_idx];
+    struct color_lru *color_lru = &term->render.workers.color_lru[thread_idx];
+    struct solid_fill_cache *fills =
+        &term->render.workers.solid_fills[thread_idx];
+    const struct palette_cache *palette = &term->render.palette;
+
     cell->attrs.clean = 1;
     cell->attrs.confined = true;
 
+    const struct attributes attrs = term_cell_attrs(term, cell);
+
     int width = term->cell_width;
     int height = term->cell_height;
     const int x = term->margins.left + col * width;
@@ -711,45 +1243,55 @@ render_cell(struct terminal *term, pixman_image_t *pix,
     uint32_t _fg = 0;
     uint32_t _bg = 0;
 
+    /* Palette cache indices, or -1 if not a palette/default color */
+    int fg_idx = -1;
+    int bg_idx = -1;
+
     uint16_t alpha = 0xffff;
     const bool is_selected = cell->attrs.selected;
 
     /* Use cell specific color, if set, otherwise the default colors (possible reversed) */
-    switch (cell->attrs.fg_src) {
+    switch (attrs.fg_src) {
     case COLOR_RGB:
-        _fg = cell->attrs.fg;
+        _fg = attrs.fg;
         break;
 
     case COLOR_BASE16:
     case COLOR_BASE256:
-        xassert(cell->attrs.fg < ALEN(term->colors.table));
-        _fg = term->colors.table[cell->attrs.fg];
+        xassert(attrs.fg < ALEN(term->colors.table));
+        _fg = term->colors.table[attrs.fg];
+        fg_idx = attrs.fg;
         break;
 
     case COLOR_DEFAULT:
         _fg = term->reverse ? term->colors.bg : term->colors.fg;
+        fg_idx = term->reverse ? PALETTE_CACHE_BG : PALETTE_CACHE_FG;
         break;
     }
 
-    switch (cell->attrs.bg_src) {
+    switch (attrs.bg_src) {
     case COLOR_RGB:
-        _bg = cell->attrs.bg;
+        _bg = attrs.bg;
         break;
 
     case COLOR_BASE16:
     case COLOR_BASE256:
-        xassert(cell->attrs.bg < ALEN(term->colors.table));
-        _bg = term->colors.table[cell->attrs.bg];
+        xassert(attrs.bg < ALEN(term->colors.table));
+        _bg = term->colors.table[attrs.bg];
+        bg_idx = attrs.bg;
         break;
 
     case COLOR_DEFAULT:
         _bg = term->reverse ? term->colors.fg : term->colors.bg;
+        bg_idx = term->reverse ? PALETTE_CACHE_FG : PALETTE_CACHE_BG;
         break;
     }
 
     if (unlikely(is_selected)) {
         const uint32_t cell_fg = _fg;
         const uint32_t cell_bg = _bg;
+        const int cell_fg_idx = fg_idx;
+        const int cell_bg_idx = bg_idx;
 
         const bool custom_fg = term->colors.selection_fg >> 24 == 0;
         const bool custom_bg = term->colors.selection_bg >> 24 == 0;
@@ -758,46 +1300,58 @@ render_cell(struct terminal *term, pixman_image_t *pix,
         if (custom_both) {
             _fg = term->colors.selection_fg;
             _bg = term->colors.selection_bg;
+            fg_idx = bg_idx = -1;
         } else if (custom_bg) {
             _bg = term->colors.selection_bg;
-            _fg = cell->attrs.reverse ? cell_bg : cell_fg;
+            _fg = attrs.reverse ? cell_bg : cell_fg;
+            bg_idx = -1;
+            fg_idx = attrs.reverse ? cell_bg_idx : cell_fg_idx;
         } else if (custom_fg) {
             _fg = term->colors.selection_fg;
-            _bg = cell->attrs.reverse ? cell_fg : cell_bg;
+            _bg = attrs.reverse ? cell_fg : cell_bg;
+            fg_idx = -1;
+            bg_idx = attrs.reverse ? cell_fg_idx : cell_bg_idx;
         } else {
             _bg = cell_fg;
             _fg = cell_bg;
+            bg_idx = cell_fg_idx;
+            fg_idx = cell_bg_idx;
         }
 
         if (unlikely(_fg == _bg)) {
             /* Invert bg when selected/highlighted text has same fg/bg */
             _bg = ~_bg;
+            bg_idx = -1;
             alpha = 0xffff;
         }
 
     } else {
-        if (unlikely(cell->attrs.reverse)) {
+        if (unlikely(attrs.reverse)) {
             uint32_t swap = _fg;
             _fg = _bg;
             _bg = swap;
+
+            int swap_idx = fg_idx;
+            fg_idx = bg_idx;
+            bg_idx = swap_idx;
         }
 
         else if (!term->window->is_fullscreen && term->colors.alpha != 0xffff) {
             switch (term->conf->colors_dark.alpha_mode) {
             case ALPHA_MODE_DEFAULT: {
-                if (cell->attrs.bg_src == COLOR_DEFAULT) {
+                if (attrs.bg_src == COLOR_DEFAULT) {
                     alpha = term->colors.alpha;
                 }
                 break;
             }
 
             case ALPHA_MODE_MATCHING: {
-                if (cell->attrs.bg_src == COLOR_DEFAULT ||
-                    ((cell->attrs.bg_src == COLOR_BASE16 ||
-                      cell->attrs.bg_src == COLOR_BASE256) &&
-                     term->colors.table[cell->attrs.bg] == term->colors.bg) ||
-                    (cell->attrs.bg_src == COLOR_RGB &&
-                     cell->attrs.bg == term->colors.bg))
+                if (attrs.bg_src == COLOR_DEFAULT ||
+                    ((attrs.bg_src == COLOR_BASE16 ||
+                      attrs.bg_src == COLOR_BASE256) &&
+                     term->colors.table[attrs.bg] == term->colors.bg) ||
+                    (attrs.bg_src == COLOR_RGB &&
+                     attrs.bg == term->colors.bg))
                 {
                     alpha = term->colors.alpha;
                 }
@@ -844,19 +1398,49 @@ render_cell(struct terminal *term, pixman_image_t *pix,
         }
     }
 
-    if (cell->attrs.dim)
-        _fg = color_dim(term, _fg);
-    if (term->conf->bold_in_bright.enabled && cell->attrs.bold)
-        _fg = color_brighten(term, _fg);
+    /* Pre-computed dim/bright variants, for palette colors */
+    enum palette_variant fg_variant = PALETTE_NORMAL;
+
+    if (attrs.dim) {
+        if (fg_idx >= 0) {
+            fg_variant = PALETTE_DIM;
+            _fg = palette->hex[fg_variant][fg_idx];
+        } else
+            _fg = color_dim(term, _fg);
+    }
+
+    if (term->conf->bold_in_bright.enabled && attrs.bold) {
+        if (fg_idx >= 0 && fg_variant == PALETTE_NORMAL) {
+            fg_variant = PALETTE_BRIGHT;
+            _fg = palette->hex[fg_variant][fg_idx];
+        } else {
+            _fg = color_brighten(term, _fg);
+            fg_idx = -1;
+        }
+    }
 
-    if (cell->attrs.blink && term->blink.state == BLINK_OFF)
+    if (attrs.blink && term->blink.state == BLINK_OFF) {
         _fg = color_blend_towards(_fg, 0x00000000, term->conf->dim.amount);
+        fg_idx = -1;
+    }
 
     const bool gamma_correct = wayl_do_linear_blending(term->wl, term->conf);
-    pixman_color_t fg = color_hex_to_pixman(_fg, gamma_correct);
-    pixman_color_t bg = color_hex_to_pixman_with_alpha(_bg, alpha, gamma_correct);
+    xassert(palette->valid && palette->srgb == gamma_correct);
+
+    pixman_color_t fg = fg_idx >= 0
+        ? palette->pixman[fg_variant][fg_idx]
+        : color_lru_to_pixman(color_lru, _fg, 0xffff, gamma_correct);
 
-    struct fcft_font *font = attrs_to_font(term, &cell->attrs);
+    pixman_color_t bg;
+    if (bg_idx >= 0 && alpha == 0xffff)
+        bg = palette->pixman[PALETTE_NORMAL][bg_idx];
+    else if (bg_idx >= 0 && alpha == palette->alpha)
+        bg = palette->pixman_alpha[bg_idx];
+    else
+        bg = color_lru_to_pixman(color_lru, _bg, alpha, gamma_correct);
+
+    const int font_idx = attrs_to_font_idx(&attrs);
+    struct fcft_font *font = term->fonts[font_idx];
     const struct composed *composed = NULL;
     const struct fcft_grapheme *grapheme = NULL;
     const struct fcft_glyph *single = NULL;
@@ -942,7 +1526,7 @@ render_cell(struct terminal *term, pixman_image_t *pix,
 
         else if (base >= CELL_COMB_CHARS_LO && base <= CELL_COMB_CHARS_HI)
         {
-            composed = composed_lookup(term->composed, base - CELL_COMB_CHARS_LO);
+            composed = composed_lookup(&term->composed, base - CELL_COMB_CHARS_LO);
             base = composed->chars[0];
 
             if (term->conf->can_shape_grapheme && term->conf->tweak.grapheme_shaping) {
@@ -970,7 +1554,7 @@ render_cell(struct terminal *term, pixman_image_t *pix,
                 cell_cols = 1;
             } else {
                 xassert(base != 0);
-                single = fcft_rasterize_char_utf32(font, base, term->font_subpixel);
+                single = glyph_lookup(term, lookup, font_idx, base);
                 if (single == NULL) {
                     glyph_count = 0;
                     cell_cols = 1;
@@ -1014,43 +1598,50 @@ render_cell(struct terminal *term, pixman_image_t *pix,
         }
     }
 
+    if (damage != NULL)
+        damage_run_add(damage, x, render_width);
+
+    if (attrs.blink && term->blink.fd < 0) {
+        /* TODO: use a custom lock for this? */
+        mtx_lock(&term->render.workers.lock);
+        term_arm_blink_timer(term);
+        mtx_unlock(&term->render.workers.lock);
+    }
+
+    const bool draw_glyphs =
+        !(cell->wc == 0 || cell->wc >= CELL_SPACER || cell->wc == U'\t' ||
+          (unlikely(attrs.conceal) && !is_selected));
+
+    if (batch != NULL &&
+        row_batch_add_cell(
+            term, batch, cell, &attrs, has_cursor, draw_glyphs, font,
+            glyphs, glyph_count, composed, &fg, &bg, x, y, cell_cols,
+            render_width))
+    {
+        return cell_cols;
+    }
+
     pixman_region32_t clip;
     pixman_region32_init_rect(
         &clip, x, y,
         render_width, term->cell_height);
     pixman_image_set_clip_region32(pix, &clip);
-
-    if (damage != NULL) {
-        pixman_region32_union_rect(
-            damage, damage, x, y, render_width, term->cell_height);
-    }
-
     pixman_region32_fini(&clip);
 
     /* Background */
-    pixman_image_fill_rectangles(
-        PIXMAN_OP_SRC, pix, &bg, 1,
+    fill_solid_rectangles(
+        fills, pix, &bg, 1,
         &(pixman_rectangle16_t){x, y, cell_cols * width, height});
 
-    if (cell->attrs.blink && term->blink.fd < 0) {
-        /* TODO: use a custom lock for this? */
-        mtx_lock(&term->render.workers.lock);
-        term_arm_blink_timer(term);
-        mtx_unlock(&term->render.workers.lock);
-    }
-
     if (unlikely(has_cursor && term->cursor_style == CURSOR_BLOCK && term->kbd_focus)) {
         const pixman_color_t bg_without_alpha = color_hex_to_pixman(_bg, gamma_correct);
         draw_cursor(term, cell, font, pix, &fg, &bg_without_alpha, x, y, cell_cols);
     }
 
-    if (cell->wc == 0 || cell->wc >= CELL_SPACER || cell->wc == U'\t' ||
-        (unlikely(cell->attrs.conceal) && !is_selected))
-    {
+    if (!draw_glyphs)
         goto draw_cursor;
-    }
 
-    pixman_image_t *clr_pix = pixman_image_create_solid_fill(&fg);
+    pixman_image_t *clr_pix = solid_fill_get(fills, &fg);
 
     int pen_x = x;
     for (unsigned i = 0; i < glyph_count; i++) {
@@ -1068,7 +1659,7 @@ render_cell(struct terminal *term, pixman_image_t *pix,
 
         if (unlikely(glyph->is_color_glyph)) {
             /* Glyph surface is a pre-rendered image (typically a color emoji...) */
-            if (!(cell->attrs.blink && term->blink.state == BLINK_OFF)) {
+            if (!(attrs.blink && term->blink.state == BLINK_OFF)) {
                 pixman_image_composite32(
                     PIXMAN_OP_OVER, glyph->pix, NULL, pix, 0, 0, 0, 0,
                     pen_x + letter_x_ofs + g_x, y + term->font_baseline - g_y,
@@ -1130,10 +1721,8 @@ render_cell(struct terminal *term, pixman_image_t *pix,
         pen_x += cell_cols > 1 ? term->cell_width : glyph->advance.x;
     }
 
-    pixman_image_unref(clr_pix);
-
     /* Underline */
-    if (cell->attrs.underline) {
+    if (attrs.underline) {
         pixman_color_t underline_color = fg;
         enum underline_style underline_style = UNDERLINE_SINGLE;
 
@@ -1173,12 +1762,13 @@ render_cell(struct terminal *term, pixman_image_t *pix,
         }
 
         draw_styled_underline(
-            term, pix, font, &underline_color, underline_style, x, y, cell_cols);
+            term, pix, fills, font, &underline_color, underline_style,
+            x, y, cell_cols);
 
     }
 
-    if (cell->attrs.strikethrough)
-        draw_strikeout(term, pix, font, &fg, x, y, cell_cols);
+    if (attrs.strikethrough)
+        draw_strikeout(term, pix, fills, font, &fg, x, y, cell_cols);
 
     if (unlikely(cell->attrs.url && term->conf->url.style != UNDERLINE_NONE)) {
         pixman_color_t url_color = color_hex_to_pixman(
@@ -1188,7 +1778,7 @@ render_cell(struct terminal *term, pixman_image_t *pix,
             gamma_correct);
 
         draw_styled_underline(
-            term, pix, font, &url_color, term->conf->url.style,
+            term, pix, fills, font, &url_color, term->conf->url.style,
             x, y, cell_cols);
     }
 
@@ -1205,10 +1795,54 @@ draw_cursor:
 static void
 render_row(struct terminal *term, pixman_image_t *pix,
            pixman_region32_t *damage, struct row *row,
-           int row_no, int cursor_col)
+           int row_no, int cursor_col, int thread_idx)
 {
-    for (int col = term->cols - 1; col >= 0; col--)
-        render_cell(term, pix, damage, row, row_no, col, cursor_col == col);
+    struct damage_run run;
+    damage_run_init(
+        &run, damage, term->margins.top + row_no * term->cell_height,
+        term->cell_height);
+
+    pixman_glyph_cache_t **glyph_cache =
+        &term->render.workers.glyph_caches[thread_idx];
+
+    if (unlikely(*glyph_cache == NULL)) {
+        *glyph_cache = pixman_glyph_cache_create();
+        if (*glyph_cache == NULL)
+            LOG_WARN("failed to instantiate glyph cache");
+    }
+
+    /* Only cells within the row's dirty span can be dirty */
+    const int first = row->dirty_start;
+    const int last = min(row->dirty_end, term->cols - 1);
+
+    if (unlikely(*glyph_cache == NULL)) {
+        for (int col = last; col >= first; col--) {
+            render_cell(
+                term, pix, &run, NULL, thread_idx, row, row_no, col,
+                cursor_col == col);
+        }
+    } else {
+        struct row_batch batch = {
+            .pix = pix,
+            .glyph_cache = *glyph_cache,
+            .fills = &term->render.workers.solid_fills[thread_idx],
+            .y = term->margins.top + row_no * term->cell_height,
+            .height = term->cell_height,
+        };
+
+        pixman_glyph_cache_freeze(batch.glyph_cache);
+
+        for (int col = last; col >= first; col--) {
+            render_cell(
+                term, pix, &run, &batch, thread_idx, row, row_no, col,
+                cursor_col == col);
+        }
+
+        row_batch_flush(&batch);
+        pixman_glyph_cache_thaw(batch.glyph_cache);
+    }
+
+    damage_run_flush(&run);
 }
 
 static void
@@ -1314,9 +1948,198 @@ render_margin(struct terminal *term, struct buffer *buf,
     }
 }
 
+static struct scroll_calibration *
+scroll_calibration_get(struct terminal *term, const struct buffer *buf)
+{
+    struct scroll_calibration *cals = term->render.scroll.calibrations;
+    const size_t count = ALEN(term->render.scroll.calibrations);
+
+    for (size_t i = 0; i < count; i++) {
+        struct scroll_calibration *cal = &cals[i];
+        if (cal->stride == buf->stride &&
+            cal->width == buf->width &&
+            cal->height == buf->height)
+        {
+            return cal;
+        }
+    }
+
+    /* New geometry; replace the oldest entry */
+    struct scroll_calibration *cal =
+        &cals[term->render.scroll.next_calibration++ % count];
+
+    *cal = (struct scroll_calibration){
+        .width = buf->width,
+        .height = buf->height,
+        .stride = buf->stride,
+    };
+    return cal;
+}
+
+static bool
+scroll_is_calibrated(const struct scroll_calibration *cal)
+{
+    return cal->shm.samples >= SCROLL_CALIBRATION_SAMPLES &&
+           cal->memmove.samples >= SCROLL_CALIBRATION_SAMPLES;
+}
+
+/*
+ * Decides whether to SHM scroll, or memmove. 'shm_rows' and
+ * 'memmove_rows' are the number of pixel rows each strategy touches.
+ */
+static bool
+scroll_use_shm(struct terminal *term, struct buffer *buf,
+               const struct damage *dmg, int shm_rows, int memmove_rows)
+{
+    if (term->conf->tweak.scroll_strategy == SCROLL_STRATEGY_MEMMOVE ||
+        !shm_can_scroll(buf))
+    {
+        return false;
+    }
+
+    switch (term->conf->tweak.scroll_strategy) {
+    case SCROLL_STRATEGY_SHM:
+        return true;
+
+    case SCROLL_STRATEGY_MEMMOVE:
+        return false;
+
+    case SCROLL_STRATEGY_AUTO:
+        /* See the comment in grid_render_scroll() */
+        return (dmg->lines +
+                dmg->region.start +
+                (term->rows - dmg->region.end)) < term->rows / 2;
+
+    case SCROLL_STRATEGY_CALIBRATE: {
+        const struct scroll_calibration *cal =
+            scroll_calibration_get(term, buf);
+
+        if (!scroll_is_calibrated(cal)) {
+            /* Still calibrating; alternate between the strategies */
+            return cal->shm.samples <= cal->memmove.samples;
+        }
+
+        const double shm_cost =
+            (double)cal->shm.ns / cal->shm.rows * shm_rows;
+        const double memmove_cost =
+            (double)cal->memmove.ns / cal->memmove.rows * memmove_rows;
+
+        return shm_cost < memmove_cost;
+    }
+    }
+
+    BUG("unhandled scroll strategy");
+    return false;
+}
+
+static void
+scroll_account(struct terminal *term, const struct buffer *buf,
+               bool did_shm_scroll, int rows,
+               const struct timespec *start, const struct timespec *stop)
+{
+    struct timespec elapsed;
+    timespec_sub(stop, start, &elapsed);
+    const uint64_t ns = elapsed.tv_sec * 1000000000ull + elapsed.tv_nsec;
+
+    term->render.scroll.ns += ns;
+    if (did_shm_scroll)
+        term->render.scroll.shm_count++;
+    else
+        term->render.scroll.memmove_count++;
+
+    if (term->conf->tweak.scroll_strategy != SCROLL_STRATEGY_CALIBRATE ||
+        rows <= 0 || !shm_can_scroll(buf))
+    {
+        return;
+    }
+
+    struct scroll_calibration *cal = scroll_calibration_get(term, buf);
+    if (scroll_is_calibrated(cal))
+        return;
+
+    if (did_shm_scroll) {
+        cal->shm.samples++;
+        cal->shm.ns += ns;
+        cal->shm.rows += rows;
+    } else {
+        cal->memmove.samples++;
+        cal->memmove.ns += ns;
+        cal->memmove.rows += rows;
+    }
+
+    if (scroll_is_calibrated(cal)) {
+        LOG_INFO(
+            "scroll calibration (%dx%d, stride=%d): "
+            "SHM: %.2fns/row, memmove: %.2fns/row",
+            cal->width, cal->height, cal->stride,
+            (double)cal->shm.ns / cal->shm.rows,
+            (double)cal->memmove.ns / cal->memmove.rows);
+    }
+}
+
+/*
+ * Records a scroll applied to the buffer being rendered (the new
+ * last_buf), to be replayed on an older buffer when bringing it up to
+ * date with this frame (see reapply_old_damage()).
+ */
+static void
+scroll_record(struct terminal *term, struct buffer *buf,
+              const struct damage *dmg, bool reverse,
+              int src_y, int dst_y, int height)
+{
+    xassert(buf == term->render.last_buf);
+
+    if (term->render.last_scrolls.overflowed) {
+        pixman_region32_union_rect(
+            &buf->dirty[0], &buf->dirty[0], 0, dst_y, buf->width, height);
+        return;
+    }
+
+    const size_t count = term->render.last_scrolls.count;
+
+    if (count >= ALEN(term->render.last_scrolls.items)) {
+        /* Too many to replay; copy the moved areas instead */
+        for (size_t i = 0; i < count; i++) {
+            const struct buffer_scroll *s = &term->render.last_scrolls.items[i];
+            pixman_region32_union_rect(
+                &buf->dirty[0], &buf->dirty[0],
+                0, s->dst_y, buf->width, s->height);
+        }
+
+        pixman_region32_union_rect(
+            &buf->dirty[0], &buf->dirty[0], 0, dst_y, buf->width, height);
+
+        term->render.last_scrolls.count = 0;
+        term->render.last_scrolls.overflowed = true;
+        return;
+    }
+
+    term->render.last_scrolls.items[count] = (struct buffer_scroll){
+        .dmg = {
+            .type = reverse ? DAMAGE_SCROLL_REVERSE : DAMAGE_SCROLL,
+            .region = dmg->region,
+            .lines = dmg->lines,
+        },
+        .rows = term->rows,
+        .cell_height = term->cell_height,
+        .margin_top = term->margins.top,
+        .margin_bottom = term->margins.bottom,
+        .src_y = src_y,
+        .dst_y = dst_y,
+        .height = height,
+    };
+    term->render.last_scrolls.count++;
+}
+
+/*
+ * 'replay' is set when re-applying a scroll from the last frame to an
+ * older buffer (see reapply_old_damage()). The surface has already
+ * been damaged, and the scroll recorded, when the last frame was
+ * rendered.
+ */
 static void
 grid_render_scroll(struct terminal *term, struct buffer *buf,
-                   const struct damage *dmg)
+                   const struct damage *dmg, bool replay)
 {
     LOG_DBG(
         "damage: SCROLL: %d-%d by %d lines",
@@ -1332,10 +2155,8 @@ grid_render_scroll(struct terminal *term, struct buffer *buf,
     const int height = (region_size - dmg->lines) * term->cell_height;
     xassert(height > 0);
 
-#if TIME_SCROLL_DAMAGE
     struct timespec start_time;
     clock_gettime(CLOCK_MONOTONIC, &start_time);
-#endif
 
     int dst_y = term->margins.top + (dmg->region.start + 0) * term->cell_height;
     int src_y = term->margins.top + (dmg->region.start + dmg->lines) * term->cell_height;
@@ -1372,12 +2193,19 @@ grid_render_scroll(struct terminal *term, struct buffer *buf,
      *
      * If the total number of lines is less than half the screen - use
      * SHM. Otherwise use memmove.
+     *
+     * Since the relative cost of the two methods depends on the
+     * machine, buffer size and stride, tweak.scroll-strategy=calibrate
+     * instead measures the cost of both, per buffer geometry, and
+     * picks the cheapest one based on that.
      */
+    const int shm_rows =
+        (dmg->lines +
+         dmg->region.start +
+         (term->rows - dmg->region.end)) * term->cell_height;
+
     bool try_shm_scroll =
-        shm_can_scroll(buf) && (
-            dmg->lines +
-            dmg->region.start +
-            (term->rows - dmg->region.end)) < term->rows / 2;
+        scroll_use_shm(term, buf, dmg, shm_rows, height);
 
     bool did_shm_scroll = false;
 
@@ -1403,10 +2231,16 @@ grid_render_scroll(struct terminal *term, struct buffer *buf,
                 height * buf->stride);
     }
 
-#if TIME_SCROLL_DAMAGE
     struct timespec end_time;
     clock_gettime(CLOCK_MONOTONIC, &end_time);
 
+    /* A failed SHM scroll attempt skews the timing; don't calibrate on it */
+    const int rows_touched =
+        did_shm_scroll ? shm_rows : try_shm_scroll ? 0 : height;
+    scroll_account(
+        term, buf, did_shm_scroll, rows_touched, &start_time, &end_time);
+
+#if TIME_SCROLL_DAMAGE
     struct timespec memmove_time;
     timespec_sub(&end_time, &start_time, &memmove_time);
     LOG_INFO("scrolled %dKB (%d lines) using %s in %lds %ldns",
@@ -1415,21 +2249,19 @@ grid_render_scroll(struct terminal *term, struct buffer *buf,
              (long)memmove_time.tv_sec, memmove_time.tv_nsec);
 #endif
 
+    if (replay)
+        return;
+
     wl_surface_damage_buffer(
         term->window->surface.surf, term->margins.left, dst_y,
         term->width - term->margins.left - term->margins.right, height);
 
-    /*
-     * TODO: remove this if re-enabling scroll damage when re-applying
-     * last frame's damage (see reapply_old_damage()
-     */
-    pixman_region32_union_rect(
-        &buf->dirty[0], &buf->dirty[0], 0, dst_y, buf->width, height);
+    scroll_record(term, buf, dmg, false, src_y, dst_y, height);
 }
 
 static void
 grid_render_scroll_reverse(struct terminal *term, struct buffer *buf,
-                           const struct damage *dmg)
+                           const struct damage *dmg, bool replay)
 {
     LOG_DBG(
         "damage: SCROLL REVERSE: %d-%d by %d lines",
@@ -1445,19 +2277,19 @@ grid_render_scroll_reverse(struct terminal *term, struct buffer *buf,
     const int height = (region_size - dmg->lines) * term->cell_height;
     xassert(height > 0);
 
-#if TIME_SCROLL_DAMAGE
     struct timespec start_time;
     clock_gettime(CLOCK_MONOTONIC, &start_time);
-#endif
 
     int src_y = term->margins.top + (dmg->region.start + 0) * term->cell_height;
     int dst_y = term->margins.top + (dmg->region.start + dmg->lines) * term->cell_height;
 
+    const int shm_rows =
+        (dmg->lines +
+         dmg->region.start +
+         (term->rows - dmg->region.end)) * term->cell_height;
+
     bool try_shm_scroll =
-        shm_can_scroll(buf) && (
-            dmg->lines +
-            dmg->region.start +
-            (term->rows - dmg->region.end)) < term->rows / 2;
+        scroll_use_shm(term, buf, dmg, shm_rows, height);
 
     bool did_shm_scroll = false;
 
@@ -1480,10 +2312,16 @@ grid_render_scroll_reverse(struct terminal *term, struct buffer *buf,
                 height * buf->stride);
     }
 
-#if TIME_SCROLL_DAMAGE
     struct timespec end_time;
     clock_gettime(CLOCK_MONOTONIC, &end_time);
 
+    /* A failed SHM scroll attempt skews the timing; don't calibrate on it */
+    const int rows_touched =
+        did_shm_scroll ? shm_rows : try_shm_scroll ? 0 : height;
+    scroll_account(
+        term, buf, did_shm_scroll, rows_touched, &start_time, &end_time);
+
+#if TIME_SCROLL_DAMAGE
     struct timespec memmove_time;
     timespec_sub(&end_time, &start_time, &memmove_time);
     LOG_INFO("scrolled REVERSE %dKB (%d lines) using %s in %lds %ldns",
@@ -1492,16 +2330,135 @@ grid_render_scroll_reverse(struct terminal *term, struct buffer *buf,
              (long)memmove_time.tv_sec, memmove_time.tv_nsec);
 #endif
 
+    if (replay)
+        return;
+
     wl_surface_damage_buffer(
         term->window->surface.surf, term->margins.left, dst_y,
         term->width - term->margins.left - term->margins.right, height);
 
+    scroll_record(term, buf, dmg, true, src_y, dst_y, height);
+}
+
+/* Renders, and drops, the scroll damage; returns the number of buffer moves */
+static uint32_t UNUSED
+unittest_render_scroll_damage(struct terminal *term, struct buffer *buf)
+{
+    const uint32_t moves = term->render.scroll.memmove_count;
+
+    tll_foreach(term->grid->scroll_damage, it) {
+        /* Replay; there's no surface to damage */
+        if (it->item.type == DAMAGE_SCROLL ||
+            it->item.type == DAMAGE_SCROLL_IN_VIEW)
+        {
+            grid_render_scroll(term, buf, &it->item, true);
+        } else
+            grid_render_scroll_reverse(term, buf, &it->item, true);
+
+        tll_remove(term->grid->scroll_damage, it);
+    }
+
+    return term->render.scroll.memmove_count - moves;
+}
+
+UNITTEST
+{
     /*
-     * TODO: remove this if re-enabling scroll damage when re-applying
-     * last frame's damage (see reapply_old_damage()
+     * Scrolling past the scroll region results in a full repaint
+     * (i.e. no buffer moves) instead of a buffer move per scroll.
      */
-    pixman_region32_union_rect(
-        &buf->dirty[0], &buf->dirty[0], 0, dst_y, buf->width, height);
+    enum { rows = 24 };
+    const struct scroll_region full = {.start = 0, .end = rows};
+    const struct scroll_region partial = {.start = 2, .end = 10};
+
+    struct config conf = {
+        .tweak = {.scroll_strategy = SCROLL_STRATEGY_MEMMOVE},
+    };
+    struct terminal term = {
+        .conf = &conf,
+        .rows = rows,
+        .cell_height = 1,
+        .normal = {.scroll_damage = tll_init()},
+    };
+    term.grid = &term.normal;
+
+    /* One pixel row per terminal row, holding its row number */
+    uint8_t data[rows];
+    for (int r = 0; r < rows; r++)
+        data[r] = r;
+
+    struct buffer buf = {
+        .width = 1,
+        .height = rows,
+        .stride = 1,
+        .data = data,
+    };
+
+    /* A couple of linefeeds at the bottom of the screen */
+    for (int i = 0; i < 5; i++)
+        term_damage_scroll(&term, DAMAGE_SCROLL, full, 1);
+
+    xassert(unittest_render_scroll_damage(&term, &buf) == 1);
+    xassert(data[0] == 5);
+    xassert(data[rows - 6] == rows - 1);
+
+    /* Lots of linefeeds; the whole screen is scrolled out */
+    for (int i = 0; i < 100000; i++)
+        term_damage_scroll(&term, DAMAGE_SCROLL, full, 1);
+
+    xassert(unittest_render_scroll_damage(&term, &buf) == 0);
+
+    /* Different regions, and directions, are all moved... */
+    for (int i = 0; i < 3; i++)
+        term_damage_scroll(&term, DAMAGE_SCROLL, partial, 1);
+    term_damage_scroll(&term, DAMAGE_SCROLL_REVERSE, partial, 1);
+    term_damage_scroll(&term, DAMAGE_SCROLL_IN_VIEW, full, 1);
+    term_damage_scroll(&term, DAMAGE_SCROLL, full, 1);
+
+    xassert(unittest_render_scroll_damage(&term, &buf) == 4);
+
+    /* ...unless the whole screen is scrolled out afterwards */
+    for (int i = 0; i < 3; i++)
+        term_damage_scroll(&term, DAMAGE_SCROLL, partial, 1);
+    term_damage_scroll(&term, DAMAGE_SCROLL_IN_VIEW, full, 1);
+    for (int i = 0; i < rows; i++)
+        term_damage_scroll(&term, DAMAGE_SCROLL, full, 1);
+
+    xassert(unittest_render_scroll_damage(&term, &buf) == 1);
+    xassert(tll_length(term.grid->scroll_damage) == 0);
+}
+
+/*
+ * Replays the scrolls applied to the last frame (see scroll_record())
+ * on 'buf', an older buffer. Render worker threads always memmove,
+ * since SHM scrolling re-creates the buffer's wayland objects, and
+ * repaints the window margins.
+ */
+static void
+replay_last_scrolls(struct terminal *term, struct buffer *buf,
+                    bool main_thread)
+{
+    for (size_t i = 0; i < term->render.last_scrolls.count; i++) {
+        const struct buffer_scroll *s = &term->render.last_scrolls.items[i];
+
+        const bool same_geometry =
+            s->rows == term->rows &&
+            s->cell_height == term->cell_height &&
+            s->margin_top == term->margins.top &&
+            s->margin_bottom == term->margins.bottom;
+
+        if (main_thread && same_geometry) {
+            if (s->dmg.type == DAMAGE_SCROLL)
+                grid_render_scroll(term, buf, &s->dmg, true);
+            else
+                grid_render_scroll_reverse(term, buf, &s->dmg, true);
+        } else {
+            uint8_t *raw = buf->data;
+            memmove(raw + s->dst_y * buf->stride,
+                    raw + s->src_y * buf->stride,
+                    s->height * buf->stride);
+        }
+    }
 }
 
 static void
@@ -1618,7 +2575,7 @@ render_sixel(struct terminal *term, pixman_image_t *pix,
         }
 
         /* Is the row dirty? */
-        struct row *row = term->grid->rows[abs_row_no];
+        struct row *row = grid_row_unpacked(term->grid, abs_row_no);
         xassert(row != NULL);  /* Should be visible */
 
         if (!row->dirty) {
@@ -1644,8 +2601,14 @@ render_sixel(struct terminal *term, pixman_image_t *pix,
          */
         if (!sixel->opaque) {
             /* TODO: multithreading */
-            render_row(term, pix, damage, row, term_row_no, cursor_col);
+            render_row(term, pix, damage, row, term_row_no, cursor_col, 0);
         } else {
+            struct damage_run run;
+            damage_run_init(
+                &run, damage,
+                term->margins.top + term_row_no * term->cell_height,
+                term->cell_height);
+
             for (int col = sixel->pos.col;
                  col < min(sixel->pos.col + sixel->cols, term->cols);
                  col++)
@@ -1659,13 +2622,16 @@ render_sixel(struct terminal *term, pixman_image_t *pix,
                     if ((last_row_needs_erase && last_row) ||
                         (last_col_needs_erase && last_col))
                     {
-                        render_cell(term, pix, damage, row, term_row_no, col, cursor_col == col);
+                        render_cell(term, pix, &run, NULL, 0, row,
+                                    term_row_no, col, cursor_col == col);
                     } else {
                         cell->attrs.clean = 1;
                         cell->attrs.confined = 1;
                     }
                 }
             }
+
+            damage_run_flush(&run);
         }
 
         if (chunk_term_start == -1) {
@@ -1817,7 +2783,7 @@ render_ime_preedit_for_seat(struct terminal *term, struct seat *seat,
         real_cells[i] = row->cells[col_idx + i];
         real_cells[i].attrs.clean = 0;
     }
-    row->dirty = true;
+    grid_row_dirty(row);
 
     /* Render pre-edit text */
     xassert(seat->ime.preedit.cells[ime_ofs].wc < CELL_SPACER);
@@ -1832,7 +2798,9 @@ render_ime_preedit_for_seat(struct terminal *term, struct seat *seat,
             break;
 
         row->cells[col_idx + i] = *cell;
-        render_cell(term, buf->pix[0], NULL, row, row_idx, col_idx + i, false);
+        render_cell(
+            term, buf->pix[0], NULL, NULL, 0, row, row_idx, col_idx + i,
+            false);
     }
 
     int start = seat->ime.preedit.cursor.start - ime_ofs;
@@ -1854,7 +2822,8 @@ render_ime_preedit_for_seat(struct terminal *term, struct seat *seat,
         if (end == start) {
             /* Bar */
             if (start >= 0) {
-                struct fcft_font *font = attrs_to_font(term, &start_cell->attrs);
+                const struct attributes attrs = term_cell_attrs(term, start_cell);
+                struct fcft_font *font = attrs_to_font(term, &attrs);
                 draw_beam_cursor(term, buf->pix[0], font, &cursor_color, x, y);
             }
             term_ime_set_cursor_rect(term, x, y, 1, term->cell_height);
@@ -2179,11 +3148,40 @@ render_overlay(struct terminal *term)
     term->render.last_overlay_style = style;
 }
 
-int
+/*
+ * Render worker pool. Either private to a terminal, or, in server
+ * mode, shared by all terminals.
+ *
+ * Terminals submit jobs to a FIFO queue. A rows job is picked up by
+ * all workers (one job entry, 'takers_left' times), and is done when
+ * each of them has posted the terminal's 'done' semaphore. A
+ * pre-apply damage job is picked up by a single worker.
+ *
+ * Since jobs are executed in submission order, frames from different
+ * terminals are scheduled fairly, and a terminal can't starve the
+ * others.
+ */
+struct render_pool {
+    uint16_t count;
+    thrd_t *threads;
+
+    mtx_t lock;
+    cnd_t cond;
+    struct render_job *head;
+    struct render_job *tail;
+    bool exit;
+};
+
+struct render_worker_context {
+    struct render_pool *pool;
+    int my_id;
+};
+
+static int
 render_worker_thread(void *_ctx)
 {
     struct render_worker_context *ctx = _ctx;
-    struct terminal *term = ctx->term;
+    struct render_pool *pool = ctx->pool;
     const int my_id = ctx->my_id;
     free(ctx);
 
@@ -2197,107 +3195,230 @@ render_worker_thread(void *_ctx)
     if (pthread_setname_np(pthread_self(), proc_title) < 0)
         LOG_ERRNO("render worker %d: failed to set process title", my_id);
 
-    sem_t *start = &term->render.workers.start;
-    sem_t *done = &term->render.workers.done;
-    mtx_t *lock = &term->render.workers.lock;
-
     while (true) {
-        sem_wait(start);
-
-        struct buffer *buf = term->render.workers.buf;
-
-        bool frame_done = false;
+        mtx_lock(&pool->lock);
+        while (pool->head == NULL && !pool->exit)
+            cnd_wait(&pool->cond, &pool->lock);
+
+        struct render_job *job = pool->head;
+        if (job == NULL) {
+            xassert(pool->exit);
+            mtx_unlock(&pool->lock);
+            return 0;
+        }
 
-        /* Translate offset-relative cursor row to view-relative */
-        struct coord cursor = {-1, -1};
-        if (!term->hide_cursor) {
-            cursor = term->grid->cursor.point;
-            cursor.row += term->grid->offset;
-            cursor.row -= term->grid->view;
-            cursor.row &= term->grid->num_rows - 1;
+        xassert(job->takers_left > 0);
+        if (--job->takers_left == 0) {
+            pool->head = job->next;
+            if (pool->head == NULL)
+                pool->tail = NULL;
+            job->next = NULL;
         }
+        mtx_unlock(&pool->lock);
+
+        struct terminal *term = job->term;
+
+        switch (job->kind) {
+        case RENDER_JOB_ROWS: {
+            struct buffer *buf = term->render.workers.buf;
+            const int *rows = term->render.workers.rows;
+            const int row_count = term->render.workers.row_count;
+            const int batch_size = term->render.workers.batch_size;
+            atomic_int *next_row = &term->render.workers.next_row;
+
+            /* Translate offset-relative cursor row to view-relative */
+            struct coord cursor = {-1, -1};
+            if (!term->hide_cursor) {
+                cursor = term->grid->cursor.point;
+                cursor.row += term->grid->offset;
+                cursor.row -= term->grid->view;
+                cursor.row &= term->grid->num_rows - 1;
+            }
+
+            while (true) {
+                const int first = atomic_fetch_add_explicit(
+                    next_row, batch_size, memory_order_relaxed);
 
-        while (!frame_done) {
-            mtx_lock(lock);
-            xassert(tll_length(term->render.workers.queue) > 0);
+                if (first >= row_count)
+                    break;
 
-            int row_no = tll_pop_front(term->render.workers.queue);
-            mtx_unlock(lock);
+                const int last = min(first + batch_size, row_count);
 
-            switch (row_no) {
-            default: {
-                struct row *row = grid_row_in_view(term->grid, row_no);
-                int cursor_col = cursor.row == row_no ? cursor.col : -1;
+                for (int i = first; i < last; i++) {
+                    const int row_no = rows[i];
+                    struct row *row = grid_row_in_view(term->grid, row_no);
+                    int cursor_col = cursor.row == row_no ? cursor.col : -1;
 
-                render_row(term, buf->pix[my_id], &buf->dirty[my_id],
-                           row, row_no, cursor_col);
-                break;
+                    render_row(term, buf->pix[my_id], &buf->dirty[my_id],
+                               row, row_no, cursor_col, my_id);
+                }
             }
 
-            case -1:
-                frame_done = true;
-                sem_post(done);
-                break;
-
-            case -2:
-                return 0;
+            sem_post(&term->render.workers.done);
+            break;
+        }
 
-            case -3: {
-                if (term->conf->tweak.render_timer != RENDER_TIMER_NONE)
-                    clock_gettime(CLOCK_MONOTONIC, &term->render.workers.preapplied_damage.start);
+        case RENDER_JOB_PREAPPLY_DAMAGE: {
+            if (term->conf->tweak.render_timer != RENDER_TIMER_NONE)
+                clock_gettime(CLOCK_MONOTONIC, &term->render.workers.preapplied_damage.start);
 
-                mtx_lock(&term->render.workers.preapplied_damage.lock);
-                buf = term->render.workers.preapplied_damage.buf;
-                xassert(buf != NULL);
-
-                if (likely(term->render.last_buf != NULL)) {
-                    mtx_unlock(&term->render.workers.preapplied_damage.lock);
-
-                    pixman_region32_t dmg;
-                    pixman_region32_init(&dmg);
-
-                    if (buf->age == 0)
-                        ; /* No need to do anything */
-                    else if (buf->age == 1)
-                        pixman_region32_copy(&dmg,
-                                             &term->render.last_buf->dirty[0]);
-                    else
-                        pixman_region32_init_rect(&dmg, 0, 0, buf->width,
-                                                  buf->height);
-
-                    pixman_image_set_clip_region32(buf->pix[my_id], &dmg);
-                    pixman_image_composite32(PIXMAN_OP_SRC,
-                                             term->render.last_buf->pix[my_id],
-                                             NULL, buf->pix[my_id], 0, 0, 0, 0, 0,
-                                             0, buf->width, buf->height);
-
-                    pixman_region32_fini(&dmg);
-
-                    buf->age = 0;
-                    shm_unref(term->render.last_buf);
-                    shm_addref(buf);
-                    term->render.last_buf = buf;
-
-                    mtx_lock(&term->render.workers.preapplied_damage.lock);
-                }
+            mtx_lock(&term->render.workers.preapplied_damage.lock);
+            struct buffer *buf = term->render.workers.preapplied_damage.buf;
+            xassert(buf != NULL);
 
-                term->render.workers.preapplied_damage.buf = NULL;
-                cnd_signal(&term->render.workers.preapplied_damage.cond);
+            if (likely(term->render.last_buf != NULL)) {
                 mtx_unlock(&term->render.workers.preapplied_damage.lock);
 
-                if (term->conf->tweak.render_timer != RENDER_TIMER_NONE)
-                    clock_gettime(CLOCK_MONOTONIC, &term->render.workers.preapplied_damage.stop);
+                pixman_region32_t dmg;
+                pixman_region32_init(&dmg);
 
-                frame_done = true;
-                break;
-            }
+                if (buf->age == 0)
+                    ; /* No need to do anything */
+                else if (buf->age == 1) {
+                    replay_last_scrolls(term, buf, false);
+                    pixman_region32_copy(&dmg,
+                                         &term->render.last_buf->dirty[0]);
+                } else
+                    pixman_region32_init_rect(&dmg, 0, 0, buf->width,
+                                              buf->height);
+
+                preapply_copy_damage(buf->pix[my_id],
+                                     term->render.last_buf->pix[my_id],
+                                     &dmg, buf->width, buf->height);
+
+                pixman_region32_fini(&dmg);
+
+                buf->age = 0;
+                shm_unref(term->render.last_buf);
+                shm_addref(buf);
+                term->render.last_buf = buf;
+
+                mtx_lock(&term->render.workers.preapplied_damage.lock);
             }
+
+            if (term->conf->tweak.render_timer != RENDER_TIMER_NONE)
+                clock_gettime(CLOCK_MONOTONIC, &term->render.workers.preapplied_damage.stop);
+
+            /* Last access to 'term' - it may be destroyed as soon as
+             * we've signalled (when the pool is shared) */
+            term->render.workers.preapplied_damage.buf = NULL;
+            cnd_signal(&term->render.workers.preapplied_damage.cond);
+            mtx_unlock(&term->render.workers.preapplied_damage.lock);
+            break;
         }
-    };
+        }
+    }
 
     return -1;
 }
 
+static void
+render_pool_submit(struct render_pool *pool, struct render_job *job,
+                   uint16_t takers)
+{
+    xassert(takers > 0);
+    xassert(job->next == NULL);
+
+    mtx_lock(&pool->lock);
+    job->takers_left = takers;
+
+    if (pool->tail != NULL)
+        pool->tail->next = job;
+    else
+        pool->head = job;
+    pool->tail = job;
+
+    if (takers > 1)
+        cnd_broadcast(&pool->cond);
+    else
+        cnd_signal(&pool->cond);
+    mtx_unlock(&pool->lock);
+}
+
+struct render_pool *
+render_pool_new(uint16_t count)
+{
+    xassert(count > 0);
+
+    struct render_pool *pool = xmalloc(sizeof(*pool));
+    *pool = (struct render_pool){
+        .count = count,
+        .threads = xcalloc(count, sizeof(pool->threads[0])),
+    };
+
+    int err;
+    if ((err = mtx_init(&pool->lock, mtx_plain)) != thrd_success) {
+        LOG_ERR("failed to instantiate render worker mutex: %s (%d)",
+                thrd_err_as_string(err), err);
+        goto err_free;
+    }
+
+    if ((err = cnd_init(&pool->cond)) != thrd_success) {
+        LOG_ERR("failed to instantiate render worker condition variable: "
+                "%s (%d)", thrd_err_as_string(err), err);
+        mtx_destroy(&pool->lock);
+        goto err_free;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        struct render_worker_context *ctx = xmalloc(sizeof(*ctx));
+        *ctx = (struct render_worker_context) {
+            .pool = pool,
+            .my_id = 1 + i,
+        };
+
+        int ret = thrd_create(&pool->threads[i], &render_worker_thread, ctx);
+        if (ret != thrd_success) {
+            LOG_ERR("failed to create render worker thread: %s (%d)",
+                    thrd_err_as_string(ret), ret);
+            free(ctx);
+            pool->threads[i] = 0;
+            render_pool_destroy(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+
+err_free:
+    free(pool->threads);
+    free(pool);
+    return NULL;
+}
+
+void
+render_pool_destroy(struct render_pool *pool)
+{
+    if (pool == NULL)
+        return;
+
+    /* Workers exit when there are no more queued jobs */
+    mtx_lock(&pool->lock);
+    pool->exit = true;
+    cnd_broadcast(&pool->cond);
+    mtx_unlock(&pool->lock);
+
+    /* We may get here when only some of the threads have been
+     * successfully started */
+    for (size_t i = 0; i < pool->count; i++) {
+        if (pool->threads[i] == 0)
+            break;
+        thrd_join(pool->threads[i], NULL);
+    }
+
+    xassert(pool->head == NULL);
+    cnd_destroy(&pool->cond);
+    mtx_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool);
+}
+
+uint16_t
+render_pool_count(const struct render_pool *pool)
+{
+    return pool->count;
+}
+
 void
 render_wait_for_preapply_damage(struct terminal *term)
 {
@@ -2314,6 +3435,27 @@ render_wait_for_preapply_damage(struct terminal *term)
     mtx_unlock(&term->render.workers.preapplied_damage.lock);
 }
 
+size_t
+render_trim_buffers(struct terminal *term)
+{
+    /* The pre-apply worker may be using one of our buffers */
+    render_wait_for_preapply_damage(term);
+
+    /* Next frame is a full repaint */
+    shm_unref(term->render.last_buf);
+    term->render.last_buf = NULL;
+    term->render.last_overlay_buf = NULL;
+
+    return
+        shm_chain_trim(term->render.chains.grid) +
+        shm_chain_trim(term->render.chains.search) +
+        shm_chain_trim(term->render.chains.scrollback_indicator) +
+        shm_chain_trim(term->render.chains.render_timer) +
+        shm_chain_trim(term->render.chains.url) +
+        shm_chain_trim(term->render.chains.csd) +
+        shm_chain_trim(term->render.chains.overlay);
+}
+
 struct csd_data
 get_csd_data(const struct terminal *term, enum csd_surface surf_idx)
 {
@@ -3141,13 +4283,15 @@ render_scrollback_position(struct terminal *term)
 }
 
 static void
-render_render_timer(struct terminal *term, struct timespec render_time)
+render_render_timer(struct terminal *term, struct timespec render_time,
+                    double glyph_hit_rate)
 {
     struct wl_window *win = term->window;
 
     char usecs_str[256];
     double usecs = render_time.tv_sec * 1000000 + render_time.tv_nsec / 1000.0;
-    snprintf(usecs_str, sizeof(usecs_str), "%.2f µs", usecs);
+    snprintf(usecs_str, sizeof(usecs_str), "%.2f µs, %.0f%% glyph hits",
+             usecs, glyph_hit_rate);
 
     char32_t text[256];
     mbstoc32(text, usecs_str, ALEN(text));
@@ -3232,16 +4376,18 @@ reapply_old_damage(struct terminal *term, struct buffer *new, struct buffer *old
             continue;
         }
 
-        bool row_all_dirty = true;
-        for (int c = 0; c < term->cols; c++) {
-            if (row->cells[c].attrs.clean) {
+        /* A partially dirty span means (some) cells are clean */
+        bool row_all_dirty =
+            row->dirty_start == 0 && row->dirty_end >= term->cols - 1;
+
+        for (int c = 0; row_all_dirty && c < term->cols; c++) {
+            if (row->cells[c].attrs.clean)
                 row_all_dirty = false;
-                full_repaint_needed = false;
-                break;
-            }
         }
 
-        if (row_all_dirty) {
+        if (!row_all_dirty)
+            full_repaint_needed = false;
+        else {
             pixman_region32_union_rect(
                 &dirty, &dirty,
                 term->margins.left,
@@ -3257,13 +4403,11 @@ reapply_old_damage(struct terminal *term, struct buffer *new, struct buffer *old
     }
 
     /*
-     * TODO: re-apply last frame's scroll damage
-     *
-     * We used to do this, but it turned out to be buggy. If we decide
-     * to re-add it, this is where to do it. Note that we'd also have
-     * to remove the updates to buf->dirty from grid_render_scroll()
-     * and grid_render_scroll_reverse().
+     * Re-apply last frame's scrolls. The scrolled areas are not part
+     * of the old frame's damage; only the newly exposed rows are (and
+     * are copied below).
      */
+    replay_last_scrolls(term, new, true);
 
     if (tll_length(term->grid->scroll_damage) == 0) {
         /*
@@ -3293,11 +4437,15 @@ reapply_old_damage(struct terminal *term, struct buffer *new, struct buffer *old
 static void
 dirty_old_cursor(struct terminal *term)
 {
-    if (term->render.last_cursor.row != NULL && !term->render.last_cursor.hidden) {
+    if (term->render.last_cursor.row != NULL &&
+        !term->render.last_cursor.hidden &&
+        term->render.last_cursor.row->cells != NULL)  /* Packed rows are all dirty */
+    {
         struct row *row = term->render.last_cursor.row;
         struct cell *cell = &row->cells[term->render.last_cursor.col];
         cell->attrs.clean = 0;
-        row->dirty = true;
+        grid_row_dirty_cols(
+            row, term->render.last_cursor.col, term->render.last_cursor.col);
     }
 
     /* Remember current cursor position, for the next frame */
@@ -3317,7 +4465,7 @@ dirty_cursor(struct terminal *term)
     struct row *row = grid_row(term->grid, cursor->row);
     struct cell *cell = &row->cells[cursor->col];
     cell->attrs.clean = 0;
-    row->dirty = true;
+    grid_row_dirty_cols(row, cursor->col, cursor->col);
 }
 
 static void
@@ -3345,6 +4493,8 @@ grid_render(struct terminal *term)
     xassert(term->width > 0);
     xassert(term->height > 0);
 
+    palette_cache_update(term, wayl_do_linear_blending(term->wl, term->conf));
+
     struct buffer_chain *chain = term->render.chains.grid;
     struct buffer *buf = shm_get_buffer(chain, term->width, term->height);
 
@@ -3401,26 +4551,30 @@ grid_render(struct terminal *term)
     term->render.last_buf = buf;
     shm_addref(buf);
     buf->age = 0;
+    term->render.frame_count++;
+
+    term->render.last_scrolls.count = 0;
+    term->render.last_scrolls.overflowed = false;
 
 
     tll_foreach(term->grid->scroll_damage, it) {
         switch (it->item.type) {
         case DAMAGE_SCROLL:
             if (term->grid->view == term->grid->offset)
-                grid_render_scroll(term, buf, &it->item);
+                grid_render_scroll(term, buf, &it->item, false);
             break;
 
         case DAMAGE_SCROLL_REVERSE:
             if (term->grid->view == term->grid->offset)
-                grid_render_scroll_reverse(term, buf, &it->item);
+                grid_render_scroll_reverse(term, buf, &it->item, false);
             break;
 
         case DAMAGE_SCROLL_IN_VIEW:
-            grid_render_scroll(term, buf, &it->item);
+            grid_render_scroll(term, buf, &it->item, false);
             break;
 
         case DAMAGE_SCROLL_REVERSE_IN_VIEW:
-            grid_render_scroll_reverse(term, buf, &it->item);
+            grid_render_scroll_reverse(term, buf, &it->item, false);
             break;
         }
 
@@ -3474,9 +4628,13 @@ grid_render(struct terminal *term)
             if (!row->dirty)
                 continue;
 
-            /* Loop row from left to right, looking for dirty cells */
-            for (struct cell *cell = &row->cells[0];
-                 cell < &row->cells[term->cols];
+            /* Loop row's dirty span from left to right, looking for
+             * dirty cells */
+            const struct cell *span_end =
+                &row->cells[min(row->dirty_end, term->cols - 1) + 1];
+
+            for (struct cell *cell = &row->cells[row->dirty_start];
+                 cell < span_end;
                  cell++)
             {
                 if (cell->attrs.clean)
@@ -3500,6 +4658,8 @@ grid_render(struct terminal *term)
                     if (!c->attrs.clean)
                         break;
                     c->attrs.clean = false;
+                    grid_row_dirty_cols(
+                        row, c - row->cells, c - row->cells);
                 }
 
                 /*
@@ -3517,6 +4677,8 @@ grid_render(struct terminal *term)
                  */
                 for (; cell < &row->cells[term->cols]; cell++) {
                     cell->attrs.clean = false;
+                    grid_row_dirty_cols(
+                        row, cell - row->cells, cell - row->cells);
                     if (cell->attrs.confined)
                         break;
                 }
@@ -3533,7 +4695,11 @@ grid_render(struct terminal *term)
             for (int c = 0; c < term->cols; c++) {
                 if (!row->cells[c].attrs.clean) {
                     all_clean = false;
-                    break;
+                    if (c < row->dirty_start || c > row->dirty_end) {
+                        BUG("row #%d: cell #%d is dirty, but outside the "
+                            "row's dirty span (%d-%d)",
+                            r, c, row->dirty_start, row->dirty_end);
+                    }
                 }
             }
             if (all_clean)
@@ -3553,14 +4719,7 @@ grid_render(struct terminal *term)
     render_sixel_images(term, buf->pix[0], &damage, &cursor);
 
 
-    if (term->render.workers.count > 0) {
-        mtx_lock(&term->render.workers.lock);
-        term->render.workers.buf = buf;
-        for (size_t i = 0; i < term->render.workers.count; i++)
-            sem_post(&term->render.workers.start);
-
-        xassert(tll_length(term->render.workers.queue) == 0);
-    }
+    int dirty_count = 0;
 
     for (int r = 0; r < term->rows; r++) {
         struct row *row = grid_row_in_view(term->grid, r);
@@ -3571,23 +4730,36 @@ grid_render(struct terminal *term)
         row->dirty = false;
 
         if (term->render.workers.count > 0)
-            tll_push_back(term->render.workers.queue, r);
+            term->render.workers.rows[dirty_count++] = r;
 
         else {
             /* TODO: damage region */
             int cursor_col = cursor.row == r ? cursor.col : -1;
-            render_row(term, buf->pix[0], &damage, row, r, cursor_col);
+            render_row(term, buf->pix[0], &damage, row, r, cursor_col, 0);
         }
     }
 
-    /* Signal workers the frame is done */
     if (term->render.workers.count > 0) {
-        for (size_t i = 0; i < term->render.workers.count; i++)
-            tll_push_back(term->render.workers.queue, -1);
-        mtx_unlock(&term->render.workers.lock);
+        /*
+         * Hand out the dirty rows in batches of consecutive rows,
+         * small enough to keep all workers busy until the end of the
+         * frame, but large enough to avoid contention on the cursor.
+         */
+        const int worker_count = term->render.workers.count;
 
-        for (size_t i = 0; i < term->render.workers.count; i++)
+        term->render.workers.buf = buf;
+        term->render.workers.row_count = dirty_count;
+        term->render.workers.batch_size =
+            max(1, dirty_count / (4 * worker_count));
+        atomic_store_explicit(
+            &term->render.workers.next_row, 0, memory_order_relaxed);
+
+        render_pool_submit(
+            term->render.workers.pool, &term->render.workers.rows_job,
+            worker_count);
+        for (int i = 0; i < worker_count; i++)
             sem_wait(&term->render.workers.done);
+
         term->render.workers.buf = NULL;
     }
 
@@ -3636,12 +4808,37 @@ grid_render(struct terminal *term)
         timespec_add(&render_time, &double_buffering_time, &total_render_time);
         timespec_add(&wait_time, &total_render_time, &total_render_time);
 
+        /* All rendering threads are idle; safe to collect their stats */
+        uint64_t glyph_hits = 0;
+        uint64_t glyph_misses = 0;
+        for (size_t i = 0; i < term->render.workers.count + 1; i++) {
+            struct glyph_lookup_cache *lookup =
+                &term->render.workers.glyph_lookup[i];
+
+            glyph_hits += lookup->hits;
+            glyph_misses += lookup->misses;
+            lookup->hits = lookup->misses = 0;
+        }
+
+        const double glyph_hit_rate = glyph_hits + glyph_misses > 0
+            ? 100. * glyph_hits / (glyph_hits + glyph_misses)
+            : 100.;
+
+        const uint32_t scroll_shm_count = term->render.scroll.shm_count;
+        const uint32_t scroll_memmove_count = term->render.scroll.memmove_count;
+        const uint64_t scroll_ns = term->render.scroll.ns;
+        term->render.scroll.shm_count = 0;
+        term->render.scroll.memmove_count = 0;
+        term->render.scroll.ns = 0;
+
         switch (term->conf->tweak.render_timer) {
         case RENDER_TIMER_LOG:
         case RENDER_TIMER_BOTH:
             LOG_INFO(
                 "frame rendered in %lds %9ldns "
-                "(%lds %9ldns wait, %lds %9ldns rendering, %lds %9ldns double buffering) not included: %lds %ldns pre-apply damage",
+                "(%lds %9ldns wait, %lds %9ldns rendering, %lds %9ldns double buffering) not included: %lds %ldns pre-apply damage, "
+                "glyph cache: %.1f%% hits (%"PRIu64"/%"PRIu64"), "
+                "scrolling: %"PRIu32" SHM + %"PRIu32" memmove in %"PRIu64"ns",
                 (long)total_render_time.tv_sec,
                 total_render_time.tv_nsec,
                 (long)wait_time.tv_sec,
@@ -3651,7 +4848,9 @@ grid_render(struct terminal *term)
                 (long)double_buffering_time.tv_sec,
                 double_buffering_time.tv_nsec,
                 (long)preapply_damage.tv_sec,
-                preapply_damage.tv_nsec);
+                preapply_damage.tv_nsec,
+                glyph_hit_rate, glyph_hits, glyph_hits + glyph_misses,
+                scroll_shm_count, scroll_memmove_count, scroll_ns);
             break;
 
         case RENDER_TIMER_OSD:
@@ -3662,7 +4861,7 @@ grid_render(struct terminal *term)
         switch (term->conf->tweak.render_timer) {
         case RENDER_TIMER_OSD:
         case RENDER_TIMER_BOTH:
-            render_render_timer(term, total_render_time);
+            render_render_timer(term, total_render_time, glyph_hit_rate);
             break;
 
         case RENDER_TIMER_LOG:
@@ -3936,7 +5135,7 @@ render_search_box(struct terminal *term)
                     int count = min(ime_seat->ime.preedit.count, cells_left);
 
                     /* Underline the entire (visible part of) pre-edit text */
-                    draw_underline(term, buf->pix[0], font, &fg, x, y, count);
+                    draw_underline(term, buf->pix[0], NULL, font, &fg, x, y, count);
 
                     /* Bar-styled cursor, if in the visible area */
                     if (start >= 0 && start <= visible_cells) {
@@ -3955,8 +5154,8 @@ render_search_box(struct terminal *term)
                         min(ime_seat->ime.preedit.count - ime_seat->ime.preedit.cursor.end,
                             cells_left - end),
                         0);
-                    draw_underline(term, buf->pix[0], font, &fg, x, y, count1);
-                    draw_underline(term, buf->pix[0], font, &fg, x + end * term->cell_width, y, count2);
+                    draw_underline(term, buf->pix[0], NULL, font, &fg, x, y, count1);
+                    draw_underline(term, buf->pix[0], NULL, font, &fg, x + end * term->cell_width, y, count2);
 
                     /* TODO: how do we handle a partially hidden rectangle? */
                     if (start >= 0 && end <= visible_cells) {
@@ -4374,27 +5573,334 @@ tiocswinsz(struct terminal *term)
     }
 }
 
+/*
+ * Reflowing a large scrollback is slow. Instead of doing it all on
+ * the main thread when an interactive resize is done, the logical
+ * lines on the screen are reflowed first, and become the new 'normal'
+ * grid. What happens to the rest of the scrollback depends on
+ * scrollback.reflow:
+ *
+ *   background: it is reflowed by a worker thread, while the PTY is
+ *               being consumed into the new grid, and is spliced in
+ *               above it when done.
+ *   lazy:       it is kept, as is, in term->reflow.pending, and is
+ *               reflowed one chunk of logical lines at a time, when
+ *               something needs it (scrolling, searching etc).
+ *
+ * Small scrollbacks are reflowed synchronously, as are grids with
+ * sixels, selections, or a viewport that has been scrolled up; these
+ * are all tracked by the reflow, across the entire grid.
+ */
+#define REFLOW_DEFER_MIN_ROWS 1024
+
+/* Minimum number of (old) rows to reflow, each time we lazily reflow */
+#define REFLOW_LAZY_CHUNK_ROWS 1024
+
+static int
+reflow_thread(void *data)
+{
+    struct terminal *term = data;
+
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_SETMASK, &mask, NULL);
+
+    if (pthread_setname_np(pthread_self(), "foot:reflow") < 0)
+        LOG_ERRNO("reflow worker: failed to set process title");
+
+    grid_reflow_history(
+        term->reflow.history, &term->reflow.composed,
+        term->reflow.new_rows, term->reflow.new_cols,
+        term->render.workers.count);
+
+    if (write(term->reflow.done_fd, &(uint64_t){1}, sizeof(uint64_t)) != sizeof(uint64_t))
+        LOG_ERRNO("reflow worker: failed to signal completion");
+
+    return 0;
+}
+
+static void reflow_worker_finish(struct terminal *term);
+
+static bool
+fdm_reflow_done(struct fdm *fdm, int fd, int events, void *data)
+{
+    struct terminal *term = data;
+    reflow_worker_finish(term);
+    return true;
+}
+
+void
+render_reflow_wait(struct terminal *term)
+{
+    if (!term->reflow.running)
+        return;
+
+    thrd_join(term->reflow.thread, NULL);
+    term->reflow.running = false;
+
+    fdm_del(term->fdm, term->reflow.done_fd);
+    term->reflow.done_fd = -1;
+
+    composed_free(&term->reflow.composed);
+}
+
+static void
+reflow_worker_finish(struct terminal *term)
+{
+    if (term->reflow.history == NULL)
+        return;
+
+    render_reflow_wait(term);
+
+    grid_splice_history(&term->normal, term->reflow.history);
+    free(term->reflow.history);
+    term->reflow.history = NULL;
+
+    LOG_DBG("reflowed scrollback spliced in");
+
+    /* The scrollback size changed; update e.g. the scrollback indicator */
+    if (term->grid == &term->normal) {
+        term_damage_view(term);
+        render_refresh(term);
+    }
+}
+
 static void
-delayed_reflow_of_normal_grid(struct terminal *term)
+reflow_pending_free(struct terminal *term)
 {
-    if (term->interactive_resizing.grid == NULL)
+    tll_foreach(term->reflow.pending, it) {
+        grid_free(it->item);
+        free(it->item);
+        tll_remove(term->reflow.pending, it);
+    }
+}
+
+/*
+ * Reflows the newest logical lines, at least 'min_rows' (old) rows,
+ * of the newest pending scrollback, and splices them in above the
+ * oldest row of the normal grid.
+ */
+static void
+reflow_pending_chunk(struct terminal *term, int min_rows)
+{
+    struct grid *history = tll_front(term->reflow.pending);
+
+    const bool fits = grid_reflow_history_chunk(
+        &term->normal, history, &term->composed, min_rows,
+        term->render.workers.count);
+
+    if (history->rows[history->offset] == NULL) {
+        grid_free(history);
+        free(history);
+        tll_pop_front(term->reflow.pending);
+    }
+
+    if (!fits) {
+        /* Normal grid is full; the rest of the pending scrollback
+         * would never be reachable */
+        reflow_pending_free(term);
+    }
+
+    LOG_DBG("lazily reflowed a scrollback chunk (%zu pending grids left)",
+            tll_length(term->reflow.pending));
+}
+
+bool
+render_reflow_pending(struct terminal *term, int rows)
+{
+    if (tll_length(term->reflow.pending) == 0)
+        return false;
+
+    reflow_pending_chunk(term, max(rows, REFLOW_LAZY_CHUNK_ROWS));
+    return true;
+}
+
+void
+render_reflow_finish(struct terminal *term)
+{
+    reflow_worker_finish(term);
+
+    if (tll_length(term->reflow.pending) == 0)
         return;
 
-    xassert(term->interactive_resizing.new_rows > 0);
+    do
+        reflow_pending_chunk(term, INT_MAX);
+    while (tll_length(term->reflow.pending) > 0);
+
+    if (term->grid == &term->normal) {
+        term_damage_view(term);
+        render_refresh(term);
+    }
+}
+
+void
+render_reflow_cancel(struct terminal *term)
+{
+    reflow_pending_free(term);
+
+    if (term->reflow.history == NULL)
+        return;
+
+    render_reflow_wait(term);
+
+    grid_free(term->reflow.history);
+    free(term->reflow.history);
+    term->reflow.history = NULL;
+}
 
-    struct coord *const tracking_points[] = {
-        &term->selection.coords.start,
-        &term->selection.coords.end,
+/*
+ * Splits the original grid (from before the interactive resize) into
+ * the screen, and the scrollback history, and reflows the screen
+ * part. On success, the original grid has been replaced with the
+ * reflowed screen, and the history is either being reflowed by a
+ * worker thread, or is pending a lazy reflow.
+ */
+static bool
+reflow_scrollback_deferred(struct terminal *term)
+{
+    struct grid *orig = term->interactive_resizing.grid;
+    const int old_screen_rows = term->interactive_resizing.old_screen_rows;
+    const int mask = orig->num_rows - 1;
+
+    xassert(term->reflow.history == NULL);
+
+    if (term->selection.coords.end.row >= 0 ||
+        tll_length(orig->sixel_images) > 0 ||
+        orig->view != orig->offset)
+    {
+        return false;
+    }
+
+    /* Scrollback rows, above the screen */
+    int history_rows = 0;
+    while (history_rows < orig->num_rows - old_screen_rows &&
+           orig->rows[(orig->offset - history_rows - 1) & mask] != NULL)
+    {
+        history_rows++;
+    }
+
+    /* Split at the start of the logical line at the top of the screen */
+    int split_back = 0;
+    while (split_back < history_rows &&
+           !orig->rows[(orig->offset - split_back - 1) & mask]->linebreak)
+    {
+        split_back++;
+    }
+
+    history_rows -= split_back;
+    if (history_rows < REFLOW_DEFER_MIN_ROWS)
+        return false;
+
+    const int split = (orig->offset - split_back) & mask;
+
+    /* Move the screen rows to a grid of their own */
+    struct grid screen = {
+        .num_rows = orig->num_rows,
+        .num_cols = orig->num_cols,
+        .offset = orig->offset,
+        .view = orig->offset,
+        .cursor = orig->cursor,
+        .saved_cursor = orig->saved_cursor,
+        .kitty_kbd = orig->kitty_kbd,
+        .rows = xcalloc(orig->num_rows, sizeof(screen.rows[0])),
     };
 
-    /* Reflow the original (since before the resize was started) grid,
-     * to the *current* dimensions */
+    grid_move_rows(&screen, orig, split, split_back + old_screen_rows);
+
+    /*
+     * Reflow the screen. Note that its rows are free:d to the
+     * original grid's slab; this must be done before the worker
+     * starts.
+     */
     grid_resize_and_reflow(
-        term->interactive_resizing.grid, term,
+        &screen, &term->composed,
         term->interactive_resizing.new_rows, term->normal.num_cols,
-        term->interactive_resizing.old_screen_rows, term->rows,
-        term->selection.coords.end.row >= 0 ? ALEN(tracking_points) : 0,
-        tracking_points);
+        old_screen_rows, term->rows, 0, NULL);
+
+    /* What remains of the original grid is the history */
+    orig->offset = (split - 1) & mask;
+    orig->view = orig->offset;
+
+    if (term->conf->scrollback.reflow == SCROLLBACK_REFLOW_LAZY) {
+        struct grid *history = xmalloc(sizeof(*history));
+        *history = *orig;
+        tll_push_front(term->reflow.pending, history);
+
+        *orig = screen;
+
+        LOG_DBG("deferring reflow of %d scrollback rows", history_rows);
+        return true;
+    }
+
+    int done_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (done_fd < 0)
+        LOG_ERRNO("failed to create reflow event FD");
+    else if (!fdm_add(term->fdm, done_fd, EPOLLIN, &fdm_reflow_done, term)) {
+        close(done_fd);
+        done_fd = -1;
+    }
+
+    term->reflow.history = xmalloc(sizeof(*term->reflow.history));
+    *term->reflow.history = *orig;
+    term->reflow.new_rows = term->interactive_resizing.new_rows;
+    term->reflow.new_cols = term->normal.num_cols;
+    term->reflow.done_fd = done_fd;
+    composed_snapshot(&term->reflow.composed, &term->composed);
+
+    *orig = screen;
+
+    bool started = false;
+    if (done_fd >= 0) {
+        int ret = thrd_create(&term->reflow.thread, &reflow_thread, term);
+        if (ret == thrd_success)
+            started = true;
+        else {
+            LOG_ERR("failed to create reflow worker thread: %s (%d)",
+                    thrd_err_as_string(ret), ret);
+            fdm_del(term->fdm, done_fd);
+        }
+    }
+
+    if (!started) {
+        /* Do it ourselves; it is spliced in by our caller */
+        grid_reflow_history(
+            term->reflow.history, &term->composed,
+            term->reflow.new_rows, term->reflow.new_cols,
+            term->render.workers.count);
+
+        term->reflow.done_fd = -1;
+        composed_free(&term->reflow.composed);
+        return true;
+    }
+
+    term->reflow.running = true;
+    LOG_DBG("reflowing %d scrollback rows in the background", history_rows);
+    return true;
+}
+
+static void
+delayed_reflow_of_normal_grid(struct terminal *term)
+{
+    if (term->interactive_resizing.grid == NULL)
+        return;
+
+    xassert(term->interactive_resizing.new_rows > 0);
+
+    if (!reflow_scrollback_deferred(term)) {
+        struct coord *const tracking_points[] = {
+            &term->selection.coords.start,
+            &term->selection.coords.end,
+        };
+
+        /* Reflow the original (since before the resize was started) grid,
+         * to the *current* dimensions */
+        grid_resize_and_reflow(
+            term->interactive_resizing.grid, &term->composed,
+            term->interactive_resizing.new_rows, term->normal.num_cols,
+            term->interactive_resizing.old_screen_rows, term->rows,
+            term->selection.coords.end.row >= 0 ? ALEN(tracking_points) : 0,
+            tracking_points);
+    }
 
     /* Replace the current, truncated, "normal" grid with the
      * correctly reflowed one */
@@ -4419,6 +5925,10 @@ delayed_reflow_of_normal_grid(struct terminal *term)
     tll_free(term->normal.scroll_damage);
     sixel_reflow_grid(term, &term->normal);
 
+    /* History reflowed synchronously, because the worker failed to start */
+    if (term->reflow.history != NULL && !term->reflow.running)
+        reflow_worker_finish(term);
+
     if (term->grid == &term->normal) {
         term_damage_view(term);
         render_refresh(term);
@@ -4738,6 +6248,9 @@ render_resize(struct terminal *term, int width, int height, uint8_t opts)
         goto damage_view;
     }
 
+    /* The scrollback of a previous resize may still be reflowing */
+    reflow_worker_finish(term);
+
 
     /*
      * Since text reflow is slow, don't do it *while* resizing. Only
@@ -4794,6 +6307,7 @@ render_resize(struct terminal *term, int width, int height, uint8_t opts)
             .saved_cursor = orig->saved_cursor,
             .rows = xcalloc(g.num_rows, sizeof(g.rows[0])),
             .cur_row = NULL,
+            .slab = grid_row_slab_new(term->interactive_resizing.old_cols),
             .scroll_damage = tll_init(),
             .sixel_images = tll_init(),
             .kitty_kbd = orig->kitty_kbd,
@@ -4806,13 +6320,15 @@ render_resize(struct terminal *term, int width, int height, uint8_t opts)
              i < term->interactive_resizing.old_screen_rows;
              i++, j = (j + 1) & (orig->num_rows - 1))
         {
-            g.rows[i] = grid_row_alloc(g.num_cols, false);
+            const struct row *orig_row = grid_row_unpacked(orig, j);
+
+            g.rows[i] = grid_row_alloc(g.slab, g.num_cols, false);
             memcpy(g.rows[i]->cells,
-                   orig->rows[j]->cells,
+                   orig_row->cells,
                    g.num_cols * sizeof(g.rows[i]->cells[0]));
 
-            if (orig->rows[j]->extra == NULL ||
-                orig->rows[j]->extra->underline_ranges.count == 0)
+            if (orig_row->extra == NULL ||
+                orig_row->extra->underline_ranges.count == 0)
             {
                 continue;
             }
@@ -4821,7 +6337,7 @@ render_resize(struct terminal *term, int width, int height, uint8_t opts)
              * Copy underline ranges
              */
 
-            const struct row_ranges *underline_src = &orig->rows[j]->extra->underline_ranges;
+            const struct row_ranges *underline_src = &orig_row->extra->underline_ranges;
 
             const int count = underline_src->count;
             g.rows[i]->extra = xcalloc(1, sizeof(*g.rows[i]->extra));
@@ -4901,7 +6417,8 @@ render_resize(struct terminal *term, int width, int height, uint8_t opts)
         };
 
         grid_resize_and_reflow(
-            &term->normal, term, new_normal_grid_rows, new_cols, old_normal_rows, new_rows,
+            &term->normal, &term->composed, new_normal_grid_rows, new_cols,
+            old_normal_rows, new_rows,
             term->selection.coords.end.row >= 0 ? ALEN(tracking_points) : 0,
             tracking_points);
     }
@@ -4917,6 +6434,12 @@ render_resize(struct terminal *term, int width, int height, uint8_t opts)
     term->cols = new_cols;
     term->rows = new_rows;
 
+    if (term->render.workers.count > 0) {
+        term->render.workers.rows = xreallocarray(
+            term->render.workers.rows, new_rows,
+            sizeof(term->render.workers.rows[0]));
+    }
+
     sixel_reflow(term);
 
     LOG_DBG("resized: grid: cols=%d, rows=%d "
@@ -5459,9 +6982,6 @@ render_buffer_release_callback(struct buffer *buf, void *data)
     term->render.workers.preapplied_damage.stop = (struct timespec){0};
     mtx_unlock(&term->render.workers.preapplied_damage.lock);
 
-    mtx_lock(&term->render.workers.lock);
-    sem_post(&term->render.workers.start);
-    xassert(tll_length(term->render.workers.queue) == 0);
-    tll_push_back(term->render.workers.queue, -3);
-    mtx_unlock(&term->render.workers.lock);
+    render_pool_submit(
+        term->render.workers.pool, &term->render.workers.preapply_job, 1);
 }
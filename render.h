@@ -20,6 +20,21 @@ enum resize_options {
 bool render_resize(
     struct terminal *term, int width, int height, uint8_t resize_options);
 
+/*
+ * Scrollback reflow, deferred after an interactive resize; either
+ * running in a worker thread, or pending a lazy reflow. _wait()
+ * blocks until the worker is done. _finish() also splices the
+ * reflowed scrollback into the normal grid, and reflows everything
+ * still pending, while _cancel() throws it all away. _pending()
+ * reflows at least 'rows' rows of the pending scrollback, and returns
+ * false if there was nothing to reflow. All are no-ops if there's no
+ * deferred reflow.
+ */
+void render_reflow_wait(struct terminal *term);
+void render_reflow_finish(struct terminal *term);
+void render_reflow_cancel(struct terminal *term);
+bool render_reflow_pending(struct terminal *term, int rows);
+
 void render_refresh(struct terminal *term);
 void render_refresh_app_id(struct terminal *term);
 void render_refresh_icon(struct terminal *term);
@@ -33,11 +48,13 @@ bool render_xcursor_is_valid(const struct seat *seat, const char *cursor);
 
 void render_overlay(struct terminal *term);
 
-struct render_worker_context {
-    int my_id;
-    struct terminal *term;
-};
-int render_worker_thread(void *_ctx);
+/*
+ * Render worker threads. Each terminal has a private pool, except in
+ * server mode, where a single pool is shared by all terminals.
+ */
+struct render_pool *render_pool_new(uint16_t count);
+void render_pool_destroy(struct render_pool *pool);
+uint16_t render_pool_count(const struct render_pool *pool);
 
 struct csd_data {
     int x;
@@ -50,3 +67,10 @@ struct csd_data get_csd_data(const struct terminal *term, enum csd_surface surf_
 
 void render_buffer_release_callback(struct buffer *buf, void *data);
 void render_wait_for_preapply_damage(struct terminal *term);
+
+/*
+ * Releases the terminal's buffers not held by the compositor, e.g.
+ * when the terminal has been idle for a while. Returns the number of
+ * released buffers.
+ */
+size_t render_trim_buffers(struct terminal *term);
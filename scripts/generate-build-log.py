@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+import argparse
+import random
+import sys
+
+
+WORDS = [
+    'cc', 'c++', 'ld', '-O2', '-O3', '-g', '-Wall', '-Wextra', '-pedantic',
+    '-fPIC', '-c', '-o', '-I', '-D_GNU_SOURCE', '-std=c11', 'main.c',
+    'src/terminal.c', 'src/render.c', 'build/obj/terminal.o',
+    'build/obj/render.o', 'warning:', 'note:', 'error:', 'in', 'function',
+    'unused', 'variable', 'parameter', 'implicit', 'declaration', 'of',
+    "'foo'", "'bar'", '[-Wunused-variable]', '[-Wunused-parameter]',
+    'Compiling', 'Linking', 'target', 'done', '|', '^', '~~~~',
+]
+
+# Words mixed in with --unicode; exercises the non-ASCII printing path
+# (width lookups, emoji variation selectors)
+UNICODE_WORDS = [
+    '警告:', '未使用の変数', '関数', 'ファイル', '编译', '链接', '완료',
+    'ошибка:', 'переменная', 'Ελληνικά', 'naïve', 'café', '→', '✓',
+    '✗', '…', '❤️', '#️⃣', '🚀', '✨', '📦', '🔧',
+]
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(
+        description='Generate a (mostly) plain ASCII stream, resembling '
+                    'the output of a large build, for benchmarking the '
+                    'VT parser and its printing fast path')
+    parser.add_argument(
+        'out', type=argparse.FileType(mode='w'), nargs='?', help='name of output file')
+    parser.add_argument('--lines', type=int, default=1000000)
+    parser.add_argument('--max-words', type=int, default=40,
+                        help='maximum number of words per line')
+    parser.add_argument('--colors', action='store_true',
+                        help='color some of the diagnostics, like a compiler would')
+    parser.add_argument('--unicode', action='store_true',
+                        help='mix in non-ASCII words (CJK, emoji etc)')
+    parser.add_argument('--seed', type=int)
+
+    opts = parser.parse_args()
+    out = opts.out if opts.out is not None else sys.stdout
+
+    if opts.seed is not None:
+        random.seed(opts.seed)
+
+    vocabulary = WORDS + UNICODE_WORDS if opts.unicode else WORDS
+
+    for _ in range(opts.lines):
+        words = [random.choice(vocabulary)
+                 for _ in range(random.randint(1, opts.max_words))]
+
+        if opts.colors and random.random() < 0.1:
+            sgr = random.choice(['1;31', '1;35', '1;36', '1;32'])
+            words[0] = f'\033[{sgr}m{words[0]}\033[m'
+
+        out.write(' '.join(words))
+        out.write('\r\n' if random.random() < 0.5 else '\n')
+
+
+if __name__ == '__main__':
+    main()
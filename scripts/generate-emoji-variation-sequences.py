@@ -52,51 +52,79 @@ def main() -> None:
         else:
             codepoints[cp].vs16 = True
 
-    sorted_list = sorted(codepoints.values(), key=lambda cp: cp.start)
-
-    compacted: list[Codepoint] = []
-    for i, cp in enumerate(sorted_list):
-        assert cp.end == cp.start
-
-        if i == 0:
-            compacted.append(cp)
-            continue
-
-        last_cp = compacted[-1]
-        if last_cp.end == cp.start - 1 and last_cp.vs15 == cp.vs15 and last_cp.vs16 == cp.vs16:
-            compacted[-1].end = cp.start
-        else:
-            compacted.append(cp)
-
-    opts.output.write('#pragma once\n')
-    opts.output.write('#include <stdint.h>\n')
-    opts.output.write('#include <stdbool.h>\n')
-    opts.output.write('\n')
-    opts.output.write('struct emoji_vs {\n')
-    opts.output.write('    uint32_t start:21;\n')
-    opts.output.write('    uint32_t end:21;\n')
-    opts.output.write('    bool vs15:1;\n')
-    opts.output.write('    bool vs16:1;\n')
-    opts.output.write('} __attribute__((packed));\n')
-    opts.output.write('_Static_assert(sizeof(struct emoji_vs) == 6, "unexpected struct size");\n')
-    opts.output.write('\n')
-    opts.output.write('#if defined(FOOT_GRAPHEME_CLUSTERING)\n')
-    opts.output.write('\n')
-
-    opts.output.write(f'static const struct emoji_vs emoji_vs[{len(compacted)}] = {{\n')
-
-    for cp in compacted:
-        opts.output.write('    {\n')
-        opts.output.write(f'        .start = 0x{cp.start:X},\n')
-        opts.output.write(f'        .end = 0x{cp.end:x},\n')
-        opts.output.write(f'        .vs15 = {"true" if cp.vs15 else "false"},\n')
-        opts.output.write(f'        .vs16 = {"true" if cp.vs16 else "false"},\n')
-        opts.output.write('    },\n')
-
-    opts.output.write('};\n')
-    opts.output.write('\n')
-    opts.output.write('#endif  /* FOOT_GRAPHEME_CLUSTERING */\n')
-
+    # Two-level lookup table: the codepoint's upper bits index
+    # emoji_vs_index[], which gives us the block (in
+    # emoji_vs_blocks[]) to look up the lower bits in. Identical
+    # blocks (most of them are all zeroes) are shared.
+    block_shift = 7
+    block_size = 1 << block_shift
+
+    max_cp = max(codepoints)
+    block_count = (max_cp >> block_shift) + 1
+
+    blocks: list[tuple[int, ...]] = [tuple([0] * block_size)]
+    index: list[int] = []
+
+    for b in range(block_count):
+        block = []
+        for cp in range(b << block_shift, (b + 1) << block_shift):
+            flags = 0
+            if cp in codepoints:
+                flags |= 1 if codepoints[cp].vs15 else 0
+                flags |= 2 if codepoints[cp].vs16 else 0
+            block.append(flags)
+
+        block = tuple(block)
+        if block not in blocks:
+            blocks.append(block)
+        index.append(blocks.index(block))
+
+    assert len(blocks) <= 256
+
+    out = opts.output
+    out.write('#pragma once\n')
+    out.write('#include <stdint.h>\n')
+    out.write('\n')
+    out.write('#if defined(FOOT_GRAPHEME_CLUSTERING)\n')
+    out.write('\n')
+    out.write('enum emoji_vs_flags {\n')
+    out.write('    EMOJI_VS15 = 1 << 0,  /* Has a text presentation sequence */\n')
+    out.write('    EMOJI_VS16 = 1 << 1,  /* Has an emoji presentation sequence */\n')
+    out.write('};\n')
+    out.write('\n')
+    out.write(f'#define EMOJI_VS_BLOCK_SHIFT {block_shift}\n')
+    out.write('\n')
+
+    out.write(f'static const uint8_t emoji_vs_index[{len(index)}] = {{')
+    for i, idx in enumerate(index):
+        if i % 16 == 0:
+            out.write('\n   ')
+        out.write(f' {idx},')
+    out.write('\n};\n\n')
+
+    out.write(f'static const uint8_t emoji_vs_blocks[{len(blocks)}][{block_size}] = {{\n')
+    for block in blocks:
+        out.write('    {')
+        for i, flags in enumerate(block):
+            if i % 32 == 0:
+                out.write('\n       ')
+            out.write(f' {flags},')
+        out.write('\n    },\n')
+    out.write('};\n')
+    out.write('\n')
+
+    out.write('/* Returns the emoji_vs_flags for the (base) codepoint \'cp\' */\n')
+    out.write('static inline uint8_t\n')
+    out.write('emoji_vs_lookup(uint32_t cp)\n')
+    out.write('{\n')
+    out.write('    const uint32_t block = cp >> EMOJI_VS_BLOCK_SHIFT;\n')
+    out.write('    if (block >= sizeof(emoji_vs_index) / sizeof(emoji_vs_index[0]))\n')
+    out.write('        return 0;\n')
+    out.write('    return emoji_vs_blocks[emoji_vs_index[block]]\n')
+    out.write('        [cp & ((1u << EMOJI_VS_BLOCK_SHIFT) - 1)];\n')
+    out.write('}\n')
+    out.write('\n')
+    out.write('#endif  /* FOOT_GRAPHEME_CLUSTERING */\n')
 
 if __name__ == '__main__':
     main()
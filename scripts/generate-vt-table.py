@@ -0,0 +1,331 @@
+#!/usr/bin/env python3
+
+"""
+Generates the VT parser's state transition table.
+
+The parser is described below, state by state, the same way it is
+described in https://vt100.net/emu/dec_ansi_parser. Each state is a
+list of rules; a rule is a byte range, a list of actions to execute,
+and the state to transition to. Bytes not matched by any rule fall
+through to the "anywhere" rules.
+
+The output is a C header with:
+
+  * vt_byte_class[]: maps each byte to a byte class. Bytes that have
+    identical transitions in all states share the same class.
+  * vt_transitions[][]: state x byte class -> action + new state.
+  * VT_ACTION_LIST(): an X-macro with one entry per action
+    combination. The second argument is the C code to execute. It is
+    expanded inside vt_from_slave(), where ‘term’, ‘c’ (the current
+    byte), ‘p’ (pointer to the next byte), ‘end’ and ‘current_state’
+    (already set to the new state) are in scope. Actions may consume
+    more than one byte, and may override the new state.
+"""
+
+import argparse
+import sys
+
+
+STATES = [
+    'GROUND',
+    'ESCAPE',
+    'ESCAPE_INTERMEDIATE',
+    'CSI_ENTRY',
+    'CSI_PARAM',
+    'CSI_INTERMEDIATE',
+    'CSI_IGNORE',
+    'OSC_STRING',
+    'DCS_ENTRY',
+    'DCS_PARAM',
+    'DCS_INTERMEDIATE',
+    'DCS_IGNORE',
+    'DCS_PASSTHROUGH',
+    'SOS_PM_APC_STRING',
+    'UTF8_21',
+    'UTF8_31',
+    'UTF8_32',
+    'UTF8_41',
+    'UTF8_42',
+    'UTF8_43',
+]
+
+ACTIONS = {
+    'clear': 'action_clear(term);',
+    'execute': 'action_execute(term, c);',
+    'print': 'p = action_print_run(term, p - 1, end);',
+    'collect': 'action_collect(term, c);',
+    'param': 'action_param(term, c);',
+    'param_new': 'action_param_new(term, c);',
+    'param_new_subparam': 'action_param_new_subparam(term, c);',
+    'esc_dispatch': 'action_esc_dispatch(term, c);',
+    'csi_dispatch': 'action_csi_dispatch(term, c);',
+    'osc_start': 'action_osc_start(term, c);',
+    'osc_put': 'action_osc_put(term, c);',
+    'osc_end': 'action_osc_end(term, c);',
+    'hook': 'action_hook(term, c);',
+    'unhook': 'action_unhook(term, c);',
+    'put': 'action_put(term, c);',
+    'utf8_run': 'p = action_utf8_run(term, p - 1, end, &current_state);',
+    'utf8_22': 'action_utf8_22(term, c);',
+    'utf8_32': 'action_utf8_32(term, c);',
+    'utf8_33': 'action_utf8_33(term, c);',
+    'utf8_42': 'action_utf8_42(term, c);',
+    'utf8_43': 'action_utf8_43(term, c);',
+    'utf8_44': 'action_utf8_44(term, c);',
+    'utf8_invalid': 'action_utf8_print(term, 0xfffd);',
+}
+
+C0 = [(0x00, 0x17), (0x19, 0x19), (0x1c, 0x1f)]
+
+
+def rules_c0(actions, state):
+    return [(lo, hi, actions, state) for lo, hi in C0]
+
+
+RULES = {
+    'GROUND': rules_c0(['execute'], 'GROUND') + [
+        # Modified from 0x20..0x7f to 0x20..0x7e, since 0x7f is DEL,
+        # which is a zero-width character
+        (0x20, 0x7e, ['print'], 'GROUND'),
+        # Decodes entire runs of UTF-8, and (only) if that fails,
+        # transitions to the UTF8_21/UTF8_31/UTF8_41 states
+        (0xc2, 0xf4, ['utf8_run'], 'GROUND'),
+    ],
+
+    'ESCAPE': rules_c0(['execute'], 'ESCAPE') + [
+        (0x20, 0x2f, ['collect'], 'ESCAPE_INTERMEDIATE'),
+        (0x30, 0x4f, ['esc_dispatch'], 'GROUND'),
+        (0x50, 0x50, ['clear'], 'DCS_ENTRY'),
+        (0x51, 0x57, ['esc_dispatch'], 'GROUND'),
+        (0x58, 0x58, [], 'SOS_PM_APC_STRING'),
+        (0x59, 0x59, ['esc_dispatch'], 'GROUND'),
+        (0x5a, 0x5a, ['esc_dispatch'], 'GROUND'),
+        (0x5b, 0x5b, ['clear'], 'CSI_ENTRY'),
+        (0x5c, 0x5c, ['esc_dispatch'], 'GROUND'),
+        (0x5d, 0x5d, ['osc_start'], 'OSC_STRING'),
+        (0x5e, 0x5f, [], 'SOS_PM_APC_STRING'),
+        (0x60, 0x7e, ['esc_dispatch'], 'GROUND'),
+        (0x7f, 0x7f, [], 'ESCAPE'),
+    ],
+
+    'ESCAPE_INTERMEDIATE': rules_c0(['execute'], 'ESCAPE_INTERMEDIATE') + [
+        (0x20, 0x2f, ['collect'], 'ESCAPE_INTERMEDIATE'),
+        (0x30, 0x7e, ['esc_dispatch'], 'GROUND'),
+        (0x7f, 0x7f, [], 'ESCAPE_INTERMEDIATE'),
+    ],
+
+    'CSI_ENTRY': rules_c0(['execute'], 'CSI_ENTRY') + [
+        (0x20, 0x2f, ['collect'], 'CSI_INTERMEDIATE'),
+        (0x30, 0x39, ['param'], 'CSI_PARAM'),
+        (0x3a, 0x3a, ['param_new_subparam'], 'CSI_PARAM'),
+        (0x3b, 0x3b, ['param_new'], 'CSI_PARAM'),
+        (0x3c, 0x3f, ['collect'], 'CSI_PARAM'),
+        (0x40, 0x7e, ['csi_dispatch'], 'GROUND'),
+        (0x7f, 0x7f, [], 'CSI_ENTRY'),
+    ],
+
+    'CSI_PARAM': rules_c0(['execute'], 'CSI_PARAM') + [
+        (0x20, 0x2f, ['collect'], 'CSI_INTERMEDIATE'),
+        (0x30, 0x39, ['param'], 'CSI_PARAM'),
+        (0x3a, 0x3a, ['param_new_subparam'], 'CSI_PARAM'),
+        (0x3b, 0x3b, ['param_new'], 'CSI_PARAM'),
+        (0x3c, 0x3f, [], 'CSI_IGNORE'),
+        (0x40, 0x7e, ['csi_dispatch'], 'GROUND'),
+        (0x7f, 0x7f, [], 'CSI_PARAM'),
+    ],
+
+    'CSI_INTERMEDIATE': rules_c0(['execute'], 'CSI_INTERMEDIATE') + [
+        (0x20, 0x2f, ['collect'], 'CSI_INTERMEDIATE'),
+        (0x30, 0x3f, [], 'CSI_IGNORE'),
+        (0x40, 0x7e, ['csi_dispatch'], 'GROUND'),
+        (0x7f, 0x7f, [], 'CSI_INTERMEDIATE'),
+    ],
+
+    'CSI_IGNORE': rules_c0(['execute'], 'CSI_IGNORE') + [
+        (0x20, 0x3f, [], 'CSI_IGNORE'),
+        (0x40, 0x7e, [], 'GROUND'),
+        (0x7f, 0x7f, [], 'CSI_IGNORE'),
+    ],
+
+    # Note: original was 20-7f, but we use 20-ff to include utf-8
+    'OSC_STRING': [
+        (0x07, 0x07, ['osc_end'], 'GROUND'),
+        (0x00, 0x06, [], 'OSC_STRING'),
+        (0x08, 0x17, [], 'OSC_STRING'),
+        (0x19, 0x19, [], 'OSC_STRING'),
+        (0x1c, 0x1f, [], 'OSC_STRING'),
+        (0x18, 0x18, ['osc_end', 'execute'], 'GROUND'),
+        (0x1a, 0x1a, ['osc_end', 'execute'], 'GROUND'),
+        (0x1b, 0x1b, ['osc_end', 'clear'], 'ESCAPE'),
+        (0x00, 0xff, ['osc_put'], 'OSC_STRING'),
+    ],
+
+    'DCS_ENTRY': rules_c0([], 'DCS_ENTRY') + [
+        (0x20, 0x2f, ['collect'], 'DCS_INTERMEDIATE'),
+        (0x30, 0x39, ['param'], 'DCS_PARAM'),
+        (0x3a, 0x3a, [], 'DCS_IGNORE'),
+        (0x3b, 0x3b, ['param_new'], 'DCS_PARAM'),
+        (0x3c, 0x3f, ['collect'], 'DCS_PARAM'),
+        (0x40, 0x7e, ['hook'], 'DCS_PASSTHROUGH'),
+        (0x7f, 0x7f, [], 'DCS_ENTRY'),
+    ],
+
+    'DCS_PARAM': rules_c0([], 'DCS_PARAM') + [
+        (0x20, 0x2f, ['collect'], 'DCS_INTERMEDIATE'),
+        (0x30, 0x39, ['param'], 'DCS_PARAM'),
+        (0x3a, 0x3a, [], 'DCS_IGNORE'),
+        (0x3b, 0x3b, ['param_new'], 'DCS_PARAM'),
+        (0x3c, 0x3f, [], 'DCS_IGNORE'),
+        (0x40, 0x7e, ['hook'], 'DCS_PASSTHROUGH'),
+        (0x7f, 0x7f, [], 'DCS_PARAM'),
+    ],
+
+    'DCS_INTERMEDIATE': rules_c0([], 'DCS_INTERMEDIATE') + [
+        (0x20, 0x2f, ['collect'], 'DCS_INTERMEDIATE'),
+        (0x30, 0x3f, [], 'DCS_IGNORE'),
+        (0x40, 0x7e, ['hook'], 'DCS_PASSTHROUGH'),
+        (0x7f, 0x7f, [], 'DCS_INTERMEDIATE'),
+    ],
+
+    'DCS_IGNORE': rules_c0([], 'DCS_IGNORE') + [
+        (0x20, 0x7f, [], 'DCS_IGNORE'),
+    ],
+
+    'DCS_PASSTHROUGH': [
+        (0x00, 0x17, ['put'], 'DCS_PASSTHROUGH'),
+        (0x19, 0x19, ['put'], 'DCS_PASSTHROUGH'),
+        (0x1c, 0x7e, ['put'], 'DCS_PASSTHROUGH'),
+        (0x7f, 0x7f, [], 'DCS_PASSTHROUGH'),
+        (0x18, 0x18, ['unhook', 'execute'], 'GROUND'),
+        (0x1a, 0x1a, ['unhook', 'execute'], 'GROUND'),
+        (0x1b, 0x1b, ['unhook', 'clear'], 'ESCAPE'),
+        (0x80, 0x9f, ['unhook'], 'GROUND'),
+        (0x00, 0xff, [], 'DCS_PASSTHROUGH'),
+    ],
+
+    'SOS_PM_APC_STRING': rules_c0([], 'SOS_PM_APC_STRING') + [
+        (0x1c, 0x7f, [], 'SOS_PM_APC_STRING'),
+    ],
+}
+
+UTF8_CONTINUATION = {
+    'UTF8_21': (['utf8_22'], 'GROUND'),
+    'UTF8_31': (['utf8_32'], 'UTF8_32'),
+    'UTF8_32': (['utf8_33'], 'GROUND'),
+    'UTF8_41': (['utf8_42'], 'UTF8_42'),
+    'UTF8_42': (['utf8_43'], 'UTF8_43'),
+    'UTF8_43': (['utf8_44'], 'GROUND'),
+}
+
+
+def anywhere(b, current):
+    if b in (0x18, 0x1a):
+        return ['execute'], 'GROUND'
+    if b == 0x1b:
+        return ['clear'], 'ESCAPE'
+    if 0x80 <= b <= 0x9f:
+        # 8-bit C1 control characters (not supported)
+        return [], 'GROUND'
+    return [], current
+
+
+def transition(state, b, current):
+    if state in UTF8_CONTINUATION:
+        if 0x80 <= b <= 0xbf:
+            return UTF8_CONTINUATION[state]
+
+        # Invalid UTF-8: emit a replacement character, and then
+        # re-process the byte in the ground state. Note that
+        # 'current' is still the UTF-8 state; bytes that are ignored
+        # in the ground state thus leave us in the UTF-8 state.
+        actions, new_state = transition('GROUND', b, current)
+        return ['utf8_invalid'] + actions, new_state
+
+    for lo, hi, actions, new_state in RULES[state]:
+        if lo <= b <= hi:
+            return actions, new_state
+
+    return anywhere(b, current)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser()
+    parser.add_argument('output', type=argparse.FileType('w'))
+    opts = parser.parse_args()
+
+    assert set(RULES) | set(UTF8_CONTINUATION) == set(STATES)
+
+    # table[state][byte] = (action names, new state)
+    table = {
+        state: [transition(state, b, state) for b in range(256)]
+        for state in STATES
+    }
+
+    # Collect unique action combinations. 'NONE' must come first, to
+    # make it the zero value
+    combinations = [()]
+    for state in STATES:
+        for actions, _ in table[state]:
+            if tuple(actions) not in combinations:
+                combinations.append(tuple(actions))
+
+    assert len(combinations) < 256
+    assert len(STATES) < 256
+
+    def action_name(actions):
+        return 'VT_ACTION_' + ('__'.join(actions).upper() if actions else 'NONE')
+
+    # Group bytes with identical transitions (in all states) into classes
+    columns = []
+    byte_class = []
+
+    for b in range(256):
+        column = tuple((tuple(table[state][b][0]), table[state][b][1])
+                       for state in STATES)
+        if column not in columns:
+            columns.append(column)
+        byte_class.append(columns.index(column))
+
+    out = opts.output
+    out.write('#pragma once\n\n')
+    out.write('/* Generated by generate-vt-table.py - do not edit */\n\n')
+    out.write('#include <stdint.h>\n\n')
+
+    out.write('enum vt_action {\n')
+    for actions in combinations:
+        out.write(f'    {action_name(actions)},\n')
+    out.write('};\n\n')
+
+    out.write('#define VT_ACTION_LIST(X)')
+    for actions in combinations:
+        body = ' '.join(ACTIONS[a] for a in actions)
+        out.write(f' \\\n    X({action_name(actions)[len("VT_ACTION_"):]}, {body})')
+    out.write('\n\n')
+
+    out.write('#define VT_TRANSITION(action, state) '
+              '((uint16_t)((action) << 8 | (state)))\n')
+    out.write('#define VT_TRANSITION_ACTION(t) ((enum vt_action)((t) >> 8))\n')
+    out.write('#define VT_TRANSITION_STATE(t) ((enum state)((t) & 0xff))\n\n')
+
+    out.write(f'#define VT_BYTE_CLASS_COUNT {len(columns)}\n\n')
+
+    out.write('static const uint8_t vt_byte_class[256] = {')
+    for b in range(256):
+        if b % 16 == 0:
+            out.write('\n   ')
+        out.write(f' {byte_class[b]},')
+    out.write('\n};\n\n')
+
+    out.write('static const uint16_t vt_transitions[][VT_BYTE_CLASS_COUNT] = {\n')
+    for state_idx, state in enumerate(STATES):
+        out.write(f'    [STATE_{state}] = {{\n')
+        for column in columns:
+            actions, new_state = column[state_idx]
+            out.write(f'        VT_TRANSITION({action_name(actions)}, '
+                      f'STATE_{new_state}),\n')
+        out.write('    },\n')
+    out.write('};\n')
+
+
+if __name__ == '__main__':
+    sys.exit(main())
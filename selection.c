@@ -221,7 +221,7 @@ foreach_selected_normal(
     end_row &= (grid_rows - 1);
 
     for (int r = start_row; r != end_row; r = (r + 1) & (grid_rows - 1)) {
-        struct row *row = term->grid->rows[r];
+        struct row *row = grid_row_unpacked(term->grid, r);
         xassert(row != NULL);
 
         for (int c = start_col; c <= term->cols - 1; c++) {
@@ -233,7 +233,7 @@ foreach_selected_normal(
     }
 
     /* Last, partial row */
-    struct row *row = term->grid->rows[end_row];
+    struct row *row = grid_row_unpacked(term->grid, end_row);
     xassert(row != NULL);
 
     for (int c = start_col; c <= end_col; c++) {
@@ -274,7 +274,7 @@ foreach_selected_block(
 
     int r = top_left.row;
     while (true) {
-        struct row *row = term->grid->rows[r];
+        struct row *row = grid_row_unpacked(term->grid, r);
         xassert(row != NULL);
 
         for (int c = top_left.col; c <= bottom_right.col; c++) {
@@ -353,7 +353,7 @@ selection_find_word_boundary_left(const struct terminal *term, struct coord *pos
     xassert(pos->row >= 0);
     pos->row &= grid->num_rows - 1;
 
-    const struct row *r = grid->rows[pos->row];
+    const struct row *r = grid_row_unpacked(grid, pos->row);
     char32_t c = r->cells[pos->col].wc;
 
     while (c >= CELL_SPACER) {
@@ -365,7 +365,7 @@ selection_find_word_boundary_left(const struct terminal *term, struct coord *pos
     }
 
     if (c >= CELL_COMB_CHARS_LO && c <= CELL_COMB_CHARS_HI)
-        c = composed_lookup(term->composed, c - CELL_COMB_CHARS_LO)->chars[0];
+        c = composed_lookup(&term->composed, c - CELL_COMB_CHARS_LO)->chars[0];
 
     bool initial_is_space = c == 0 || isc32space(c);
     bool initial_is_delim =
@@ -377,7 +377,7 @@ selection_find_word_boundary_left(const struct terminal *term, struct coord *pos
         int next_col = pos->col - 1;
         int next_row = pos->row;
 
-        const struct row *row = grid->rows[next_row];
+        const struct row *row = grid_row_unpacked(grid, next_row);
 
         /* Linewrap */
         if (next_col < 0) {
@@ -392,7 +392,7 @@ selection_find_word_boundary_left(const struct terminal *term, struct coord *pos
                 break;
             }
 
-            row = grid->rows[next_row];
+            row = grid_row_unpacked(grid, next_row);
 
             if (row->linebreak) {
                 /* Hard linebreak, treat as space. I.e. break selection */
@@ -409,7 +409,7 @@ selection_find_word_boundary_left(const struct terminal *term, struct coord *pos
         }
 
         if (c >= CELL_COMB_CHARS_LO && c <= CELL_COMB_CHARS_HI)
-            c = composed_lookup(term->composed, c - CELL_COMB_CHARS_LO)->chars[0];
+            c = composed_lookup(&term->composed, c - CELL_COMB_CHARS_LO)->chars[0];
 
         bool is_space = c == 0 || isc32space(c);
         bool is_delim =
@@ -442,7 +442,7 @@ selection_find_word_boundary_right(const struct terminal *term, struct coord *po
     xassert(pos->row >= 0);
     pos->row &= grid->num_rows - 1;
 
-    const struct row *r = grid->rows[pos->row];
+    const struct row *r = grid_row_unpacked(grid, pos->row);
     char32_t c = r->cells[pos->col].wc;
 
     while (c >= CELL_SPACER) {
@@ -454,7 +454,7 @@ selection_find_word_boundary_right(const struct terminal *term, struct coord *po
     }
 
     if (c >= CELL_COMB_CHARS_LO && c <= CELL_COMB_CHARS_HI)
-        c = composed_lookup(term->composed, c - CELL_COMB_CHARS_LO)->chars[0];
+        c = composed_lookup(&term->composed, c - CELL_COMB_CHARS_LO)->chars[0];
 
     bool initial_is_space = c == 0 || isc32space(c);
     bool initial_is_delim =
@@ -467,7 +467,7 @@ selection_find_word_boundary_right(const struct terminal *term, struct coord *po
         int next_col = pos->col + 1;
         int next_row = pos->row;
 
-        const struct row *row = term->grid->rows[next_row];
+        const struct row *row = grid_row_unpacked(term->grid, next_row);
 
         /* Linewrap */
         if (next_col >= term->cols) {
@@ -484,7 +484,7 @@ selection_find_word_boundary_right(const struct terminal *term, struct coord *po
                 break;
             }
 
-            row = grid->rows[next_row];
+            row = grid_row_unpacked(grid, next_row);
         }
 
         c = row->cells[next_col].wc;
@@ -498,7 +498,7 @@ selection_find_word_boundary_right(const struct terminal *term, struct coord *po
         }
 
         if (c >= CELL_COMB_CHARS_LO && c <= CELL_COMB_CHARS_HI)
-            c = composed_lookup(term->composed, c - CELL_COMB_CHARS_LO)->chars[0];
+            c = composed_lookup(&term->composed, c - CELL_COMB_CHARS_LO)->chars[0];
 
         bool is_space = c == 0 || isc32space(c);
         bool is_delim =
@@ -913,11 +913,11 @@ mark_selected_region(struct terminal *term, pixman_box32_t *boxes,
              rel_r < box->y2;
              r = (r + 1) & (term->grid->num_rows - 1), rel_r++)
         {
-            struct row *row = term->grid->rows[r];
+            struct row *row = grid_row_unpacked(term->grid, r);
             xassert(row != NULL);
 
             if (dirty_cells)
-                row->dirty = true;
+                grid_row_dirty_cols(row, box->x1, box->x2 - 1);
 
             for (int c = box->x1, empty_count = 0; c < box->x2; c++) {
                 struct cell *cell = &row->cells[c];
@@ -972,7 +972,7 @@ mark_selected_region(struct terminal *term, pixman_box32_t *boxes,
                      */
                     cell->attrs.clean = false;
                     cell->attrs.selected = false;
-                    row->dirty = true;
+                    grid_row_dirty_cols(row, c, c);
                     continue;
                 }
 
@@ -982,7 +982,7 @@ mark_selected_region(struct terminal *term, pixman_box32_t *boxes,
 
                     if (dirty_cells) {
                         cell->attrs.clean = false;
-                        row->dirty = true;
+                        grid_row_dirty_cols(row, c - j, c - j);
                     }
                     cell->attrs.selected = selected;
                 }
@@ -1055,7 +1055,7 @@ set_pivot_point_for_block_and_char_wise(struct terminal *term,
     /* First, make sure 'start' isn't in the middle of a
      * multi-column character */
     while (true) {
-        const struct row *row = term->grid->rows[pivot_start->row & (term->grid->num_rows - 1)];
+        const struct row *row = grid_row_unpacked(term->grid, pivot_start->row & (term->grid->num_rows - 1));
         const struct cell *cell = &row->cells[pivot_start->col];
 
         if (cell->wc < CELL_SPACER)
@@ -1080,7 +1080,7 @@ set_pivot_point_for_block_and_char_wise(struct terminal *term,
     if (new_direction == SELECTION_RIGHT) {
         bool keep_going = true;
         while (keep_going) {
-            const struct row *row = term->grid->rows[pivot_end->row & (term->grid->num_rows - 1)];
+            const struct row *row = grid_row_unpacked(term->grid, pivot_end->row & (term->grid->num_rows - 1));
             const char32_t wc = row->cells[pivot_end->col].wc;
 
             keep_going = wc >= CELL_SPACER;
@@ -1096,7 +1096,7 @@ set_pivot_point_for_block_and_char_wise(struct terminal *term,
     } else {
         bool keep_going = true;
         while (keep_going) {
-            const struct row *row = term->grid->rows[pivot_start->row & (term->grid->num_rows - 1)];
+            const struct row *row = grid_row_unpacked(term->grid, pivot_start->row & (term->grid->num_rows - 1));
             const char32_t wc = pivot_start->col < term->cols - 1
                 ? row->cells[pivot_start->col + 1].wc : 0;
 
@@ -1112,9 +1112,9 @@ set_pivot_point_for_block_and_char_wise(struct terminal *term,
         }
     }
 
-    xassert(term->grid->rows[pivot_start->row & (term->grid->num_rows - 1)]->
+    xassert(grid_row_unpacked(term->grid, pivot_start->row & (term->grid->num_rows - 1))->
            cells[pivot_start->col].wc <= CELL_SPACER);
-    xassert(term->grid->rows[pivot_end->row & (term->grid->num_rows - 1)]->
+    xassert(grid_row_unpacked(term->grid, pivot_end->row & (term->grid->num_rows - 1))->
            cells[pivot_end->col].wc <= CELL_SPACER + 1);
 }
 
@@ -1246,8 +1246,8 @@ selection_update(struct terminal *term, int col, int row)
     size_t start_row_idx = new_start.row & (term->grid->num_rows - 1);
     size_t end_row_idx = new_end.row & (term->grid->num_rows - 1);
 
-    const struct row *row_start = term->grid->rows[start_row_idx];
-    const struct row *row_end = term->grid->rows[end_row_idx];
+    const struct row *row_start = grid_row_unpacked(term->grid, start_row_idx);
+    const struct row *row_end = grid_row_unpacked(term->grid, end_row_idx);
 
     /* If an end point is in the middle of a multi-column character,
      * expand the selection to cover the entire character */
@@ -1586,7 +1586,7 @@ unmark_selected(struct terminal *term, struct row *row, struct cell *cell,
     if (!cell->attrs.selected)
         return true;
 
-    row->dirty = true;
+    grid_row_dirty_cols(row, col, col);
     cell->attrs.selected = false;
     cell->attrs.clean = false;
     return true;
@@ -9,6 +9,7 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/epoll.h>
+#include <sys/timerfd.h>
 
 #include <sys/un.h>
 
@@ -19,6 +20,8 @@
 #include "log.h"
 
 #include "client-protocol.h"
+#include "render.h"
+#include "shm.h"
 #include "terminal.h"
 #include "util.h"
 #include "wayland.h"
@@ -35,9 +38,15 @@ struct server {
     struct reaper *reaper;
     struct wayland *wayl;
 
+    /* Render worker threads, shared by all terminals */
+    struct render_pool *render_pool;
+
     int fd;
     const char *sock_path;
 
+    /* Periodic timer, releasing idle terminals' SHM buffers */
+    int idle_timer_fd;
+
     tll(struct client *) clients;
     tll(struct terminal_instance *) terminals;
 };
@@ -61,6 +70,10 @@ struct terminal_instance {
     struct server *server;
     struct client *client;
     struct config *conf;
+
+    /* Frame count at the last idle timer expiration */
+    uint64_t idle_frame_count;
+    bool trimmed;
 };
 static void instance_destroy(struct terminal_instance *instance, int exit_code);
 
@@ -390,8 +403,9 @@ fdm_client(struct fdm *fdm, int fd, int events, void *data)
 
     instance->terminal = term_init(
         conf != NULL ? conf : server->conf,
-        server->fdm, server->reaper, server->wayl, "footclient", cwd, token,
-        NULL, cdata.argc, argv, (const char *const *)envp,
+        server->fdm, server->reaper, server->wayl, server->render_pool,
+        "footclient", cwd, token, NULL,
+        cdata.argc, argv, (const char *const *)envp,
         &term_shutdown_handler, instance);
 
     if (instance->terminal == NULL) {
@@ -436,6 +450,104 @@ shutdown:
     return true;
 }
 
+static size_t
+instance_trim_if_idle(struct terminal_instance *instance)
+{
+    struct terminal *term = instance->terminal;
+    if (term == NULL || term->shutdown.in_progress)
+        return 0;
+
+    const uint64_t frame_count = term->render.frame_count;
+
+    if (frame_count != instance->idle_frame_count) {
+        /* Rendered since the last timer expiration */
+        instance->idle_frame_count = frame_count;
+        instance->trimmed = false;
+        return 0;
+    }
+
+    if (instance->trimmed)
+        return 0;
+
+    instance->trimmed = true;
+    return render_trim_buffers(term);
+}
+
+static bool
+fdm_idle_timer(struct fdm *fdm, int fd, int events, void *data)
+{
+    if (events & EPOLLHUP)
+        return false;
+
+    struct server *server = data;
+
+    uint64_t expiration_count;
+    ssize_t ret = read(fd, &expiration_count, sizeof(expiration_count));
+
+    if (ret < 0) {
+        if (errno == EAGAIN)
+            return true;
+
+        LOG_ERRNO("failed to read idle timer");
+        return false;
+    }
+
+    size_t trimmed = 0;
+
+    tll_foreach(server->clients, it) {
+        if (it->item->instance != NULL)
+            trimmed += instance_trim_if_idle(it->item->instance);
+    }
+
+    tll_foreach(server->terminals, it)
+        trimmed += instance_trim_if_idle(it->item);
+
+    const size_t expired =
+        shm_expire_spares(server->conf->tweak.shm_idle_timeout);
+
+    if (trimmed > 0 || expired > 0) {
+        size_t total_size, spare_size;
+        shm_stats(&total_size, &spare_size);
+
+        LOG_INFO("SHM: released %zu idle buffer(s), expired %zu spare(s): "
+                 "%zuKB allocated (%zuKB spare)",
+                 trimmed, expired, total_size / 1024, spare_size / 1024);
+    }
+
+    return true;
+}
+
+/* Failing to create the timer is not fatal; buffers are just not trimmed */
+static int
+idle_timer_init(struct server *server)
+{
+    const time_t idle_timeout = server->conf->tweak.shm_idle_timeout;
+
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (fd < 0) {
+        LOG_ERRNO("failed to create SHM idle timer");
+        return -1;
+    }
+
+    const struct itimerspec interval = {
+        .it_value = {.tv_sec = idle_timeout},
+        .it_interval = {.tv_sec = idle_timeout},
+    };
+
+    if (timerfd_settime(fd, 0, &interval, NULL) < 0) {
+        LOG_ERRNO("failed to arm SHM idle timer");
+        close(fd);
+        return -1;
+    }
+
+    if (!fdm_add(server->fdm, fd, EPOLLIN, &fdm_idle_timer, server)) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
 static bool
 fdm_server(struct fdm *fdm, int fd, int events, void *data)
 {
@@ -623,19 +735,43 @@ server_init(struct config *conf, struct fdm *fdm, struct reaper *reaper,
 
         .fd = fd,
         .sock_path = sock_path,
+        .idle_timer_fd = -1,
 
         .clients = tll_init(),
         .terminals = tll_init(),
     };
 
+    if (conf->render_worker_count > 0) {
+        LOG_INFO("using %hu rendering threads, shared by all terminals",
+                 conf->render_worker_count);
+
+        server->render_pool = render_pool_new(conf->render_worker_count);
+        if (server->render_pool == NULL)
+            goto err;
+    }
+
     if (!fdm_add(fdm, fd, EPOLLIN, &fdm_server, server))
         goto err;
 
+    if (conf->tweak.shm_idle_timeout > 0) {
+        server->idle_timer_fd = idle_timer_init(server);
+
+        /*
+         * Let terminals re-use each other's buffers. Spares are
+         * expired by the idle timer; without it, they would be kept
+         * until we exit.
+         */
+        if (server->idle_timer_fd >= 0)
+            shm_set_share_buffers(true);
+    }
+
     LOG_INFO("accepting connections on %s", sock_path != NULL ? sock_path : "socket provided through socket activation");
 
     return server;
 
 err:
+    if (server != NULL)
+        render_pool_destroy(server->render_pool);
     free(server);
     if (fd != -1)
         close(fd);
@@ -663,6 +799,11 @@ server_destroy(struct server *server)
 
     tll_free(server->terminals);
 
+    render_pool_destroy(server->render_pool);
+
+    if (server->idle_timer_fd >= 0)
+        fdm_del(server->fdm, server->idle_timer_fd);
+
     fdm_del(server->fdm, server->fd);
     if (server->sock_path != NULL)
         unlink(server->sock_path);
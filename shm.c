@@ -63,6 +63,19 @@ static bool can_punch_hole_initialized = false;
 
 static size_t min_stride_alignment = 0;
 
+/* Pools smaller than this many huge pages always use regular pages */
+#define HUGEPAGE_MIN_POOL_PAGES 4
+
+/*
+ * Larger (e.g. 1GB) huge pages would put the minimum pool size above
+ * any realistic window size, and waste most of each page
+ */
+#define HUGETLB_MAX_PAGE_SIZE (2 * 1024 * 1024)
+
+static enum shm_hugepages hugepages = SHM_HUGEPAGES_NONE;
+static bool hugetlb_failed = false;
+static bool prefault = true;
+
 struct buffer_pool {
     int fd;                /* memfd */
     struct wl_shm_pool *wl_pool;
@@ -86,9 +99,12 @@ struct buffer_private {
     size_t size;
 
     bool scrollable;
+    enum wl_shm_format shm_format;
 
     void (*release_cb)(struct buffer *buf, void *data);
     void *cb_data;
+
+    struct timespec parked_at;  /* When added to 'spares' */
 };
 
 struct buffer_chain {
@@ -106,6 +122,19 @@ struct buffer_chain {
 
 static tll(struct buffer_private *) deferred;
 
+/*
+ * Buffers no longer used by any chain (their terminal was closed, or
+ * trimmed because it was idle), that can be re-used by any other
+ * chain with the same buffer size and format. Only used when
+ * shm_set_share_buffers() has been enabled (i.e. in server mode).
+ */
+#define MAX_SPARE_BUFFERS 8
+static tll(struct buffer_private *) spares;
+static bool share_buffers = false;
+
+/* Total size of all buffers; in use, deferred and spare */
+static size_t allocated_size = 0;
+
 #undef MEASURE_SHM_ALLOCS
 #if defined(MEASURE_SHM_ALLOCS)
 static size_t max_alloced = 0;
@@ -123,6 +152,24 @@ shm_set_min_stride_alignment(size_t _min_stride_alignment)
     min_stride_alignment = _min_stride_alignment;
 }
 
+void
+shm_set_hugepages(enum shm_hugepages _hugepages)
+{
+    hugepages = _hugepages;
+}
+
+void
+shm_set_prefault(bool _prefault)
+{
+    prefault = _prefault;
+}
+
+void
+shm_set_share_buffers(bool _share_buffers)
+{
+    share_buffers = _share_buffers;
+}
+
 static void
 buffer_destroy_dont_close(struct buffer *buf)
 {
@@ -169,6 +216,9 @@ pool_unref(struct buffer_pool *pool)
 static void
 buffer_destroy(struct buffer_private *buf)
 {
+    xassert(allocated_size >= buf->size);
+    allocated_size -= buf->size;
+
     buffer_destroy_dont_close(&buf->public);
     pool_unref(buf->pool);
     buf->pool = NULL;
@@ -205,6 +255,11 @@ shm_fini(void)
         tll_remove(deferred, it);
     }
 
+    tll_foreach(spares, it) {
+        buffer_destroy(it->item);
+        tll_remove(spares, it);
+    }
+
 #if defined(MEASURE_SHM_ALLOCS) && MEASURE_SHM_ALLOCS
     LOG_INFO("max total allocations was: %zu MB", max_alloced / 1024 / 1024);
 #endif
@@ -323,49 +378,136 @@ err:
     return false;
 }
 
-static void NOINLINE
-get_new_buffers(struct buffer_chain *chain, size_t count,
-                int widths[static count], int heights[static count],
-                struct buffer *bufs[static count], bool immediate_purge)
+static size_t
+huge_page_size(void)
 {
-    xassert(count == 1 || !chain->scrollable);
-    /*
-     * No existing buffer available. Create a new one by:
-     *
-     * 1. open a memory backed "file" with memfd_create()
-     * 2. mmap() the memory file, to be used by the pixman image
-     * 3. create a wayland shm buffer for the same memory file
-     *
-     * The pixman image and the wayland buffer are now sharing memory.
-     */
+    static size_t size = 0;
+    if (size == 0) {
+        size = 2 * 1024 * 1024;
+
+        FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+        if (f != NULL) {
+            unsigned long n;
+            if (fscanf(f, "%lu", &n) == 1 && n > 0)
+                size = n;
+            fclose(f);
+        }
+    }
+    return size;
+}
 
-    int stride[count];
-    int sizes[count];
+#if defined(MEMFD_CREATE) && defined(MFD_HUGETLB)
+/*
+ * Default hugetlbfs page size, which is what MFD_HUGETLB memfds are
+ * backed by. Not necessarily the same as the transparent huge page
+ * size (e.g. with default_hugepagesz=1G).
+ */
+static size_t
+hugetlb_page_size(void)
+{
+    static size_t size = 0;
+    if (size == 0) {
+        size = 2 * 1024 * 1024;
+
+        FILE *f = fopen("/proc/meminfo", "r");
+        if (f != NULL) {
+            char line[128];
+            while (fgets(line, sizeof(line), f) != NULL) {
+                unsigned long kb;
+                if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1) {
+                    if (kb > 0)
+                        size = kb * 1024;
+                    break;
+                }
+            }
+            fclose(f);
+        }
+    }
+    return size;
+}
+#endif
 
-    size_t total_size = 0;
-    for (size_t i = 0; i < count; i++) {
-        stride[i] = stride_for_format_and_width(
-            chain->pixman_fmt, widths[i]);
+static bool
+use_hugetlb(size_t total_size)
+{
+#if defined(MEMFD_CREATE) && defined(MFD_HUGETLB)
+    if (hugepages != SHM_HUGEPAGES_HUGETLB || hugetlb_failed)
+        return false;
 
-        if (min_stride_alignment > 0) {
-            const size_t m = min_stride_alignment;
-            stride[i] = (stride[i] + m - 1) / m * m;
-        }
+    const size_t page_size = hugetlb_page_size();
 
-        xassert(min_stride_alignment == 0 || stride[i] % min_stride_alignment == 0);
-        sizes[i] = stride[i] * heights[i];
-        total_size += sizes[i];
+    if (page_size > HUGETLB_MAX_PAGE_SIZE) {
+        LOG_DBG("default huge page size is %zukB; not using hugetlb",
+                page_size / 1024);
+        hugetlb_failed = true;
+        return false;
     }
-    if (total_size == 0)
-        return;
 
-    int pool_fd = -1;
+    return total_size >= HUGEPAGE_MIN_POOL_PAGES * page_size;
+#else
+    return false;
+#endif
+}
 
+/*
+ * Creates, sizes and maps a hugetlbfs backed memfd. Returns -1 if
+ * that fails (typically because there aren't enough huge pages
+ * reserved), in which case huge pages are not tried again.
+ */
+static int
+pool_create_hugetlb(size_t total_size, off_t *_memfd_size, void **_mmapped)
+{
+#if defined(MEMFD_CREATE) && defined(MFD_HUGETLB)
+    const size_t huge_sz = hugetlb_page_size();
+    const off_t memfd_size = (total_size + huge_sz - 1) & ~(huge_sz - 1);
     void *real_mmapped = MAP_FAILED;
-    struct wl_shm_pool *wl_pool = NULL;
-    struct buffer_pool *pool = NULL;
 
-    /* Backing memory for SHM */
+    int pool_fd = memfd_create(
+        "foot-wayland-shm-buffer-pool",
+        MFD_CLOEXEC | MFD_ALLOW_SEALING | MFD_HUGETLB);
+
+    if (pool_fd < 0)
+        goto err;
+
+    if (ftruncate(pool_fd, memfd_size) < 0)
+        goto err;
+
+    real_mmapped = mmap(
+        NULL, memfd_size, PROT_READ | PROT_WRITE, MAP_SHARED, pool_fd, 0);
+
+    if (real_mmapped == MAP_FAILED)
+        goto err;
+
+    LOG_DBG("hugetlb memfd-size: %lu", (unsigned long)memfd_size);
+
+    *_memfd_size = memfd_size;
+    *_mmapped = real_mmapped;
+    return pool_fd;
+
+err:
+    LOG_WARN("failed to allocate SHM pool from huge pages (%s): "
+             "falling back to regular pages", strerror(errno));
+    hugetlb_failed = true;
+
+    if (pool_fd >= 0)
+        close(pool_fd);
+    return -1;
+#else
+    return -1;
+#endif
+}
+
+/*
+ * Allocates, and maps, a regular memfd (or tmpfile) backed pool. For
+ * scrollable chains, the pool is max_pool_size large, and the
+ * buffers start at '*offset'.
+ */
+static int
+pool_create(struct buffer_chain *chain, size_t total_size,
+            off_t *_offset, off_t *_memfd_size, void **_mmapped)
+{
+    int pool_fd = -1;
+
 #if defined(MEMFD_CREATE)
     /*
      * Older kernels reject MFD_NOEXEC_SEAL with EINVAL. Try first
@@ -391,7 +533,7 @@ get_new_buffers(struct buffer_chain *chain, size_t count,
 #endif
     if (pool_fd == -1) {
         LOG_ERRNO("failed to create SHM backing memory file");
-        goto err;
+        return -1;
     }
 
     const size_t page_sz = page_size();
@@ -402,7 +544,7 @@ get_new_buffers(struct buffer_chain *chain, size_t count,
         : 0;
     off_t memfd_size = chain->scrollable && max_pool_size > 0
         ? max_pool_size
-        : total_size;
+        : (off_t)total_size;
 #else
     off_t offset = 0;
     off_t memfd_size = total_size;
@@ -450,7 +592,7 @@ get_new_buffers(struct buffer_chain *chain, size_t count,
         }
     }
 
-    real_mmapped = mmap(
+    void *real_mmapped = mmap(
         NULL, memfd_size, PROT_READ | PROT_WRITE,
         MAP_SHARED | MAP_UNINITIALIZED, pool_fd, 0);
 
@@ -459,6 +601,124 @@ get_new_buffers(struct buffer_chain *chain, size_t count,
         goto err;
     }
 
+    if (hugepages == SHM_HUGEPAGES_TRANSPARENT &&
+        total_size >= HUGEPAGE_MIN_POOL_PAGES * huge_page_size())
+    {
+#if defined(MADV_HUGEPAGE)
+        if (madvise(real_mmapped, memfd_size, MADV_HUGEPAGE) < 0)
+            LOG_ERRNO("failed to enable transparent huge pages for SHM pool");
+#endif
+    }
+
+    *_offset = offset;
+    *_memfd_size = memfd_size;
+    *_mmapped = real_mmapped;
+    return pool_fd;
+
+err:
+    close(pool_fd);
+    return -1;
+}
+
+/*
+ * Pre-faults a newly created buffer's pages, in a single system call,
+ * instead of taking one page fault at a time when first rendering to
+ * it.
+ */
+static void
+prefault_buffer(const struct buffer_private *buf)
+{
+    if (!prefault)
+        return;
+
+    const size_t page_sz = page_size();
+    const uintptr_t start = (uintptr_t)buf->public.data & ~(page_sz - 1);
+    const uintptr_t end = (uintptr_t)buf->public.data + buf->size;
+    void *addr = (void *)start;
+    const size_t len = end - start;
+
+#if defined(MADV_POPULATE_WRITE)
+    static bool populate_write_supported = true;
+
+    if (populate_write_supported) {
+        if (madvise(addr, len, MADV_POPULATE_WRITE) == 0)
+            return;
+
+        if (errno == EINVAL) {
+            /* Kernel too old (< 5.14) */
+            populate_write_supported = false;
+        } else {
+            LOG_ERRNO("failed to pre-fault SHM buffer");
+            return;
+        }
+    }
+#endif
+
+    madvise(addr, len, MADV_WILLNEED);
+}
+
+static void NOINLINE
+get_new_buffers(struct buffer_chain *chain, size_t count,
+                int widths[static count], int heights[static count],
+                struct buffer *bufs[static count], bool immediate_purge)
+{
+    xassert(count == 1 || !chain->scrollable);
+    /*
+     * No existing buffer available. Create a new one by:
+     *
+     * 1. open a memory backed "file" with memfd_create()
+     * 2. mmap() the memory file, to be used by the pixman image
+     * 3. create a wayland shm buffer for the same memory file
+     *
+     * The pixman image and the wayland buffer are now sharing memory.
+     */
+
+    int stride[count];
+    int sizes[count];
+
+    size_t total_size = 0;
+    for (size_t i = 0; i < count; i++) {
+        stride[i] = stride_for_format_and_width(
+            chain->pixman_fmt, widths[i]);
+
+        if (min_stride_alignment > 0) {
+            const size_t m = min_stride_alignment;
+            stride[i] = (stride[i] + m - 1) / m * m;
+        }
+
+        xassert(min_stride_alignment == 0 || stride[i] % min_stride_alignment == 0);
+        sizes[i] = stride[i] * heights[i];
+        total_size += sizes[i];
+    }
+    if (total_size == 0)
+        return;
+
+    int pool_fd = -1;
+    off_t offset = 0;
+    off_t memfd_size = 0;
+    bool scrollable = chain->scrollable;
+
+    void *real_mmapped = MAP_FAILED;
+    struct wl_shm_pool *wl_pool = NULL;
+    struct buffer_pool *pool = NULL;
+
+    if (use_hugetlb(total_size)) {
+        pool_fd = pool_create_hugetlb(total_size, &memfd_size, &real_mmapped);
+
+        /* Huge pages can't be punched at arbitrary offsets */
+        if (pool_fd >= 0)
+            scrollable = false;
+    }
+
+    if (pool_fd < 0) {
+        pool_fd = pool_create(
+            chain, total_size, &offset, &memfd_size, &real_mmapped);
+        scrollable = chain->scrollable;
+    }
+
+    if (pool_fd < 0)
+        goto err;
+
 #if defined(MEMFD_CREATE)
     /* Seal file - we no longer allow any kind of resizing */
     /* TODO: wayland mmaps(PROT_WRITE), for some unknown reason, hence we cannot use F_SEAL_FUTURE_WRITE */
@@ -512,7 +772,8 @@ get_new_buffers(struct buffer_chain *chain, size_t count,
             .pool = pool,
             .offset = 0,
             .size = sizes[i],
-            .scrollable = chain->scrollable,
+            .scrollable = scrollable,
+            .shm_format = chain->shm_format,
             .release_cb = chain->release_cb,
             .cb_data = chain->cb_data,
         };
@@ -522,6 +783,8 @@ get_new_buffers(struct buffer_chain *chain, size_t count,
             goto err;
         }
 
+        prefault_buffer(buf);
+
         if (immediate_purge)
             tll_push_front(deferred, buf);
         else
@@ -535,6 +798,7 @@ get_new_buffers(struct buffer_chain *chain, size_t count,
 
         pool->ref_count++;
         offset += buf->size;
+        allocated_size += buf->size;
         bufs[i] = &buf->public;
     }
 
@@ -570,6 +834,66 @@ err:
     abort();
 }
 
+/* Moves an unused buffer, no longer referenced by its chain, to 'spares' */
+static void
+buffer_park(struct buffer_private *buf)
+{
+    xassert(!buf->busy);
+    xassert(buf->ref_count == 1);
+
+    if (tll_length(spares) >= MAX_SPARE_BUFFERS) {
+        /* Destroy the oldest one */
+        buffer_destroy(tll_pop_front(spares));
+    }
+
+    buf->chain = NULL;
+    buf->ref_count = 0;
+    buf->release_cb = NULL;
+    buf->cb_data = NULL;
+    clock_gettime(CLOCK_MONOTONIC, &buf->parked_at);
+
+    tll_push_back(spares, buf);
+}
+
+/* Moves a matching buffer from 'spares' to the chain, or returns NULL */
+static struct buffer_private *
+buffer_unpark(struct buffer_chain *chain, int width, int height)
+{
+    tll_rforeach(spares, it) {
+        struct buffer_private *buf = it->item;
+
+        if (buf->public.width != width ||
+            buf->public.height != height ||
+            buf->public.pix_instances != chain->pix_instances ||
+            buf->shm_format != chain->shm_format ||
+            buf->scrollable != chain->scrollable)
+        {
+            continue;
+        }
+
+        tll_remove(spares, it);
+
+        LOG_DBG("chain=%p: re-using spare %dx%d buffer %p",
+                (void *)chain, width, height, (void *)buf);
+
+        buf->chain = chain;
+        buf->ref_count = 1;
+        buf->busy = true;
+        buf->release_cb = chain->release_cb;
+        buf->cb_data = chain->cb_data;
+
+        /* Contents are from another terminal; force a full repaint */
+        buf->public.age = 1234;
+        for (size_t i = 0; i < buf->public.pix_instances; i++)
+            pixman_region32_clear(&buf->public.dirty[i]);
+
+        tll_push_front(chain->bufs, buf);
+        return buf;
+    }
+
+    return NULL;
+}
+
 void
 shm_did_not_use_buf(struct buffer *_buf)
 {
@@ -647,6 +971,12 @@ shm_get_buffer(struct buffer_chain *chain, int width, int height)
         return &cached->public;
     }
 
+    if (share_buffers) {
+        struct buffer_private *spare = buffer_unpark(chain, width, height);
+        if (spare != NULL)
+            return &spare->public;
+    }
+
     struct buffer *ret;
     get_new_buffers(chain, 1, &width, &height, &ret, false);
     return ret;
@@ -963,6 +1293,63 @@ shm_purge(struct buffer_chain *chain)
     }
 }
 
+size_t
+shm_chain_trim(struct buffer_chain *chain)
+{
+    size_t count = 0;
+
+    tll_foreach(chain->bufs, it) {
+        struct buffer_private *buf = it->item;
+
+        /* Skip buffers held by the compositor, or referenced elsewhere */
+        if (buf->busy || buf->ref_count > 1)
+            continue;
+
+        if (share_buffers) {
+            tll_remove(chain->bufs, it);
+            buffer_park(buf);
+        } else if (buffer_unref_no_remove_from_chain(buf))
+            tll_remove(chain->bufs, it);
+
+        count++;
+    }
+
+    return count;
+}
+
+size_t
+shm_expire_spares(uint32_t max_age_secs)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    size_t count = 0;
+
+    tll_foreach(spares, it) {
+        struct buffer_private *buf = it->item;
+
+        if (now.tv_sec - buf->parked_at.tv_sec < (time_t)max_age_secs)
+            continue;
+
+        buffer_destroy(buf);
+        tll_remove(spares, it);
+        count++;
+    }
+
+    return count;
+}
+
+void
+shm_stats(size_t *total_size, size_t *spare_size)
+{
+    size_t spare = 0;
+    tll_foreach(spares, it)
+        spare += it->item->size;
+
+    *total_size = allocated_size;
+    *spare_size = spare;
+}
+
 void
 shm_addref(struct buffer *_buf)
 {
@@ -1084,6 +1471,10 @@ shm_chain_free(struct buffer_chain *chain)
     if (chain == NULL)
         return;
 
+    /* Let other terminals re-use our buffers */
+    if (share_buffers)
+        shm_chain_trim(chain);
+
     shm_purge(chain);
 
     if (tll_length(chain->bufs) > 0) {
@@ -2,6 +2,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 #include <pixman.h>
@@ -46,6 +47,15 @@ void shm_fini(void);
 /* TODO: combine into shm_init() */
 void shm_set_max_pool_size(off_t max_pool_size);
 void shm_set_min_stride_alignment(size_t min_stride_alignment);
+void shm_set_hugepages(enum shm_hugepages hugepages);
+void shm_set_prefault(bool prefault);
+
+/*
+ * When enabled, buffers released by shm_chain_trim() and
+ * shm_chain_free() are kept as spares, and re-used by any chain
+ * requesting a buffer of the same size and format.
+ */
+void shm_set_share_buffers(bool share_buffers);
 
 struct buffer_chain;
 struct buffer_chain *shm_chain_new(
@@ -96,3 +106,16 @@ void shm_addref(struct buffer *buf);
 void shm_unref(struct buffer *buf);
 
 void shm_purge(struct buffer_chain *chain);
+
+/*
+ * Releases all buffers in the chain that are neither held by the
+ * compositor, nor referenced outside the chain. Returns the number of
+ * released buffers.
+ */
+size_t shm_chain_trim(struct buffer_chain *chain);
+
+/* Destroys spare buffers older than 'max_age_secs' */
+size_t shm_expire_spares(uint32_t max_age_secs);
+
+/* Total size of all buffers, and of the spare buffers, in bytes */
+void shm_stats(size_t *total_size, size_t *spare_size);
@@ -233,13 +233,13 @@ sixel_erase(struct terminal *term, struct sixel *sixel)
     for (int i = 0; i < sixel->rows; i++) {
         int r = (sixel->pos.row + i) & (term->grid->num_rows - 1);
 
-        struct row *row = term->grid->rows[r];
+        struct row *row = grid_row_unpacked(term->grid, r);
         if (row == NULL) {
             /* A resize/reflow may cause row to now be unallocated */
             continue;
         }
 
-        row->dirty = true;
+        grid_row_dirty(row);
 
         for (int c = sixel->pos.col; c < min(sixel->pos.col + sixel->cols, term->cols); c++)
             row->cells[c].attrs.clean = 0;
@@ -1366,8 +1366,10 @@ sixel_unhook(struct terminal *term)
 
         /* Dirty touched cells, and scroll terminal content if necessary */
         for (size_t i = 0; i < image.rows; i++) {
-            struct row *row = term->grid->rows[cur_row + i];
-            row->dirty = true;
+            struct row *row = grid_row_unpacked(term->grid, cur_row + i);
+            grid_row_dirty_cols(
+                row, image.pos.col,
+                min(image.pos.col + image.cols, term->cols) - 1);
 
             for (int col = image.pos.col;
                  col < min(image.pos.col + image.cols, term->cols);
@@ -49,6 +49,9 @@
 
 #define PTMX_TIMING 0
 
+/* Don't bother collecting unused composed characters below this */
+#define COMPOSED_GC_MIN_THRESHOLD 4096
+
 static void
 enqueue_data_for_slave(const void *data, size_t len, size_t offset,
                        ptmx_buffer_list_t *buffer_list)
@@ -469,9 +472,9 @@ fdm_blink(struct fdm *fdm, int fd, int events, void *data)
         for (int col = 0; col < term->cols; col++) {
             struct cell *cell = &row->cells[col];
 
-            if (cell->attrs.blink) {
+            if (term_cell_attrs(term, cell).blink) {
                 cell->attrs.clean = 0;
-                row->dirty = true;
+                grid_row_dirty_cols(row, col, col);
                 no_blinking_cells = false;
             }
         }
@@ -526,8 +529,9 @@ cursor_refresh(struct terminal *term)
     if (!term->window->is_configured)
         return;
 
-    term->grid->cur_row->cells[term->grid->cursor.point.col].attrs.clean = 0;
-    term->grid->cur_row->dirty = true;
+    const int col = term->grid->cursor.point.col;
+    term->grid->cur_row->cells[col].attrs.clean = 0;
+    grid_row_dirty_cols(term->grid->cur_row, col, col);
     render_refresh(term);
 }
 
@@ -704,14 +708,10 @@ fdm_app_id_update_timeout(struct fdm *fdm, int fd, int events, void *data)
 }
 
 static bool
-initialize_render_workers(struct terminal *term)
+initialize_render_workers(struct terminal *term, struct render_pool *shared_pool)
 {
-    LOG_INFO("using %hu rendering threads", term->render.workers.count);
-
-    if (sem_init(&term->render.workers.start, 0, 0) < 0 ||
-        sem_init(&term->render.workers.done, 0, 0) < 0)
-    {
-        LOG_ERRNO("failed to instantiate render worker semaphores");
+    if (sem_init(&term->render.workers.done, 0, 0) < 0) {
+        LOG_ERRNO("failed to instantiate render worker semaphore");
         return false;
     }
 
@@ -725,35 +725,82 @@ initialize_render_workers(struct terminal *term)
     mtx_init(&term->render.workers.preapplied_damage.lock, mtx_plain);
     cnd_init(&term->render.workers.preapplied_damage.cond);
 
-    term->render.workers.threads = xcalloc(
-        term->render.workers.count, sizeof(term->render.workers.threads[0]));
-
-    for (size_t i = 0; i < term->render.workers.count; i++) {
-        struct render_worker_context *ctx = xmalloc(sizeof(*ctx));
-        *ctx = (struct render_worker_context) {
-            .term = term,
-            .my_id = 1 + i,
-        };
-
-        int ret = thrd_create(
-            &term->render.workers.threads[i], &render_worker_thread, ctx);
-        if (ret != thrd_success) {
+    term->render.workers.glyph_caches = xcalloc(
+        term->render.workers.count + 1,
+        sizeof(term->render.workers.glyph_caches[0]));
+    term->render.workers.glyph_lookup = xcalloc(
+        term->render.workers.count + 1,
+        sizeof(term->render.workers.glyph_lookup[0]));
+    term->render.workers.color_lru = xcalloc(
+        term->render.workers.count + 1,
+        sizeof(term->render.workers.color_lru[0]));
+    term->render.workers.solid_fills = xcalloc(
+        term->render.workers.count + 1,
+        sizeof(term->render.workers.solid_fills[0]));
+
+    if (term->render.workers.count == 0)
+        return true;
 
-            LOG_ERR("failed to create render worker thread: %s (%d)",
-                    thrd_err_as_string(ret), ret);
-            term->render.workers.threads[i] = 0;
-            return false;
-        }
+    if (shared_pool != NULL) {
+        LOG_INFO("using %hu shared rendering threads",
+                 term->render.workers.count);
+        term->render.workers.pool = shared_pool;
+        return true;
     }
 
-    return true;
+    LOG_INFO("using %hu rendering threads", term->render.workers.count);
+
+    term->render.workers.pool = render_pool_new(term->render.workers.count);
+    term->render.workers.own_pool = true;
+    return term->render.workers.pool != NULL;
 
 err_sem_destroy:
-    sem_destroy(&term->render.workers.start);
     sem_destroy(&term->render.workers.done);
     return false;
 }
 
+static void
+free_glyph_caches(struct terminal *term)
+{
+    if (term->render.workers.glyph_caches == NULL)
+        return;
+
+    for (size_t i = 0; i < term->render.workers.count + 1; i++) {
+        pixman_glyph_cache_t **cache = &term->render.workers.glyph_caches[i];
+
+        if (*cache == NULL)
+            continue;
+
+        pixman_glyph_cache_destroy(*cache);
+        *cache = NULL;
+    }
+
+    if (term->render.workers.glyph_lookup != NULL) {
+        memset(term->render.workers.glyph_lookup, 0,
+               (term->render.workers.count + 1) *
+               sizeof(term->render.workers.glyph_lookup[0]));
+    }
+}
+
+static void
+free_solid_fills(struct terminal *term)
+{
+    if (term->render.workers.solid_fills == NULL)
+        return;
+
+    for (size_t i = 0; i < term->render.workers.count + 1; i++) {
+        struct solid_fill_cache *cache = &term->render.workers.solid_fills[i];
+
+        for (size_t j = 0; j < ALEN(cache->entries); j++) {
+            if (cache->entries[j].pix != NULL)
+                pixman_image_unref(cache->entries[j].pix);
+        }
+    }
+
+    free(term->render.workers.solid_fills);
+    term->render.workers.solid_fills = NULL;
+}
+
 static void
 free_custom_glyph(struct fcft_glyph **glyph)
 {
@@ -821,6 +868,8 @@ term_set_fonts(struct terminal *term, struct fcft_font *fonts[static 4],
         term->fonts[i] = fonts[i];
     }
 
+    /* Cached glyphs reference the old fonts */
+    free_glyph_caches(term);
     free_custom_glyphs(
         &term->custom_glyphs.box_drawing, GLYPH_BOX_DRAWING_COUNT);
     free_custom_glyphs(
@@ -1170,8 +1219,9 @@ static const int PTY_OPEN_FLAGS = O_RDWR | O_NOCTTY;
 
 struct terminal *
 term_init(const struct config *conf, struct fdm *fdm, struct reaper *reaper,
-          struct wayland *wayl, const char *foot_exe, const char *cwd,
-          const char *token, const char *pty_path,
+          struct wayland *wayl, struct render_pool *render_pool,
+          const char *foot_exe, const char *cwd, const char *token,
+          const char *pty_path,
           int argc, char *const *argv, const char *const *envp,
           void (*shutdown_cb)(void *data, int exit_code), void *shutdown_data)
 {
@@ -1351,7 +1401,7 @@ term_init(const struct config *conf, struct fdm *fdm, struct reaper *reaper,
         .normal = {.scroll_damage = tll_init(), .sixel_images = tll_init()},
         .alt = {.scroll_damage = tll_init(), .sixel_images = tll_init()},
         .grid = &term->normal,
-        .composed = NULL,
+        .composed_gc_threshold = COMPOSED_GC_MIN_THRESHOLD,
         .alt_scrolling = conf->mouse.alternate_scroll_mode,
         .meta = {
             .esc_prefix = true,
@@ -1384,8 +1434,14 @@ term_init(const struct config *conf, struct fdm *fdm, struct reaper *reaper,
                 .timer_fd = app_id_update_fd,
             },
             .workers = {
-                .count = conf->render_worker_count,
-                .queue = tll_init(),
+                .count = (render_pool != NULL
+                          ? render_pool_count(render_pool)
+                          : conf->render_worker_count),
+                .rows_job = {.term = term, .kind = RENDER_JOB_ROWS},
+                .preapply_job = {
+                    .term = term,
+                    .kind = RENDER_JOB_PREAPPLY_DAMAGE,
+                },
             },
         },
         .delayed_render_timer = {
@@ -1480,7 +1536,7 @@ term_init(const struct config *conf, struct fdm *fdm, struct reaper *reaper,
         break;
     }
 
-    if (!initialize_render_workers(term))
+    if (!initialize_render_workers(term, render_pool))
         goto err;
 
     return term;
@@ -1844,24 +1900,9 @@ term_destroy(struct terminal *term)
         term->window = NULL;
     }
 
-    mtx_lock(&term->render.workers.lock);
-    xassert(tll_length(term->render.workers.queue) == 0);
-
-    /* Count livinig threads - we may get here when only some of the
-     * threads have been successfully started */
-    size_t worker_count = 0;
-    if (term->render.workers.threads != NULL) {
-        for (size_t i = 0; i < term->render.workers.count; i++, worker_count++) {
-            if (term->render.workers.threads[i] == 0)
-                break;
-        }
-
-        for (size_t i = 0; i < worker_count; i++) {
-            sem_post(&term->render.workers.start);
-            tll_push_back(term->render.workers.queue, -2);
-        }
-    }
-    mtx_unlock(&term->render.workers.lock);
+    /* A worker may still be pre-applying damage */
+    if (term->render.workers.pool != NULL)
+        render_wait_for_preapply_damage(term);
 
     key_binding_unref(term->wl->key_binding_manager, term->conf);
 
@@ -1870,7 +1911,10 @@ term_destroy(struct terminal *term)
     free(term->vt.osc.data);
     free(term->vt.osc8.uri);
 
-    composed_free(term->composed);
+    composed_free(&term->composed);
+#if defined(FOOT_COMPACT_CELLS)
+    attr_palette_free(&term->attrs_palette);
+#endif
 
     free(term->app_id);
     free(term->window_title);
@@ -1894,20 +1938,18 @@ term_destroy(struct terminal *term)
     free(term->search.buf);
     free(term->search.last.buf);
 
-    if (term->render.workers.threads != NULL) {
-        for (size_t i = 0; i < term->render.workers.count; i++) {
-            if (term->render.workers.threads[i] != 0)
-                thrd_join(term->render.workers.threads[i], NULL);
-        }
-    }
-    free(term->render.workers.threads);
+    if (term->render.workers.own_pool)
+        render_pool_destroy(term->render.workers.pool);
     mtx_destroy(&term->render.workers.preapplied_damage.lock);
     cnd_destroy(&term->render.workers.preapplied_damage.cond);
     mtx_destroy(&term->render.workers.lock);
-    sem_destroy(&term->render.workers.start);
     sem_destroy(&term->render.workers.done);
-    xassert(tll_length(term->render.workers.queue) == 0);
-    tll_free(term->render.workers.queue);
+    free(term->render.workers.rows);
+    free_glyph_caches(term);
+    free(term->render.workers.glyph_caches);
+    free(term->render.workers.glyph_lookup);
+    free(term->render.workers.color_lru);
+    free_solid_fills(term);
 
     shm_unref(term->render.last_buf);
     shm_chain_free(term->render.chains.grid);
@@ -1943,6 +1985,7 @@ term_destroy(struct terminal *term)
 
     term_ime_reset(term);
 
+    render_reflow_cancel(term);
     grid_free(&term->normal);
     grid_free(&term->alt);
     grid_free(term->interactive_resizing.grid);
@@ -2054,15 +2097,18 @@ erase_cell_range(struct terminal *term, struct row *row, int start, int end)
     xassert(start < term->cols);
     xassert(end < term->cols);
 
-    row->dirty = true;
+    grid_row_dirty_cols(row, start, end);
 
     const enum color_source bg_src = term->vt.attrs.bg_src;
 
     if (unlikely(bg_src != COLOR_DEFAULT)) {
+        const cell_attrs_t attrs = term_attrs_to_cell(
+            term, &(struct attributes){.bg_src = bg_src, .bg = term->vt.attrs.bg});
+
         for (int col = start; col <= end; col++) {
             struct cell *c = &row->cells[col];
             c->wc = 0;
-            c->attrs = (struct attributes){.bg_src = bg_src, .bg = term->vt.attrs.bg};
+            c->attrs = attrs;
         }
     } else
         memset(&row->cells[start], 0, (end - start + 1) * sizeof(row->cells[0]));
@@ -2209,6 +2255,7 @@ term_reset(struct terminal *term, bool hard)
     term->cursor_blink.deccsusr = term->conf->cursor.blink.enabled;
     term_cursor_blink_update(term);
     selection_cancel(term);
+    render_reflow_cancel(term);
     term->normal.offset = term->normal.view = 0;
     term->alt.offset = term->alt.view = 0;
     for (size_t i = 0; i < term->rows; i++) {
@@ -2219,14 +2266,8 @@ term_reset(struct terminal *term, bool hard)
         struct row *r = grid_row_and_alloc(&term->alt, i);
         erase_line(term, r);
     }
-    for (size_t i = term->rows; i < term->normal.num_rows; i++) {
-        grid_row_free(term->normal.rows[i]);
-        term->normal.rows[i] = NULL;
-    }
-    for (size_t i = term->rows; i < term->alt.num_rows; i++) {
-        grid_row_free(term->alt.rows[i]);
-        term->alt.rows[i] = NULL;
-    }
+    grid_free_rows(&term->normal, term->rows, term->normal.num_rows);
+    grid_free_rows(&term->alt, term->rows, term->alt.num_rows);
     term->normal.cur_row = term->normal.rows[0];
     term->alt.cur_row = term->alt.rows[0];
     tll_free(term->normal.scroll_damage);
@@ -2490,7 +2531,7 @@ term_damage_rows(struct terminal *term, int start, int end)
     xassert(start <= end);
     for (int r = start; r <= end; r++) {
         struct row *row = grid_row(term->grid, r);
-        row->dirty = true;
+        grid_row_dirty(row);
         for (int c = 0; c < term->grid->num_cols; c++)
             row->cells[c].attrs.clean = 0;
     }
@@ -2502,7 +2543,7 @@ term_damage_rows_in_view(struct terminal *term, int start, int end)
     xassert(start <= end);
     for (int r = start; r <= end; r++) {
         struct row *row = grid_row_in_view(term->grid, r);
-        row->dirty = true;
+        grid_row_dirty(row);
         for (int c = 0; c < term->grid->num_cols; c++)
             row->cells[c].attrs.clean = 0;
     }
@@ -2523,8 +2564,9 @@ term_damage_view(struct terminal *term)
 void
 term_damage_cursor(struct terminal *term)
 {
-    term->grid->cur_row->cells[term->grid->cursor.point.col].attrs.clean = 0;
-    term->grid->cur_row->dirty = true;
+    const int col = term->grid->cursor.point.col;
+    term->grid->cur_row->cells[col].attrs.clean = 0;
+    grid_row_dirty_cols(term->grid->cur_row, col, col);
 }
 
 void
@@ -2544,12 +2586,13 @@ term_damage_color(struct terminal *term, enum color_source src, int idx)
         const struct cell *end = &row->cells[term->cols];
 
         for (; cell < end; cell++) {
+            const struct attributes attrs = term_cell_attrs(term, cell);
             bool dirty = false;
 
-            switch (cell->attrs.fg_src) {
+            switch (attrs.fg_src) {
             case COLOR_BASE16:
             case COLOR_BASE256:
-                if (src == COLOR_BASE256 && cell->attrs.fg == idx)
+                if (src == COLOR_BASE256 && attrs.fg == idx)
                     dirty = true;
                 break;
 
@@ -2568,10 +2611,10 @@ term_damage_color(struct terminal *term, enum color_source src, int idx)
                 break;
             }
 
-            switch (cell->attrs.bg_src) {
+            switch (attrs.bg_src) {
             case COLOR_BASE16:
             case COLOR_BASE256:
-                if (src == COLOR_BASE256 && cell->attrs.bg == idx)
+                if (src == COLOR_BASE256 && attrs.bg == idx)
                     dirty = true;
                 break;
 
@@ -2592,7 +2635,7 @@ term_damage_color(struct terminal *term, enum color_source src, int idx)
 
             if (dirty) {
                 cell->attrs.clean = 0;
-                row->dirty = true;
+                grid_row_dirty(row);
             }
         }
 
@@ -2616,7 +2659,7 @@ term_damage_color(struct terminal *term, enum color_source src, int idx)
                     for (; c < e; c++)
                         c->attrs.clean = 0;
 
-                    row->dirty = true;
+                    grid_row_dirty(row);
                 }
             }
         }
@@ -2627,28 +2670,120 @@ void
 term_damage_scroll(struct terminal *term, enum damage_type damage_type,
                    struct scroll_region region, int lines)
 {
+    /*
+     * Scrolling the entire region (or more) doesn't move anything in
+     * the buffer; all rows in the region have been replaced, and are
+     * repainted (see grid_render_scroll()). Thus, cap the line count
+     * at the region size. This also means we never overflow.
+     */
+    const int region_size = min(region.end - region.start, UINT16_MAX);
+    struct damage *dmg = NULL;
+
     if (likely(tll_length(term->grid->scroll_damage) > 0)) {
-        struct damage *dmg = &tll_back(term->grid->scroll_damage);
+        struct damage *last = &tll_back(term->grid->scroll_damage);
 
         if (likely(
-                dmg->type == damage_type &&
-                dmg->region.start == region.start &&
-                dmg->region.end == region.end))
+                last->type == damage_type &&
+                last->region.start == region.start &&
+                last->region.end == region.end))
         {
-            /* Make sure we don't overflow... */
-            int new_line_count = (int)dmg->lines + lines;
-            if (likely(new_line_count <= UINT16_MAX)) {
-                dmg->lines = new_line_count;
-                return;
+            dmg = last;
+            dmg->lines = min((int)dmg->lines + lines, region_size);
+        }
+    }
+
+    if (dmg == NULL) {
+        tll_push_back(
+            term->grid->scroll_damage,
+            ((struct damage){
+                .type = damage_type,
+                .region = region,
+                .lines = min(lines, region_size),
+            }));
+        dmg = &tll_back(term->grid->scroll_damage);
+    }
+
+    /*
+     * If the whole screen has been scrolled out, all its rows are new
+     * (and dirty). Any preceding scroll damage would only move
+     * content that is about to be repainted anyway.
+     *
+     * Only do this for scrolls of the grid itself; those are only
+     * applied if the view follows the grid offset, in which case the
+     * view consists of the scrolled in rows. Scroll damage from
+     * scrolling the view (*_IN_VIEW) is kept, since it is applied
+     * even when the view does *not* follow the grid offset.
+     */
+    if ((damage_type == DAMAGE_SCROLL ||
+         damage_type == DAMAGE_SCROLL_REVERSE) &&
+        region.start == 0 && region.end == term->rows &&
+        dmg->lines >= region_size &&
+        tll_length(term->grid->scroll_damage) > 1)
+    {
+        tll_foreach(term->grid->scroll_damage, it) {
+            if (&it->item == dmg)
+                break;
+
+            if (it->item.type == DAMAGE_SCROLL ||
+                it->item.type == DAMAGE_SCROLL_REVERSE)
+            {
+                tll_remove(term->grid->scroll_damage, it);
             }
         }
     }
-    struct damage dmg = {
-        .type = damage_type,
-        .region = region,
-        .lines = lines,
+}
+
+UNITTEST
+{
+    /*
+     * Verify consecutive scroll damage is coalesced, and that it is
+     * dropped when the whole screen is scrolled out (see render.c for
+     * the resulting buffer moves).
+     */
+    const int rows = 24;
+    const struct scroll_region full = {.start = 0, .end = rows};
+    const struct scroll_region partial = {.start = 2, .end = 10};
+
+    struct terminal term = {
+        .rows = rows,
+        .normal = {.scroll_damage = tll_init()},
     };
-    tll_push_back(term->grid->scroll_damage, dmg);
+    term.grid = &term.normal;
+
+    /* A couple of linefeeds at the bottom of the screen */
+    for (int i = 0; i < 5; i++)
+        term_damage_scroll(&term, DAMAGE_SCROLL, full, 1);
+
+    xassert(tll_length(term.grid->scroll_damage) == 1);
+    xassert(tll_front(term.grid->scroll_damage).lines == 5);
+
+    /* Lots of linefeeds; the whole screen is scrolled out */
+    for (int i = 0; i < 100000; i++)
+        term_damage_scroll(&term, DAMAGE_SCROLL, full, 1);
+
+    xassert(tll_length(term.grid->scroll_damage) == 1);
+    xassert(tll_front(term.grid->scroll_damage).lines == rows);
+    tll_free(term.grid->scroll_damage);
+
+    /* Different regions, and directions, are not merged... */
+    for (int i = 0; i < 3; i++)
+        term_damage_scroll(&term, DAMAGE_SCROLL, partial, 1);
+    term_damage_scroll(&term, DAMAGE_SCROLL_REVERSE, partial, 1);
+    term_damage_scroll(&term, DAMAGE_SCROLL_IN_VIEW, full, 1);
+    term_damage_scroll(&term, DAMAGE_SCROLL, full, 1);
+
+    xassert(tll_length(term.grid->scroll_damage) == 4);
+    xassert(tll_front(term.grid->scroll_damage).lines == 3);
+
+    /* ...but are dropped when the whole screen is scrolled out */
+    for (int i = 0; i < rows; i++)
+        term_damage_scroll(&term, DAMAGE_SCROLL, full, 1);
+
+    xassert(tll_length(term.grid->scroll_damage) == 2);
+    xassert(tll_front(term.grid->scroll_damage).type == DAMAGE_SCROLL_IN_VIEW);
+    xassert(tll_back(term.grid->scroll_damage).type == DAMAGE_SCROLL);
+    xassert(tll_back(term.grid->scroll_damage).lines == rows);
+    tll_free(term.grid->scroll_damage);
 }
 
 void
@@ -2691,6 +2826,9 @@ term_erase_scrollback(struct terminal *term)
     if (scrollback_history_size == 0)
         return;
 
+    if (term->grid == &term->normal)
+        render_reflow_cancel(term);
+
     const int start = (grid->offset + term->rows) & mask;
     const int end = (grid->offset - 1) & mask;
 
@@ -2748,6 +2886,10 @@ term_erase_scrollback(struct terminal *term)
             if (term->render.last_cursor.row == row)
                 term->render.last_cursor.row = NULL;
 
+            /* Keeps the grid's packed/unpacked byte counters in sync */
+            if (row->cells == NULL)
+                grid_row_discard_packed(term->grid, row);
+
             grid_row_free(row);
             term->grid->rows[i] = NULL;
         }
@@ -3105,6 +3247,10 @@ term_scroll_partial(struct terminal *term, struct scroll_region region, int rows
         cmd_scrollback_down(term, rows - view_sb_start_distance);
     }
 
+    /* Compress rows that have now scrolled far enough */
+    if (term->grid == &term->normal)
+        grid_pack_cold_rows(term->grid, term->rows, rows);
+
     /* Top non-scrolling region. */
     for (int i = region.start - 1; i >= 0; i--)
         grid_swap_row(term->grid, i - rows, i);
@@ -3924,7 +4070,7 @@ print_spacer(struct terminal *term, int col, int remaining)
     struct cell *cell = &row->cells[col];
 
     cell->wc = CELL_SPACER + remaining;
-    cell->attrs = (struct attributes){0};
+    cell->attrs = (cell_attrs_t){0};
 }
 
 /*
@@ -3944,13 +4090,13 @@ term_fill(struct terminal *term, int r, int c, uint8_t data, size_t count,
     bool use_sgr_attrs)
 {
     struct row *row = grid_row(term->grid, r);
-    row->dirty = true;
 
     xassert(c + count <= term->cols);
+    grid_row_dirty_cols(row, c, c + count - 1);
 
-    struct attributes attrs = use_sgr_attrs
-        ? term->vt.attrs
-        : (struct attributes){0};
+    const cell_attrs_t attrs = use_sgr_attrs
+        ? term_attrs_to_cell(term, &term->vt.attrs)
+        : (cell_attrs_t){0};
 
     const struct cell *last = &row->cells[c + count];
     for (struct cell *cell = &row->cells[c]; cell < last; cell++) {
@@ -4028,6 +4174,7 @@ term_print(struct terminal *term, char32_t wc, int width, bool insert_mode_disab
          * pad with spacers */
         for (size_t i = col; i < term->cols; i++)
             print_spacer(term, i, 0);
+        grid_row_dirty_cols(grid->cur_row, col, term->cols - 1);
 
         /* And force a line-wrap */
         grid->cursor.lcf = 1;
@@ -4039,12 +4186,15 @@ term_print(struct terminal *term, char32_t wc, int width, bool insert_mode_disab
 
     /* *Must* get current cell *after* linewrap+insert */
     struct row *row = grid->cur_row;
-    row->dirty = true;
+    if (unlikely(term->insert_mode))
+        grid_row_dirty(row);  /* print_insert() moved the whole tail */
+    else
+        grid_row_dirty_cols(row, col, min(col + width, term->cols) - 1);
     row->linebreak = true;
 
     struct cell *cell = &row->cells[col];
     cell->wc = term->vt.last_printed = wc;
-    cell->attrs = term->vt.attrs;
+    cell->attrs = term_attrs_to_cell(term, &term->vt.attrs);
 
     if (unlikely(term->vt.osc8.uri != NULL)) {
         for (int i = 0; i < width && (col + i) < term->cols; i++) {
@@ -4092,6 +4242,182 @@ term_print(struct terminal *term, char32_t wc, int width, bool insert_mode_disab
 #endif
 }
 
+/*
+ * Prints a run of codepoints, with pre-computed widths (all > 0),
+ * using the current SGR attributes. The codepoints must already have
+ * been processed (i.e. grapheme clustering, combining characters
+ * etc).
+ *
+ * The run is written one row segment at a time; per-row work (dirty
+ * marking, sixel overwrite, URI/underline range erase) is done once
+ * per segment, instead of once per character. The end result is
+ * identical to calling term_print() once for each codepoint.
+ */
+void
+term_print_run(struct terminal *term, const char32_t *wcs,
+               const uint8_t *widths, size_t count)
+{
+    if (unlikely(term->insert_mode ||
+                 term->charsets.set[term->charsets.selected] == CHARSET_GRAPHIC ||
+                 term->vt.osc8.uri != NULL ||
+                 term->vt.underline.style > UNDERLINE_SINGLE ||
+                 term->vt.underline.color_src != COLOR_DEFAULT))
+    {
+        for (size_t i = 0; i < count; i++)
+            term_print(term, wcs[i], widths[i], false);
+        return;
+    }
+
+    struct grid *grid = term->grid;
+    const cell_attrs_t attrs = term_attrs_to_cell(term, &term->vt.attrs);
+
+    while (count > 0) {
+        print_linewrap(term);
+
+        /* *Must* get current row *after* linewrap */
+        struct row *row = grid->cur_row;
+        const int start = grid->cursor.point.col;
+
+        /* Number of characters that fit on the current row */
+        size_t n = 0;
+        int col = start;
+
+        if (likely(!grid->cursor.lcf)) {
+            while (n < count && col + widths[n] <= term->cols)
+                col += widths[n++];
+        }
+
+        if (unlikely(n == 0)) {
+            /*
+             * Multi-column character that doesn't fit on the current
+             * row, or auto-margin disabled and we're at the right
+             * margin. Let term_print() deal with it.
+             */
+            term_print(term, wcs[0], widths[0], false);
+            wcs++;
+            widths++;
+            count--;
+            continue;
+        }
+
+        sixel_overwrite_by_row(term, grid->cursor.point.row, start, col - start);
+
+        grid_row_dirty_cols(row, start, col - 1);
+        row->linebreak = true;
+
+        struct cell *cell = &row->cells[start];
+        for (size_t i = 0; i < n; i++) {
+            cell->wc = wcs[i];
+            cell->attrs = attrs;
+            cell++;
+
+            for (int j = 1; j < widths[i]; j++, cell++) {
+                cell->wc = CELL_SPACER + widths[i] - j;
+                cell->attrs = (cell_attrs_t){0};
+            }
+        }
+
+        if (unlikely(row->extra != NULL)) {
+            grid_row_uri_range_erase(row, start, col - 1);
+            grid_row_underline_range_erase(row, start, col - 1);
+        }
+
+        term->vt.last_printed = wcs[n - 1];
+
+        if (col >= term->cols) {
+            xassert(col == term->cols);
+            grid->cursor.lcf = true;
+            col--;
+        } else
+            xassert(!grid->cursor.lcf);
+
+        grid->cursor.point.col = col;
+
+        wcs += n;
+        widths += n;
+        count -= n;
+    }
+
+#if defined(FOOT_GRAPHEME_CLUSTERING)
+    term->vt.codepoint_merging_ok = true;
+#endif
+}
+
+UNITTEST
+{
+    /* Verify term_print_run() is equivalent to repeated term_print() */
+    const int rows = 4;
+    const int cols = 7;
+
+    static const char32_t wcs[] = {
+        U'a', U'漢', U'b', U'c', U'x', U'字', U'字', U'd', U'字', U'e',
+        U'f', U'字', U'g',
+    };
+    static const uint8_t widths[] = {1, 2, 1, 1, 1, 2, 2, 1, 2, 1, 1, 2, 1};
+    _Static_assert(ALEN(wcs) == ALEN(widths), "length mismatch");
+
+    struct terminal terms[2];
+    struct row *row_storage[2][rows];
+
+    for (size_t t = 0; t < 2; t++) {
+        terms[t] = (struct terminal){
+            .rows = rows,
+            .cols = cols,
+            .normal = {
+                .rows = row_storage[t],
+                .num_rows = rows,
+                .num_cols = cols,
+            },
+            .auto_margin = true,
+            .scroll_region = {.start = 0, .end = rows},
+        };
+
+        struct terminal *term = &terms[t];
+        term->grid = &term->normal;
+
+        for (int r = 0; r < rows; r++) {
+            row_storage[t][r] = xcalloc(1, sizeof(struct row));
+            row_storage[t][r]->cells = xcalloc(cols, sizeof(struct cell));
+        }
+
+        term->normal.cur_row = row_storage[t][0];
+        term->vt.attrs.bold = true;
+    }
+
+    for (size_t i = 0; i < ALEN(wcs); i++)
+        term_print(&terms[0], wcs[i], widths[i], false);
+    term_print_run(&terms[1], wcs, widths, ALEN(wcs));
+
+    xassert(terms[0].normal.cursor.point.row == terms[1].normal.cursor.point.row);
+    xassert(terms[0].normal.cursor.point.col == terms[1].normal.cursor.point.col);
+    xassert(terms[0].normal.cursor.lcf == terms[1].normal.cursor.lcf);
+    xassert(terms[0].vt.last_printed == terms[1].vt.last_printed);
+
+    for (int r = 0; r < rows; r++) {
+        const struct row *a = row_storage[0][r];
+        const struct row *b = row_storage[1][r];
+
+        xassert(a->dirty == b->dirty);
+        xassert(a->linebreak == b->linebreak);
+
+        for (int c = 0; c < cols; c++) {
+            xassert(a->cells[c].wc == b->cells[c].wc);
+            xassert(memcmp(&a->cells[c].attrs, &b->cells[c].attrs,
+                           sizeof(a->cells[c].attrs)) == 0);
+        }
+    }
+
+    for (size_t t = 0; t < 2; t++) {
+        for (int r = 0; r < rows; r++) {
+            free(row_storage[t][r]->cells);
+            free(row_storage[t][r]);
+        }
+#if defined(FOOT_COMPACT_CELLS)
+        attr_palette_free(&terms[t].attrs_palette);
+#endif
+    }
+}
+
 static void
 ascii_printer_generic(struct terminal *term, char32_t wc)
 {
@@ -4114,12 +4440,12 @@ ascii_printer_fast(struct terminal *term, char32_t wc)
     const int uri_start = col;
 
     struct row *row = grid->cur_row;
-    row->dirty = true;
+    grid_row_dirty_cols(row, col, col);
     row->linebreak = true;
 
     struct cell *cell = &row->cells[col];
     cell->wc = term->vt.last_printed = wc;
-    cell->attrs = term->vt.attrs;
+    cell->attrs = term_attrs_to_cell(term, &term->vt.attrs);
 
     /* Advance cursor */
     if (unlikely(++col >= term->cols)) {
@@ -4151,6 +4477,79 @@ ascii_printer_single_shift(struct terminal *term, char32_t wc)
     term_update_ascii_printer(term);
 }
 
+/*
+ * Prints a run of printable ASCII characters (0x20-0x7e).
+ *
+ * When the fast ASCII printer is active, the run is written one row
+ * segment at a time, instead of character by character. The end
+ * result is identical to calling term->ascii_printer() once for each
+ * character.
+ */
+void
+term_print_ascii_run(struct terminal *term, const uint8_t *text, size_t len)
+{
+    if (unlikely(term->ascii_printer != &ascii_printer_fast)) {
+        /* Note: the printer may change while printing (single shift) */
+        for (size_t i = 0; i < len; i++) {
+            term_reset_grapheme_state(term);
+            term->ascii_printer(term, text[i]);
+        }
+        return;
+    }
+
+    struct grid *grid = term->grid;
+
+    xassert(term->charsets.set[term->charsets.selected] == CHARSET_ASCII);
+    xassert(!term->insert_mode);
+    xassert(tll_length(grid->sixel_images) == 0);
+
+    const cell_attrs_t attrs = term_attrs_to_cell(term, &term->vt.attrs);
+
+    while (len > 0) {
+        print_linewrap(term);
+
+        /* *Must* get current row *after* linewrap */
+        struct row *row = grid->cur_row;
+        const int start = grid->cursor.point.col;
+        const size_t count = min(len, (size_t)(term->cols - start));
+
+        xassert(count > 0);
+
+        grid_row_dirty_cols(row, start, start + count - 1);
+        row->linebreak = true;
+
+        struct cell *cell = &row->cells[start];
+        for (size_t i = 0; i < count; i++, cell++) {
+            cell->wc = text[i];
+            cell->attrs = attrs;
+        }
+
+        if (unlikely(row->extra != NULL)) {
+            grid_row_uri_range_erase(row, start, start + count - 1);
+            grid_row_underline_range_erase(row, start, start + count - 1);
+        }
+
+        int col = start + count;
+        if (col >= term->cols) {
+            xassert(col == term->cols);
+            grid->cursor.lcf = true;
+            col--;
+        } else
+            xassert(!grid->cursor.lcf);
+
+        grid->cursor.point.col = col;
+        term->vt.last_printed = text[count - 1];
+
+        text += count;
+        len -= count;
+    }
+
+    term_reset_grapheme_state(term);
+#if defined(FOOT_GRAPHEME_CLUSTERING)
+    term->vt.codepoint_merging_ok = true;
+#endif
+}
+
 void
 term_update_ascii_printer(struct terminal *term)
 {
@@ -4181,34 +4580,15 @@ term_single_shift(struct terminal *term, enum charset_designator idx)
 }
 
 #if defined(FOOT_GRAPHEME_CLUSTERING)
-static int
-emoji_vs_compare(const void *_key, const void *_entry)
-{
-    const struct emoji_vs *key = _key;
-    const struct emoji_vs *entry = _entry;
-
-    uint32_t cp = key->start;
-
-    if (cp < entry->start)
-        return -1;
-    else if (cp > entry->end)
-        return 1;
-    else
-        return 0;
-}
-
 UNITTEST
 {
-    /* Verify the emoji_vs list is sorted */
-    int64_t last_end = -1;
-
-    for (size_t i = 0; i < sizeof(emoji_vs) / sizeof(emoji_vs[0]); i++) {
-        const struct emoji_vs *vs = &emoji_vs[i];
-        xassert(vs->start <= vs->end);
-        xassert(vs->start > last_end);
-        xassert(vs->vs15 || vs->vs16);
-        last_end = vs->end;
-    }
+    xassert(emoji_vs_lookup(U'#') == (EMOJI_VS15 | EMOJI_VS16));
+    xassert(emoji_vs_lookup(U'©') == (EMOJI_VS15 | EMOJI_VS16));
+    xassert(emoji_vs_lookup(U'❤') == (EMOJI_VS15 | EMOJI_VS16));
+    xassert(emoji_vs_lookup(U'a') == 0);
+    xassert(emoji_vs_lookup(U'漢') == 0);
+    xassert(emoji_vs_lookup(0x10ffff) == 0);
+    xassert(emoji_vs_lookup(0xffffffff) == 0);
 }
 #endif
 
@@ -4247,7 +4627,7 @@ term_process_and_print_non_ascii(struct terminal *term, char32_t wc)
         /* Is base cell already a cluster? */
         const struct composed *composed =
             (base >= CELL_COMB_CHARS_LO && base <= CELL_COMB_CHARS_HI)
-            ? composed_lookup(term->composed, base - CELL_COMB_CHARS_LO)
+            ? composed_lookup(&term->composed, base - CELL_COMB_CHARS_LO)
             : NULL;
 
         uint32_t key;
@@ -4333,7 +4713,7 @@ term_process_and_print_non_ascii(struct terminal *term, char32_t wc)
             /* Check if we already have a match for the entire compose chain */
             const struct composed *cc =
                 composed_lookup_without_collision(
-                    term->composed, &key,
+                    &term->composed, &key,
                     composed != NULL ? composed->chars : &(char32_t){base},
                     composed != NULL ? composed->count : 1,
                     wc, 0);
@@ -4347,7 +4727,7 @@ term_process_and_print_non_ascii(struct terminal *term, char32_t wc)
                 /* No match - allocate a new chain below */
             }
 
-            if (unlikely(term->composed_count >=
+            if (unlikely(term->composed.count >=
                          (CELL_COMB_CHARS_HI - CELL_COMB_CHARS_LO)))
             {
                 /* We reached our maximum number of allowed composed
@@ -4358,14 +4738,18 @@ term_process_and_print_non_ascii(struct terminal *term, char32_t wc)
                 goto out;
             }
 
-            /* Allocate new chain */
-            struct composed *new_cc = xmalloc(sizeof(*new_cc));
-            new_cc->chars = xmalloc(wanted_count * sizeof(new_cc->chars[0]));
-            new_cc->key = key;
-            new_cc->count = wanted_count;
+            /* Create new chain (copied into the table below) */
+            char32_t chars[255];
+            struct composed new_chain = {
+                .chars = chars,
+                .key = key,
+                .count = wanted_count,
+                .forced_width = composed != NULL ? composed->forced_width : 0,
+            };
+            struct composed *new_cc = &new_chain;
+
             new_cc->chars[0] = base;
             new_cc->chars[wanted_count - 1] = wc;
-            new_cc->forced_width = composed != NULL ? composed->forced_width : 0;
 
             if (composed != NULL) {
                 memcpy(&new_cc->chars[1], &composed->chars[1],
@@ -4389,25 +4773,15 @@ term_process_and_print_non_ascii(struct terminal *term, char32_t wc)
                              (wc == 0xfe0e || wc == 0xfe0f) &&
                              new_cc->count == 2))
                 {
-                    const struct emoji_vs *vs =
-                        bsearch(
-                            &(struct emoji_vs){.start = new_cc->chars[0]},
-                            emoji_vs, sizeof(emoji_vs) / sizeof(emoji_vs[0]),
-                            sizeof(struct emoji_vs),
-                            &emoji_vs_compare);
-
-                    if (vs != NULL) {
-                        xassert(new_cc->chars[0] >= vs->start &&
-                                new_cc->chars[0] <= vs->end);
-
-                        /* Force a grapheme width of 1 for VS-15, and 2 for VS-16 */
-                        if (wc == 0xfe0e) {
-                            if (vs->vs15)
-                                new_cc->width = 1;
-                        } else if (wc == 0xfe0f) {
-                            if (vs->vs16)
-                                new_cc->width = 2;
-                        }
+                    const uint8_t vs = emoji_vs_lookup(new_cc->chars[0]);
+
+                    /* Force a grapheme width of 1 for VS-15, and 2 for VS-16 */
+                    if (wc == 0xfe0e) {
+                        if (vs & EMOJI_VS15)
+                            new_cc->width = 1;
+                    } else if (wc == 0xfe0f) {
+                        if (vs & EMOJI_VS16)
+                            new_cc->width = 2;
                     }
                 }
 #endif
@@ -4419,11 +4793,11 @@ term_process_and_print_non_ascii(struct terminal *term, char32_t wc)
                 break;
             }
 
-            term->composed_count++;
-            composed_insert(&term->composed, new_cc);
+            const struct composed *inserted =
+                composed_insert(&term->composed, new_cc);
 
-            wc = CELL_COMB_CHARS_LO + new_cc->key;
-            width = new_cc->forced_width > 0 ? new_cc->forced_width : new_cc->width;
+            wc = CELL_COMB_CHARS_LO + inserted->key;
+            width = inserted->forced_width > 0 ? inserted->forced_width : inserted->width;
 
             xassert(wc >= CELL_COMB_CHARS_LO);
             xassert(wc <= CELL_COMB_CHARS_HI);
@@ -4436,6 +4810,420 @@ term_process_and_print_non_ascii(struct terminal *term, char32_t wc)
 out:
     if (width > 0)
         term_print(term, wc, width, insert_mode_disable);
+
+    if (unlikely(term->composed.count >= term->composed_gc_threshold))
+        term_composed_gc(term);
+}
+
+static void
+composed_mark_grid(struct terminal *term, const struct grid *grid)
+{
+    struct cell *unpacked = NULL;
+
+    for (int r = 0; r < grid->num_rows; r++) {
+        const struct row *row = grid->rows[r];
+        if (row == NULL)
+            continue;
+
+        const struct cell *cells = row->cells;
+
+        if (cells == NULL) {
+            /* Don't keep packed rows unpacked, just to mark them */
+            if (unpacked == NULL)
+                unpacked = xmalloc(grid->num_cols * sizeof(unpacked[0]));
+
+            grid_row_unpack_to(grid, row, unpacked);
+            cells = unpacked;
+        }
+
+        for (int c = 0; c < grid->num_cols; c++) {
+            const char32_t wc = cells[c].wc;
+            if (wc >= CELL_COMB_CHARS_LO && wc <= CELL_COMB_CHARS_HI)
+                composed_mark(&term->composed, wc - CELL_COMB_CHARS_LO);
+        }
+    }
+
+    free(unpacked);
+}
+
+/*
+ * Frees all composed characters that are no longer referenced by any
+ * cell, in any grid (including the scrollback).
+ *
+ * Called when the number of composed characters has doubled since
+ * the last collection. Since cells refer to composed characters by
+ * key, this must not be called while a 'struct composed' pointer is
+ * being held.
+ */
+void
+term_composed_gc(struct terminal *term)
+{
+    composed_mark_grid(term, &term->normal);
+    composed_mark_grid(term, &term->alt);
+
+    if (term->interactive_resizing.grid != NULL)
+        composed_mark_grid(term, term->interactive_resizing.grid);
+
+    /* Scrollback being reflowed in the background, or lazily */
+    if (term->reflow.history != NULL) {
+        render_reflow_wait(term);
+        composed_mark_grid(term, term->reflow.history);
+    }
+    tll_foreach(term->reflow.pending, it)
+        composed_mark_grid(term, it->item);
+    if (term->url_grid_snapshot != NULL)
+        composed_mark_grid(term, term->url_grid_snapshot);
+
+    /* Used by REP */
+    const char32_t last = term->vt.last_printed;
+    if (last >= CELL_COMB_CHARS_LO && last <= CELL_COMB_CHARS_HI)
+        composed_mark(&term->composed, last - CELL_COMB_CHARS_LO);
+
+    const uint32_t total = term->composed.count;
+    const size_t reclaimed = composed_sweep(&term->composed);
+
+    term->composed_gc_threshold =
+        max(COMPOSED_GC_MIN_THRESHOLD, term->composed.count * 2);
+
+    LOG_INFO("composed characters: reclaimed %zu of %u (next collection at %u)",
+             reclaimed, total, term->composed_gc_threshold);
+}
+
+UNITTEST
+{
+    struct cell normal_cells[4] = {0};
+    struct cell alt_cells[4] = {0};
+    struct row normal_row = {.cells = normal_cells};
+    struct row alt_row = {.cells = alt_cells};
+    struct row *normal_rows[] = {&normal_row};
+    struct row *alt_rows[] = {&alt_row};
+
+    struct terminal term = {
+        .normal = {.rows = normal_rows, .num_rows = 1, .num_cols = 4},
+        .alt = {.rows = alt_rows, .num_rows = 1, .num_cols = 4},
+    };
+
+    for (uint32_t key = 1; key <= 4; key++) {
+        composed_insert(
+            &term.composed, &(struct composed){
+                .chars = (char32_t[]){U'a', 0x301}, .key = key, .count = 2});
+    }
+
+    normal_cells[0].wc = CELL_COMB_CHARS_LO + 1;
+    alt_cells[2].wc = CELL_COMB_CHARS_LO + 2;
+    term.vt.last_printed = CELL_COMB_CHARS_LO + 3;
+
+    term_composed_gc(&term);
+
+    xassert(term.composed.count == 3);
+    xassert(composed_lookup(&term.composed, 1) != NULL);
+    xassert(composed_lookup(&term.composed, 2) != NULL);
+    xassert(composed_lookup(&term.composed, 3) != NULL);
+    xassert(composed_lookup(&term.composed, 4) == NULL);
+    xassert(term.composed_gc_threshold == COMPOSED_GC_MIN_THRESHOLD);
+
+    /* Nothing references the composed characters anymore */
+    normal_cells[0].wc = alt_cells[2].wc = U'a';
+    term.vt.last_printed = U'a';
+
+    term_composed_gc(&term);
+    xassert(term.composed.count == 0);
+
+    composed_free(&term.composed);
+}
+
+#if defined(FOOT_COMPACT_CELLS)
+static void
+attrs_mark_cells(struct terminal *term, const struct cell *cells, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        attr_palette_mark(&term->attrs_palette, cells[i].attrs.idx);
+}
+
+static void
+attrs_mark_grid(struct terminal *term, const struct grid *grid)
+{
+    struct cell *unpacked = NULL;
+
+    for (int r = 0; r < grid->num_rows; r++) {
+        const struct row *row = grid->rows[r];
+        if (row == NULL)
+            continue;
+
+        const struct cell *cells = row->cells;
+
+        if (cells == NULL) {
+            if (unpacked == NULL)
+                unpacked = xmalloc(grid->num_cols * sizeof(unpacked[0]));
+
+            grid_row_unpack_to(grid, row, unpacked);
+            cells = unpacked;
+        }
+
+        attrs_mark_cells(term, cells, grid->num_cols);
+    }
+
+    free(unpacked);
+}
+
+/*
+ * Frees all palette entries that are no longer referenced by any
+ * cell. Called when the palette is full, i.e. when the number of
+ * entries has doubled since the last collection.
+ *
+ * Entries are never moved, so indices held by cells remain valid. The
+ * cached entry is kept, since the caller may still be holding it.
+ */
+void
+term_attrs_gc(struct terminal *term)
+{
+    attrs_mark_grid(term, &term->normal);
+    attrs_mark_grid(term, &term->alt);
+
+    if (term->interactive_resizing.grid != NULL)
+        attrs_mark_grid(term, term->interactive_resizing.grid);
+
+    /* Scrollback being reflowed in the background, or lazily */
+    if (term->reflow.history != NULL) {
+        render_reflow_wait(term);
+        attrs_mark_grid(term, term->reflow.history);
+    }
+    tll_foreach(term->reflow.pending, it)
+        attrs_mark_grid(term, it->item);
+    if (term->url_grid_snapshot != NULL)
+        attrs_mark_grid(term, term->url_grid_snapshot);
+
+#if defined(FOOT_IME_ENABLED) && FOOT_IME_ENABLED
+    tll_foreach(term->wl->seats, it) {
+        const struct seat *seat = &it->item;
+        if (seat->ime_focus == term && seat->ime.preedit.cells != NULL) {
+            attrs_mark_cells(
+                term, seat->ime.preedit.cells, seat->ime.preedit.count);
+        }
+    }
+#endif
+
+    if (term->attrs_cache.value != 0)
+        attr_palette_mark(&term->attrs_palette, term->attrs_cache.idx);
+
+    const uint32_t total = term->attrs_palette.count;
+    const size_t reclaimed = attr_palette_sweep(&term->attrs_palette);
+
+    LOG_INFO("attribute palette: reclaimed %zu of %u entries "
+             "(next collection at %u)",
+             reclaimed, total, term->attrs_palette.gc_threshold);
+}
+
+uint32_t
+term_attrs_palette_insert(struct terminal *term, uint64_t value)
+{
+    uint32_t idx;
+
+    if (unlikely(!attr_palette_insert(&term->attrs_palette, value, &idx))) {
+        term_attrs_gc(term);
+
+        /*
+         * The palette grows after a collection, unless every one of
+         * its 2^28 indices is in use (i.e. there are at least that
+         * many cells). Treat it like any other allocation failure.
+         */
+        if (!attr_palette_insert(&term->attrs_palette, value, &idx))
+            FATAL_ERROR(__func__, ENOMEM);
+    }
+
+    term->attrs_cache.value = value;
+    term->attrs_cache.idx = idx;
+    return idx;
+}
+
+UNITTEST
+{
+    struct cell normal_cells[4] = {0};
+    struct cell alt_cells[4] = {0};
+    struct row normal_row = {.cells = normal_cells};
+    struct row alt_row = {.cells = alt_cells};
+    struct row *normal_rows[] = {&normal_row};
+    struct row *alt_rows[] = {&alt_row};
+    struct wayland wayl = {.seats = tll_init()};
+
+    struct terminal term = {
+        .wl = &wayl,
+        .normal = {.rows = normal_rows, .num_rows = 1, .num_cols = 4},
+        .alt = {.rows = alt_rows, .num_rows = 1, .num_cols = 4},
+    };
+
+    const struct attributes bold = {.bold = true};
+    const struct attributes red = {.fg = 0xff0000, .fg_src = COLOR_RGB};
+
+    normal_cells[0].attrs = term_attrs_to_cell(&term, &bold);
+    alt_cells[1].attrs = term_attrs_to_cell(
+        &term, &(struct attributes){.bold = true, .selected = true});
+    xassert(normal_cells[0].attrs.idx == alt_cells[1].attrs.idx);
+    xassert(alt_cells[1].attrs.selected);
+
+    alt_cells[2].attrs = term_attrs_to_cell(&term, &red);
+    xassert(term_cell_attrs(&term, &alt_cells[2]).fg == 0xff0000);
+    xassert(term_cell_attrs(&term, &normal_cells[0]).bold);
+    xassert(!term_cell_attrs(&term, &normal_cells[0]).selected);
+    xassert(term_cell_attrs(&term, &alt_cells[1]).selected);
+
+    /* Default attributes are never stored in the palette */
+    normal_cells[1].attrs = term_attrs_to_cell(&term, &(struct attributes){0});
+    xassert(normal_cells[1].attrs.idx == 0);
+    xassert(term.attrs_palette.count == 2);
+
+    /* Unreferenced entries are reclaimed, but not the cached one */
+    const uint32_t bold_idx = normal_cells[0].attrs.idx;
+    normal_cells[0].attrs = alt_cells[1].attrs = (cell_attrs_t){0};
+    term_attrs_gc(&term);
+    xassert(term.attrs_palette.count == 1);
+    xassert(term_cell_attrs(&term, &alt_cells[2]).fg == 0xff0000);
+
+    term.attrs_cache.value = 0;
+    alt_cells[2].attrs = (cell_attrs_t){0};
+    term_attrs_gc(&term);
+    xassert(term.attrs_palette.count == 0);
+    xassert(attr_palette_get(&term.attrs_palette, bold_idx) == 0);
+
+    attr_palette_free(&term.attrs_palette);
+}
+
+UNITTEST
+{
+    /*
+     * Fill the palette with attributes that are all in use, and
+     * verify the palette grows, instead of aliasing them.
+     */
+    const int cols = ATTR_PALETTE_GC_MIN_THRESHOLD + 16;
+    struct cell *cells = xcalloc(cols, sizeof(cells[0]));
+    struct row row = {.cells = cells};
+    struct row *rows[] = {&row};
+    struct cell alt_cells[1] = {0};
+    struct row alt_row = {.cells = alt_cells};
+    struct row *alt_rows[] = {&alt_row};
+    struct wayland wayl = {.seats = tll_init()};
+
+    struct terminal term = {
+        .wl = &wayl,
+        .normal = {.rows = rows, .num_rows = 1, .num_cols = cols},
+        .alt = {.rows = alt_rows, .num_rows = 1, .num_cols = 1},
+    };
+
+    for (int c = 0; c < cols; c++) {
+        cells[c].attrs = term_attrs_to_cell(
+            &term, &(struct attributes){.fg = c + 1, .fg_src = COLOR_RGB});
+    }
+
+    xassert(term.attrs_palette.count == cols);
+    xassert(term.attrs_palette.gc_threshold > ATTR_PALETTE_GC_MIN_THRESHOLD);
+
+    for (int c = 0; c < cols; c++) {
+        xassert(cells[c].attrs.idx != 0);
+        xassert(term_cell_attrs(&term, &cells[c]).fg == c + 1);
+    }
+
+    attr_palette_free(&term.attrs_palette);
+    free(cells);
+}
+#endif
+
+/*
+ * Returns true if term_process_and_print_non_ascii() would print 'wc'
+ * as-is, i.e. without trying to combine it with the previous
+ * character. If so, the grapheme state has been updated, and 'wc' can
+ * be printed with term_print_run().
+ *
+ * 'prev' is the last character of the pending (not yet printed) run,
+ * or 0 if there is none. When there *is* a pending run, the cursor is
+ * assumed to be past the first column. This is conservative; the
+ * only effect of being wrong is that we fall back to
+ * term_process_and_print_non_ascii(), which then sees the actual
+ * state.
+ */
+static bool
+non_ascii_is_plain(struct terminal *term, char32_t wc, int width, char32_t prev)
+{
+    if (width <= 0)
+        return false;
+
+    if (prev == 0 && term->grid->cursor.point.col == 0) {
+        term_reset_grapheme_state(term);
+        return true;
+    }
+
+#if defined(FOOT_GRAPHEME_CLUSTERING)
+    if (term->grapheme_shaping && (prev != 0 || term->vt.codepoint_merging_ok)) {
+        char32_t last = prev;
+
+        if (last == 0) {
+            /* Same lookup as term_process_and_print_non_ascii() */
+            const struct row *row = term->grid->cur_row;
+            int col = term->grid->cursor.point.col;
+            if (!term->grid->cursor.lcf)
+                col--;
+
+            while (row->cells[col].wc >= CELL_SPACER && col > 0)
+                col--;
+
+            last = row->cells[col].wc;
+            if (last >= CELL_COMB_CHARS_LO && last <= CELL_COMB_CHARS_HI)
+                return false;
+        }
+
+        utf8proc_int32_t state = term->vt.grapheme_state;
+        if (!utf8proc_grapheme_break_stateful(last, wc, &state))
+            return false;
+    }
+#endif
+
+    /* Not a combining character (width > 0) */
+    term_reset_grapheme_state(term);
+    return true;
+}
+
+/*
+ * Processes, and prints, a run of already decoded (non-ASCII)
+ * codepoints. Equivalent to calling
+ * term_process_and_print_non_ascii() for each codepoint.
+ *
+ * Characters that are printed as-is (most of them) are collected,
+ * and printed in batches with term_print_run().
+ */
+void
+term_process_and_print_non_ascii_run(
+    struct terminal *term, const char32_t *wcs, size_t count)
+{
+    char32_t run[128];
+    uint8_t widths[128];
+    size_t run_count = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const char32_t wc = wcs[i];
+        const int width = c32width(wc);
+
+        if (likely(non_ascii_is_plain(
+                term, wc, width, run_count > 0 ? run[run_count - 1] : 0)))
+        {
+            run[run_count] = wc;
+            widths[run_count] = width;
+
+            if (++run_count == ALEN(run)) {
+                term_print_run(term, run, widths, run_count);
+                run_count = 0;
+            }
+            continue;
+        }
+
+        if (run_count > 0) {
+            term_print_run(term, run, widths, run_count);
+            run_count = 0;
+        }
+
+        term_process_and_print_non_ascii(term, wc);
+    }
+
+    if (run_count > 0)
+        term_print_run(term, run, widths, run_count);
 }
 
 enum term_surface
@@ -4475,7 +5263,7 @@ rows_to_text(const struct terminal *term, int start, int end,
     int r = start;
 
     while (true) {
-        const struct row *row = term->grid->rows[r];
+        const struct row *row = grid_row_unpacked(term->grid, r);
         xassert(row != NULL);
 
         const int c_end = r == end ? col_end : term->cols;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -14,6 +15,7 @@
 #include <tllist.h>
 #include <fcft/fcft.h>
 
+#include "attr-palette.h"
 #include "composed.h"
 #include "config.h"
 #include "debug.h"
@@ -65,11 +67,38 @@ static_assert(sizeof(struct attributes) == 8, "VT attribute struct too large");
 #define CELL_COMB_CHARS_HI          (CELL_COMB_CHARS_LO + 0x3fffffff)
 #define CELL_SPACER                 (CELL_COMB_CHARS_HI + 1)
 
+#if defined(FOOT_COMPACT_CELLS)
+/*
+ * Compact cell attributes: colors and styles are stored in the
+ * terminal's attribute palette, and the cell only holds an index into
+ * it. The bits updated in-place by the renderer, selection and URL
+ * mode are kept inline.
+ *
+ * Use term_cell_attrs() and term_attrs_to_cell() to convert to and
+ * from 'struct attributes'.
+ */
+struct compact_attrs {
+    uint32_t idx:ATTR_PALETTE_IDX_BITS;
+    bool clean:1;
+    bool confined:1;
+    bool selected:1;
+    bool url:1;  /* No padding; cells are compared with memcmp() */
+};
+static_assert(sizeof(struct compact_attrs) == 4, "bad size");
+typedef struct compact_attrs cell_attrs_t;
+#else
+typedef struct attributes cell_attrs_t;
+#endif
+
 struct cell {
     char32_t wc;
-    struct attributes attrs;
+    cell_attrs_t attrs;
 };
+#if defined(FOOT_COMPACT_CELLS)
+static_assert(sizeof(struct cell) == 8, "bad size");
+#else
 static_assert(sizeof(struct cell) == 12, "bad size");
+#endif
 
 struct scroll_region {
     int start;
@@ -145,13 +174,26 @@ struct row_data {
     struct row_ranges underline_ranges;
 };
 
+struct row_slab;
+
 struct row {
-    struct cell *cells;
+    struct cell *cells;     /* NULL if the row is packed */
     struct row_data *extra;
 
+    /* Allocator of the row, and its cells (NULL: malloc) */
+    struct row_slab *slab;
+
+    /* Compressed cells, for rows far back in the scrollback (see grid.c) */
+    uint8_t *packed;
+    size_t packed_size;
+
     bool dirty;
     bool linebreak;
 
+    /* Dirty columns (inclusive), valid when 'dirty' is set */
+    uint16_t dirty_start;
+    uint16_t dirty_end;
+
     struct {
         bool prompt_marker;
         int cmd_start;  /* Column, -1 if unset */
@@ -237,6 +279,13 @@ struct grid {
     struct row **rows;
     struct row *cur_row;
 
+    /* Allocator for rows (see grid.c), may be NULL */
+    struct row_slab *slab;
+
+    /* Total size of all packed rows, and their size when unpacked */
+    size_t packed_bytes;
+    size_t unpacked_bytes;
+
     tll(struct damage) scroll_damage;
     tll(struct sixel) sixel_images;
 
@@ -373,6 +422,153 @@ enum overlay_style {
 
 typedef tll(struct ptmx_buffer) ptmx_buffer_list_t;
 
+/*
+ * Glyph lookup cache, in front of fcft_rasterize_char_utf32(). There's
+ * one per rendering thread, and thus no locking. ASCII glyphs are
+ * stored in a flat array, indexed by font (see attrs_to_font()) and
+ * codepoint, and are all rasterized with the same subpixel mode. All
+ * other glyphs go into a direct-mapped table, keyed by (codepoint,
+ * font, subpixel mode).
+ *
+ * Cached glyph pointers are owned by fcft; the cache must be reset
+ * whenever the fonts are changed.
+ */
+#define GLYPH_LOOKUP_CACHE_SIZE 1024  /* Must be a power of 2 */
+
+struct glyph_lookup_cache {
+    enum fcft_subpixel ascii_subpixel;
+    const struct fcft_glyph *ascii[4][128];
+
+    struct glyph_lookup_entry {
+        char32_t wc;
+        uint8_t font_idx;
+        uint8_t subpixel;
+        const struct fcft_glyph *glyph;  /* NULL: unused entry */
+    } entries[GLYPH_LOOKUP_CACHE_SIZE];
+
+    /* Statistics, reset by the render timer */
+    uint32_t hits;
+    uint32_t misses;
+};
+
+/*
+ * Pre-converted pixman colors for the 256-color palette, and the
+ * default foreground and background colors, in their normal, dimmed
+ * and brightened variants. Owned by render.c, which validates it
+ * against the current palette at the start of each frame.
+ */
+enum palette_variant {
+    PALETTE_NORMAL,
+    PALETTE_DIM,
+    PALETTE_BRIGHT,
+    PALETTE_VARIANT_COUNT,
+};
+
+#define PALETTE_CACHE_FG 256  /* Index of the default foreground color */
+#define PALETTE_CACHE_BG 257  /* Index of the default background color */
+#define PALETTE_CACHE_SIZE 258
+
+struct palette_cache {
+    /* What the cache was computed from */
+    bool valid;
+    bool srgb;
+    uint16_t alpha;
+    uint32_t fg;
+    uint32_t bg;
+    uint32_t table[256];
+    const struct color_theme *theme;
+
+    uint32_t hex[PALETTE_VARIANT_COUNT][PALETTE_CACHE_SIZE];
+    pixman_color_t pixman[PALETTE_VARIANT_COUNT][PALETTE_CACHE_SIZE];
+
+    /* PALETTE_NORMAL colors, with the terminal's background alpha */
+    pixman_color_t pixman_alpha[PALETTE_CACHE_SIZE];
+};
+
+/* Recently converted RGB colors, most recently used first */
+#define COLOR_LRU_SIZE 8
+
+struct color_lru {
+    size_t count;
+    struct color_lru_entry {
+        uint32_t color;
+        uint16_t alpha;
+        bool srgb;
+        pixman_color_t pixman;
+    } entries[COLOR_LRU_SIZE];
+};
+
+/*
+ * Measured cost of the two scroll strategies (SHM scrolling, and
+ * memmove), for one buffer geometry. See grid_render_scroll().
+ */
+#define SCROLL_CALIBRATION_SAMPLES 8
+
+struct scroll_calibration {
+    int width;
+    int height;
+    int stride;  /* 0: unused entry */
+
+    struct {
+        uint32_t samples;
+        uint64_t ns;
+        uint64_t rows;  /* Pixel rows touched */
+    } shm, memmove;
+};
+
+/*
+ * A scroll applied to the last rendered buffer. Replayed on an older
+ * buffer, when bringing it up to date with the last frame (see
+ * reapply_old_damage()), instead of copying the moved pixels from the
+ * last buffer.
+ */
+#define BUFFER_SCROLL_MAX 16
+
+struct buffer_scroll {
+    struct damage dmg;  /* DAMAGE_SCROLL or DAMAGE_SCROLL_REVERSE */
+
+    /* Geometry the scroll was rendered with */
+    int rows;
+    int cell_height;
+    int margin_top;
+    int margin_bottom;
+
+    /* Pixel rows moved, i.e. the memmove() equivalent of the scroll */
+    int src_y;
+    int dst_y;
+    int height;
+};
+
+/*
+ * Direct-mapped cache of pixman solid-fill images, keyed by color
+ * (including alpha). One per rendering thread, since pixman's image
+ * reference counting isn't thread safe.
+ */
+#define SOLID_FILL_CACHE_SIZE 32  /* Must be a power of 2 */
+
+struct solid_fill_cache {
+    struct solid_fill_entry {
+        pixman_color_t color;
+        pixman_image_t *pix;  /* NULL: unused entry */
+    } entries[SOLID_FILL_CACHE_SIZE];
+};
+
+/*
+ * Work item for the render worker pool. Embedded in the terminal, and
+ * thus never allocated.
+ */
+struct render_job {
+    struct terminal *term;
+    enum {
+        RENDER_JOB_ROWS,              /* Render the dirty rows */
+        RENDER_JOB_PREAPPLY_DAMAGE,   /* Copy last frame's damage */
+    } kind;
+    uint16_t takers_left;  /* Workers that have yet to pick up the job */
+    struct render_job *next;
+};
+
+struct render_pool;
+
 enum url_action { URL_ACTION_COPY, URL_ACTION_LAUNCH, URL_ACTION_PERSISTENT };
 struct url {
     uint64_t id;
@@ -450,8 +646,16 @@ struct terminal {
 
     tll(int) tab_stops;
 
-    size_t composed_count;
-    struct composed *composed;
+    struct composed_table composed;
+    uint32_t composed_gc_threshold;  /* Run term_composed_gc() when count reaches this */
+
+#if defined(FOOT_COMPACT_CELLS)
+    struct attr_palette attrs_palette;
+    struct {
+        uint64_t value;  /* Last value looked up in the palette */
+        uint32_t idx;
+    } attrs_cache;
+#endif
 
     /* Temporary: for FDM */
     struct {
@@ -692,13 +896,43 @@ struct terminal {
         /* Render threads + synchronization primitives */
         struct {
             uint16_t count;
-            sem_t start;
+            struct render_pool *pool;
+            bool own_pool;  /* false when shared with other terminals */
             sem_t done;
             mtx_t lock;
-            tll(int) queue;
-            thrd_t *threads;
             struct buffer *buf;
 
+            struct render_job rows_job;
+            struct render_job preapply_job;
+
+            /*
+             * pixman glyph caches used by render_row(); one per
+             * rendering thread (index 0 is the main thread). Each
+             * cache is instantiated lazily, by its own thread.
+             */
+            pixman_glyph_cache_t **glyph_caches;
+
+            /* Glyph lookup caches, one per rendering thread (index 0
+             * is the main thread) */
+            struct glyph_lookup_cache *glyph_lookup;
+
+            /* RGB color conversion caches, one per rendering thread */
+            struct color_lru *color_lru;
+
+            /* Solid-fill image caches, one per rendering thread */
+            struct solid_fill_cache *solid_fills;
+
+            /*
+             * Dirty rows (view-relative) to render this frame. Sized
+             * to term->rows in render_resize(), and thus never
+             * allocated per frame. Workers claim batches of
+             * consecutive entries by bumping 'next_row'.
+             */
+            int *rows;
+            int row_count;
+            int batch_size;
+            atomic_int next_row;
+
             struct {
                 mtx_t lock;
                 cnd_t cond;
@@ -715,7 +949,33 @@ struct terminal {
             bool hidden;
         } last_cursor;
 
+        struct palette_cache palette;
+
+        /* Scroll strategy selection, see grid_render_scroll() */
+        struct {
+            struct scroll_calibration calibrations[4];
+            size_t next_calibration;
+
+            /* Statistics, reset by the render timer */
+            uint32_t shm_count;
+            uint32_t memmove_count;
+            uint64_t ns;
+        } scroll;
+
         struct buffer *last_buf;     /* Buffer we rendered to last time */
+        uint64_t frame_count;        /* Number of grid frames rendered */
+
+        /*
+         * Scrolls applied to last_buf, in order. If there were too
+         * many, the moved areas have been added to last_buf's damage
+         * instead ('overflowed'), and there's nothing to replay.
+         */
+        struct {
+            struct buffer_scroll items[BUFFER_SCROLL_MAX];
+            size_t count;
+            bool overflowed;
+        } last_scrolls;
+
         size_t frames_since_last_immediate_release;
         bool preapply_last_frame_damage;
 
@@ -737,6 +997,18 @@ struct terminal {
         struct range selection_coords;
     } interactive_resizing;
 
+    /* Scrollback whose reflow has been deferred (see render.c) */
+    struct {
+        tll(struct grid *) pending; /* Not yet reflowed, newest first */
+        struct grid *history; /* Reflowed history, not yet spliced in */
+        struct composed_table composed; /* Snapshot, used by the worker */
+        thrd_t thread;
+        bool running;         /* Worker not yet joined */
+        int done_fd;          /* Signalled by the worker when done */
+        int new_rows;
+        int new_cols;
+    } reflow;
+
     struct {
         enum {
             SIXEL_DECSIXEL,  /* DECSIXEL body part ", $, -, ? ... ~ */
@@ -838,8 +1110,9 @@ struct terminal {
 struct config;
 struct terminal *term_init(
     const struct config *conf, struct fdm *fdm, struct reaper *reaper,
-    struct wayland *wayl, const char *foot_exe, const char *cwd,
-    const char *token, const char *pty_path,
+    struct wayland *wayl, struct render_pool *render_pool,
+    const char *foot_exe, const char *cwd, const char *token,
+    const char *pty_path,
     int argc, char *const *argv, const char *const *envp,
     void (*shutdown_cb)(void *data, int exit_code), void *shutdown_data);
 
@@ -903,8 +1176,18 @@ void term_cursor_down(struct terminal *term, int count);
 void term_cursor_blink_update(struct terminal *term);
 
 void term_process_and_print_non_ascii(struct terminal *term, char32_t wc);
+void term_process_and_print_non_ascii_run(
+    struct terminal *term, const char32_t *wcs, size_t count);
 void term_print(struct terminal *term, char32_t wc, int width,
                 bool insert_mode_disable);
+void term_print_ascii_run(struct terminal *term, const uint8_t *text, size_t len);
+void term_print_run(struct terminal *term, const char32_t *wcs,
+                    const uint8_t *widths, size_t count);
+void term_composed_gc(struct terminal *term);
+#if defined(FOOT_COMPACT_CELLS)
+uint32_t term_attrs_palette_insert(struct terminal *term, uint64_t value);
+void term_attrs_gc(struct terminal *term);
+#endif
 void term_fill(struct terminal *term, int row, int col, uint8_t c, size_t count,
                bool use_sgr_attrs);
 
@@ -998,3 +1281,59 @@ static inline void term_reset_grapheme_state(struct terminal *term)
     term->vt.codepoint_merging_ok = false;
 #endif
 }
+
+#if defined(FOOT_COMPACT_CELLS)
+union attrs_value {
+    struct attributes attrs;
+    uint64_t value;
+};
+
+static inline struct attributes
+term_cell_attrs(const struct terminal *term, const struct cell *cell)
+{
+    union attrs_value v = {
+        .value = attr_palette_get(&term->attrs_palette, cell->attrs.idx)};
+
+    v.attrs.clean = cell->attrs.clean;
+    v.attrs.confined = cell->attrs.confined;
+    v.attrs.selected = cell->attrs.selected;
+    v.attrs.url = cell->attrs.url;
+    return v.attrs;
+}
+
+static inline cell_attrs_t
+term_attrs_to_cell(struct terminal *term, const struct attributes *attrs)
+{
+    cell_attrs_t ret = {
+        .clean = attrs->clean,
+        .confined = attrs->confined,
+        .selected = attrs->selected,
+        .url = attrs->url,
+    };
+
+    union attrs_value v = {.attrs = *attrs};
+    v.attrs.clean = v.attrs.confined = v.attrs.selected = v.attrs.url = false;
+
+    /* Most cells are printed with the same attributes as the previous one */
+    if (v.value == 0)
+        ret.idx = 0;
+    else if (likely(v.value == term->attrs_cache.value))
+        ret.idx = term->attrs_cache.idx;
+    else
+        ret.idx = term_attrs_palette_insert(term, v.value);
+
+    return ret;
+}
+#else
+static inline struct attributes
+term_cell_attrs(const struct terminal *term, const struct cell *cell)
+{
+    return cell->attrs;
+}
+
+static inline cell_attrs_t
+term_attrs_to_cell(struct terminal *term, const struct attributes *attrs)
+{
+    return *attrs;
+}
+#endif
@@ -0,0 +1,123 @@
+/*
+ * Scrollback reflow benchmark: fills a scrollback history with lines
+ * of text (of varying length, some of them wrapped), and reflows it
+ * to a new width with grid_reflow_history(); first in a single
+ * thread, and then in parallel.
+ *
+ * grid.c is built with TIME_REFLOW=1, and thus also logs the time
+ * spent in each individual reflow.
+ *
+ * Usage: bench-reflow [line-count...]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <uchar.h>
+#include <unistd.h>
+
+#define LOG_MODULE "bench-reflow"
+#define LOG_ENABLE_DBG 0
+#include "../log.h"
+#include "../grid.h"
+#include "../util.h"
+#include "../xmalloc.h"
+
+static const int old_cols = 80;
+static const int new_cols = 120;
+static const int screen_rows = 50;
+
+static struct grid
+history_fill(int line_count)
+{
+    /* Room for all lines, even if every one of them is wrapped */
+    int num_rows = 1;
+    while (num_rows < 2 * line_count)
+        num_rows <<= 1;
+
+    struct grid history = {
+        .num_rows = num_rows,
+        .num_cols = old_cols,
+        .rows = xcalloc(num_rows, sizeof(history.rows[0])),
+        .slab = grid_row_slab_new(old_cols),
+    };
+
+    unsigned int seed = 1;
+    int row_idx = 0;
+
+    for (int l = 0; l < line_count; l++) {
+        /* Mostly short lines, with the occasional long one */
+        const int len = rand_r(&seed) % (l % 8 == 0 ? 2 * old_cols : old_cols);
+        const int row_count = max(1, (len + old_cols - 1) / old_cols);
+
+        for (int r = 0; r < row_count; r++) {
+            struct row *row = grid_row_alloc(history.slab, old_cols, true);
+
+            for (int c = 0; c < old_cols && r * old_cols + c < len; c++)
+                row->cells[c].wc = U'a' + (r * old_cols + c) % 26;
+
+            row->linebreak = r + 1 == row_count;
+            history.rows[row_idx++] = row;
+        }
+    }
+
+    /* Like a real scrollback, where all but the newest rows are packed */
+    const int unpacked_rows = GRID_PACK_DISTANCE_SCREENS * screen_rows;
+    for (int r = 0; r < row_idx - unpacked_rows; r++)
+        grid_row_pack(&history, history.rows[r]);
+
+    history.offset = row_idx - 1;
+    history.view = history.offset;
+    return history;
+}
+
+static double
+reflow(int line_count, size_t thread_count)
+{
+    struct grid history = history_fill(line_count);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    grid_reflow_history(
+        &history, NULL, history.num_rows, new_cols, thread_count);
+
+    struct timespec stop;
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    grid_free(&history);
+
+    return (double)(stop.tv_sec - start.tv_sec) +
+           (double)(stop.tv_nsec - start.tv_nsec) / 1000000000.;
+}
+
+int
+main(int argc, const char *const *argv)
+{
+    log_init(LOG_COLORIZE_AUTO, false, LOG_FACILITY_USER, LOG_CLASS_INFO);
+
+    const size_t thread_count = max(sysconf(_SC_NPROCESSORS_ONLN), 1);
+
+    static const int default_line_counts[] = {10000, 100000, 1000000};
+    const int count = argc > 1 ? argc - 1 : (int)ALEN(default_line_counts);
+
+    for (int i = 0; i < count; i++) {
+        const int line_count = argc > 1
+            ? atoi(argv[i + 1])
+            : default_line_counts[i];
+
+        if (line_count <= 0) {
+            fprintf(stderr, "error: %s: invalid line count\n", argv[i + 1]);
+            return EXIT_FAILURE;
+        }
+
+        const double serial = reflow(line_count, 1);
+        const double parallel = reflow(line_count, thread_count);
+
+        printf("%8d lines: %.3fs (1 thread), %.3fs (%zu threads), %.1fx\n",
+               line_count, serial, parallel, thread_count, serial / parallel);
+    }
+
+    log_deinit();
+    return EXIT_SUCCESS;
+}
@@ -612,6 +612,13 @@ test_section_scrollback(void)
             SCROLLBACK_INDICATOR_POSITION_RELATIVE},
         (int *)&conf.scrollback.indicator.position);
 
+    test_enum(
+        &ctx, &parse_section_scrollback, "reflow",
+        2,
+        (const char *[]){"background", "lazy"},
+        (int []){SCROLLBACK_REFLOW_BACKGROUND, SCROLLBACK_REFLOW_LAZY},
+        (int *)&conf.scrollback.reflow);
+
     /* TODO: indicator-format (enum, sort-of) */
 
     config_free(&conf);
@@ -1478,6 +1485,29 @@ test_section_tweak(void)
                  RENDER_TIMER_BOTH},
         (int *)&conf.tweak.render_timer);
 
+    test_enum(
+        &ctx, &parse_section_tweak, "scroll-strategy",
+        4,
+        (const char *[]){"auto", "calibrate", "shm", "memmove"},
+        (int []){SCROLL_STRATEGY_AUTO,
+                 SCROLL_STRATEGY_CALIBRATE,
+                 SCROLL_STRATEGY_SHM,
+                 SCROLL_STRATEGY_MEMMOVE},
+        (int *)&conf.tweak.scroll_strategy);
+
+    test_enum(
+        &ctx, &parse_section_tweak, "shm-hugepages",
+        3,
+        (const char *[]){"none", "transparent", "hugetlb"},
+        (int []){SHM_HUGEPAGES_NONE,
+                 SHM_HUGEPAGES_TRANSPARENT,
+                 SHM_HUGEPAGES_HUGETLB},
+        (int *)&conf.tweak.shm_hugepages);
+    test_boolean(&ctx, &parse_section_tweak, "shm-prefault",
+                 &conf.tweak.shm_prefault);
+    test_uint32(&ctx, &parse_section_tweak, "shm-idle-timeout",
+                &conf.tweak.shm_idle_timeout);
+
     test_float(&ctx, &parse_section_tweak, "box-drawing-base-thickness",
                 &conf.tweak.box_drawing_base_thickness);
     test_boolean(&ctx, &parse_section_tweak, "box-drawing-solid-shades",
@@ -0,0 +1,342 @@
+/*
+ * Differential test of the VT parser: feeds the same input to the
+ * table driven parser (vt_from_slave()), and to the original, switch
+ * based, parser (vt_from_slave_reference()), and verifies the two
+ * terminals end up in the same state.
+ *
+ * Input is read from the files given on the command line (typically
+ * generated by scripts/generate-alt-random-writes.py), followed by a
+ * stream of random bytes.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <locale.h>
+#include <uchar.h>
+
+#define LOG_MODULE "test-vt"
+#define LOG_ENABLE_DBG 0
+#include "../log.h"
+#include "../config.h"
+#include "../grid.h"
+#include "../sixel.h"
+#include "../terminal.h"
+#include "../vt.h"
+#include "../xmalloc.h"
+
+#include "vt-reference.h"
+
+static const int row_count = 67;
+static const int col_count = 135;
+static const int grid_row_count = 256;
+
+static struct config conf = {
+    .title = (char *)"foot",
+    .app_id = (char *)"foot",
+    .tweak = {
+        .grapheme_width_method = GRAPHEME_WIDTH_DOUBLE,
+    },
+};
+
+static struct wayland wayl;
+
+static struct row **
+rows_init(void)
+{
+    struct row **rows = xcalloc(grid_row_count, sizeof(rows[0]));
+
+    for (int i = 0; i < grid_row_count; i++) {
+        rows[i] = xcalloc(1, sizeof(*rows[i]));
+        rows[i]->cells = xcalloc(col_count, sizeof(rows[i]->cells[0]));
+    }
+
+    return rows;
+}
+
+static void
+term_setup(struct terminal *term)
+{
+    struct row **normal_rows = rows_init();
+    struct row **alt_rows = rows_init();
+
+    *term = (struct terminal){
+        .conf = &conf,
+        .wl = &wayl,
+        .grid = &term->normal,
+        .normal = {
+            .num_rows = grid_row_count,
+            .num_cols = col_count,
+            .rows = normal_rows,
+            .cur_row = normal_rows[0],
+        },
+        .alt = {
+            .num_rows = grid_row_count,
+            .num_cols = col_count,
+            .rows = alt_rows,
+            .cur_row = alt_rows[0],
+        },
+        .scale = 1,
+        .width = col_count * 8,
+        .height = row_count * 15,
+        .cols = col_count,
+        .rows = row_count,
+        .cell_width = 8,
+        .cell_height = 15,
+        .auto_margin = true,
+        .scroll_region = {
+            .start = 0,
+            .end = row_count,
+        },
+        .selection = {
+            .coords = {
+                .start = {-1, -1},
+                .end = {-1, -1},
+            },
+        },
+        .delayed_render_timer = {
+            .lower_fd = -1,
+            .upper_fd = -1,
+        },
+        .sixel = {
+            .palette_size = SIXEL_MAX_COLORS,
+            .max_width = SIXEL_MAX_WIDTH,
+            .max_height = SIXEL_MAX_HEIGHT,
+        },
+    };
+
+    term_update_ascii_printer(term);
+    tll_push_back(wayl.terms, term);
+}
+
+static void
+term_teardown(struct terminal *term)
+{
+    tll_foreach(wayl.terms, it) {
+        if (it->item == term)
+            tll_remove(wayl.terms, it);
+    }
+
+    sixel_fini(term);
+    composed_free(&term->composed);
+#if defined(FOOT_COMPACT_CELLS)
+    attr_palette_free(&term->attrs_palette);
+#endif
+    free(term->vt.osc.data);
+    free(term->vt.osc8.uri);
+    free(term->app_id);
+    free(term->window_title);
+    tll_free_and_free(term->window_title_stack, free);
+    grid_free(&term->normal);
+    grid_free(&term->alt);
+}
+
+static bool
+row_equal(const struct row *a, const struct row *b)
+{
+    if (a == NULL || b == NULL)
+        return a == b;
+
+    if (a->linebreak != b->linebreak)
+        return false;
+
+    for (int c = 0; c < col_count; c++) {
+        const struct cell *ca = &a->cells[c];
+        const struct cell *cb = &b->cells[c];
+
+        /* 'clean' is a render flag, and not part of the VT state */
+        cell_attrs_t attrs_a = ca->attrs;
+        cell_attrs_t attrs_b = cb->attrs;
+        attrs_a.clean = attrs_b.clean = 0;
+
+        if (ca->wc != cb->wc || memcmp(&attrs_a, &attrs_b, sizeof(attrs_a)) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+static bool
+grid_equal(const struct grid *a, const struct grid *b, bool full)
+{
+    if (a->offset != b->offset ||
+        a->cursor.point.row != b->cursor.point.row ||
+        a->cursor.point.col != b->cursor.point.col ||
+        a->cursor.lcf != b->cursor.lcf)
+    {
+        return false;
+    }
+
+    const int first = full ? 0 : a->offset;
+    const int count = full ? grid_row_count : row_count;
+
+    for (int r = first; r < first + count; r++) {
+        const int idx = r & (grid_row_count - 1);
+        if (!row_equal(a->rows[idx], b->rows[idx]))
+            return false;
+    }
+
+    return true;
+}
+
+static bool
+term_equal(const struct terminal *a, const struct terminal *b, bool full)
+{
+    if (a->vt.state != b->vt.state)
+        return false;
+
+    /* In the middle of a UTF-8 sequence: compare what has been decoded */
+    const size_t utf8_bytes = vt_utf8_bytes_decoded(a->vt.state);
+    if (utf8_bytes != vt_utf8_bytes_decoded(b->vt.state) ||
+        (utf8_bytes > 0 && a->vt.utf8 != b->vt.utf8))
+    {
+        return false;
+    }
+
+    return (a->grid == &a->normal) == (b->grid == &b->normal) &&
+        a->composed.count == b->composed.count &&
+        grid_equal(&a->normal, &b->normal, full) &&
+        grid_equal(&a->alt, &b->alt, full);
+}
+
+/*
+ * Feeds 'data' to both terminals, in randomly sized chunks, and
+ * compares them after each chunk.
+ */
+static bool
+feed(struct terminal *table, struct terminal *reference,
+     const uint8_t *data, size_t len, const char *name)
+{
+    size_t chunks = 0;
+
+    for (size_t i = 0; i < len; chunks++) {
+        size_t count = 1 + rand() % 4096;
+        if (count > len - i)
+            count = len - i;
+
+        vt_from_slave(table, &data[i], count);
+        vt_from_slave_reference(reference, &data[i], count);
+        i += count;
+
+        /* Comparing the entire scrollback is slow; do it occasionally */
+        const bool full = i == len || chunks % 256 == 0;
+
+        if (!term_equal(table, reference, full)) {
+            LOG_ERR("%s: parsers diverged after %zu bytes", name, i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool
+feed_file(struct terminal *table, struct terminal *reference,
+          const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "%s: failed to open: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    uint8_t *data = NULL;
+    size_t len = 0;
+    size_t size = 0;
+
+    while (true) {
+        if (len == size) {
+            size = size == 0 ? 65536 : size * 2;
+            data = xrealloc(data, size);
+        }
+
+        size_t amount = fread(&data[len], 1, size - len, f);
+        if (amount == 0)
+            break;
+        len += amount;
+    }
+
+    fclose(f);
+
+    bool ret = feed(table, reference, data, len, path);
+    free(data);
+    return ret;
+}
+
+static bool
+feed_random(struct terminal *table, struct terminal *reference)
+{
+    const size_t len = 4 * 1024 * 1024;
+    uint8_t *data = xmalloc(len);
+
+    /*
+     * Mix printable ASCII, valid UTF-8 and random bytes; plain random
+     * bytes would almost never produce anything but very short
+     * escapes, or invalid UTF-8.
+     */
+    for (size_t i = 0; i < len; i++) {
+        switch (rand() % 3) {
+        case 0:
+            data[i] = 0x20 + rand() % 0x5f;
+            break;
+
+        case 1: {
+            const char32_t wc = 0x80 + rand() % (0x10ffff - 0x80);
+            char buf[4];
+            size_t count = c32rtomb(buf, wc, &(mbstate_t){0});
+
+            if (count > sizeof(buf) || count > len - i)
+                count = 0;
+
+            memcpy(&data[i], buf, count);
+            i += count;
+            if (i < len)
+                data[i] = rand() % 256;
+            break;
+        }
+
+        default:
+            data[i] = rand() % 256;
+            break;
+        }
+    }
+
+    bool ret = feed(table, reference, data, len, "random data");
+    free(data);
+    return ret;
+}
+
+int
+main(int argc, const char *const *argv)
+{
+    log_init(LOG_COLORIZE_AUTO, false, 0, LOG_CLASS_ERROR);
+    setlocale(LC_CTYPE, "C.UTF-8");
+    srand(1);
+
+    wayl = (struct wayland){
+        .seats = tll_init(),
+        .monitors = tll_init(),
+        .terms = tll_init(),
+    };
+
+    struct terminal table;
+    struct terminal reference;
+    term_setup(&table);
+    term_setup(&reference);
+
+    bool success = true;
+
+    for (int i = 1; i < argc && success; i++)
+        success = feed_file(&table, &reference, argv[i]);
+
+    if (success)
+        success = feed_random(&table, &reference);
+
+    term_teardown(&table);
+    term_teardown(&reference);
+    tll_free(wayl.terms);
+    log_deinit();
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,433 @@
+/*
+ * The original, switch based, VT parser. Only used by test-vt, to
+ * verify the table driven parser (vt_from_slave()).
+ *
+ * The parser actions are static functions in vt.c. It is included
+ * here, with the table driven parser renamed, so that both parsers
+ * run the exact same actions.
+ */
+
+#define vt_from_slave vt_from_slave_table_driven
+#include "../vt.c"
+#undef vt_from_slave
+
+#include "vt-reference.h"
+
+size_t
+vt_utf8_bytes_decoded(int state)
+{
+    switch ((enum state)state) {
+    case STATE_UTF8_21:
+    case STATE_UTF8_31:
+    case STATE_UTF8_41: return 1;
+    case STATE_UTF8_32:
+    case STATE_UTF8_42: return 2;
+    case STATE_UTF8_43: return 3;
+    default:            return 0;
+    }
+}
+
+static void
+action_ignore(struct terminal *term)
+{
+}
+
+static void
+action_print(struct terminal *term, uint8_t c)
+{
+    term_reset_grapheme_state(term);
+    term->ascii_printer(term, c);
+}
+
+IGNORE_WARNING("-Wpedantic")
+
+static enum state
+anywhere(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x18:                                           action_execute(term, data);                                       return STATE_GROUND;
+    case 0x1a:                                           action_execute(term, data);                                       return STATE_GROUND;
+    case 0x1b:                                                                            action_clear(term);              return STATE_ESCAPE;
+
+    /* 8-bit C1 control characters (not supported) */
+    case 0x80 ... 0x9f:                                                                                                    return STATE_GROUND;
+    }
+
+    return term->vt.state;
+}
+
+static enum state
+state_ground_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x00 ... 0x17:
+    case 0x19:
+    case 0x1c ... 0x1f:                                  action_execute(term, data);                                       return STATE_GROUND;
+
+    /* modified from 0x20..0x7f to 0x20..0x7e, since 0x7f is DEL, which is a zero-width character */
+    case 0x20 ... 0x7e:                                  action_print(term, data);                                         return STATE_GROUND;
+
+    case 0xc2 ... 0xdf:                                  action_utf8_21(term, data);                                       return STATE_UTF8_21;
+    case 0xe0 ... 0xef:                                  action_utf8_31(term, data);                                       return STATE_UTF8_31;
+    case 0xf0 ... 0xf4:                                  action_utf8_41(term, data);                                       return STATE_UTF8_41;
+    }
+
+    return anywhere(term, data);
+}
+
+static enum state
+state_escape_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x00 ... 0x17:
+    case 0x19:
+    case 0x1c ... 0x1f:                                  action_execute(term, data);                                       return STATE_ESCAPE;
+
+    case 0x20 ... 0x2f:                                  action_collect(term, data);                                       return STATE_ESCAPE_INTERMEDIATE;
+    case 0x30 ... 0x4f:                                  action_esc_dispatch(term, data);                                  return STATE_GROUND;
+    case 0x50:                                                                            action_clear(term);              return STATE_DCS_ENTRY;
+    case 0x51 ... 0x57:                                  action_esc_dispatch(term, data);                                  return STATE_GROUND;
+    case 0x58:                                                                                                             return STATE_SOS_PM_APC_STRING;
+    case 0x59:                                           action_esc_dispatch(term, data);                                  return STATE_GROUND;
+    case 0x5a:                                           action_esc_dispatch(term, data);                                  return STATE_GROUND;
+    case 0x5b:                                                                            action_clear(term);              return STATE_CSI_ENTRY;
+    case 0x5c:                                           action_esc_dispatch(term, data);                                  return STATE_GROUND;
+    case 0x5d:                                                                            action_osc_start(term, data);    return STATE_OSC_STRING;
+    case 0x5e ... 0x5f:                                                                                                    return STATE_SOS_PM_APC_STRING;
+    case 0x60 ... 0x7e:                                  action_esc_dispatch(term, data);                                  return STATE_GROUND;
+    case 0x7f:                                           action_ignore(term);                                              return STATE_ESCAPE;
+    }
+
+    return anywhere(term, data);
+}
+
+static enum state
+state_escape_intermediate_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x00 ... 0x17:
+    case 0x19:
+    case 0x1c ... 0x1f:                                  action_execute(term, data);                                       return STATE_ESCAPE_INTERMEDIATE;
+
+    case 0x20 ... 0x2f:                                  action_collect(term, data);                                       return STATE_ESCAPE_INTERMEDIATE;
+    case 0x30 ... 0x7e:                                  action_esc_dispatch(term, data);                                  return STATE_GROUND;
+    case 0x7f:                                           action_ignore(term);                                              return STATE_ESCAPE_INTERMEDIATE;
+    }
+
+    return anywhere(term, data);
+}
+
+static enum state
+state_csi_entry_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x00 ... 0x17:
+    case 0x19:
+    case 0x1c ... 0x1f:                                  action_execute(term, data);                                       return STATE_CSI_ENTRY;
+
+    case 0x20 ... 0x2f:                                  action_collect(term, data);                                       return STATE_CSI_INTERMEDIATE;
+    case 0x30 ... 0x39:                                  action_param(term, data);                                         return STATE_CSI_PARAM;
+    case 0x3a:                                           action_param_new_subparam(term, data);                            return STATE_CSI_PARAM;
+    case 0x3b:                                           action_param_new(term, data);                                     return STATE_CSI_PARAM;
+
+    case 0x3c ... 0x3f:                                  action_collect(term, data);                                       return STATE_CSI_PARAM;
+    case 0x40 ... 0x7e:                                  action_csi_dispatch(term, data);                                  return STATE_GROUND;
+    case 0x7f:                                           action_ignore(term);                                              return STATE_CSI_ENTRY;
+    }
+
+    return anywhere(term, data);
+}
+
+static enum state
+state_csi_param_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x00 ... 0x17:
+    case 0x19:
+    case 0x1c ... 0x1f:                                  action_execute(term, data);                                       return STATE_CSI_PARAM;
+
+    case 0x20 ... 0x2f:                                  action_collect(term, data);                                       return STATE_CSI_INTERMEDIATE;
+
+    case 0x30 ... 0x39:                                  action_param(term, data);                                         return STATE_CSI_PARAM;
+    case 0x3a:                                           action_param_new_subparam(term, data);                            return STATE_CSI_PARAM;
+    case 0x3b:                                           action_param_new(term, data);                                     return STATE_CSI_PARAM;
+
+    case 0x3c ... 0x3f:                                                                                                    return STATE_CSI_IGNORE;
+    case 0x40 ... 0x7e:                                  action_csi_dispatch(term, data);                                  return STATE_GROUND;
+    case 0x7f:                                           action_ignore(term);                                              return STATE_CSI_PARAM;
+    }
+
+    return anywhere(term, data);
+}
+
+static enum state
+state_csi_intermediate_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x00 ... 0x17:
+    case 0x19:
+    case 0x1c ... 0x1f:                                  action_execute(term, data);                                       return STATE_CSI_INTERMEDIATE;
+
+    case 0x20 ... 0x2f:                                  action_collect(term, data);                                       return STATE_CSI_INTERMEDIATE;
+    case 0x30 ... 0x3f:                                                                                                    return STATE_CSI_IGNORE;
+    case 0x40 ... 0x7e:                                  action_csi_dispatch(term, data);                                  return STATE_GROUND;
+    case 0x7f:                                           action_ignore(term);                                              return STATE_CSI_INTERMEDIATE;
+    }
+
+    return anywhere(term, data);
+}
+
+static enum state
+state_csi_ignore_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x00 ... 0x17:
+    case 0x19:
+    case 0x1c ... 0x1f:                                  action_execute(term, data);                                       return STATE_CSI_IGNORE;
+
+    case 0x20 ... 0x3f:                                  action_ignore(term);                                              return STATE_CSI_IGNORE;
+    case 0x40 ... 0x7e:                                                                                                    return STATE_GROUND;
+    case 0x7f:                                           action_ignore(term);                                              return STATE_CSI_IGNORE;
+    }
+
+    return anywhere(term, data);
+}
+
+static enum state
+state_osc_string_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+
+    /* Note: original was 20-7f, but I changed to 20-ff to include utf-8. Don't forget to add EXECUTE to 8-bit C1 if we implement that. */
+    default:                                             action_osc_put(term, data);                                       return STATE_OSC_STRING;
+
+    case 0x07:          action_osc_end(term, data);                                                                        return STATE_GROUND;
+
+    case 0x00 ... 0x06:
+    case 0x08 ... 0x17:
+    case 0x19:
+    case 0x1c ... 0x1f:                                  action_ignore(term);                                              return STATE_OSC_STRING;
+
+
+    case 0x18:
+    case 0x1a:          action_osc_end(term, data);      action_execute(term, data);                                       return STATE_GROUND;
+
+    case 0x1b:          action_osc_end(term, data);      action_clear(term);                                               return STATE_ESCAPE;
+    }
+}
+
+static enum state
+state_dcs_entry_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x00 ... 0x17:
+    case 0x19:
+    case 0x1c ... 0x1f:                                  action_ignore(term);                                              return STATE_DCS_ENTRY;
+
+    case 0x20 ... 0x2f:                                  action_collect(term, data);                                       return STATE_DCS_INTERMEDIATE;
+    case 0x30 ... 0x39:                                  action_param(term, data);                                         return STATE_DCS_PARAM;
+    case 0x3a:                                                                                                             return STATE_DCS_IGNORE;
+    case 0x3b:                                           action_param_new(term, data);                                     return STATE_DCS_PARAM;
+    case 0x3c ... 0x3f:                                  action_collect(term, data);                                       return STATE_DCS_PARAM;
+    case 0x40 ... 0x7e:                                                                   action_hook(term, data);         return STATE_DCS_PASSTHROUGH;
+    case 0x7f:                                           action_ignore(term);                                              return STATE_DCS_ENTRY;
+    }
+
+    return anywhere(term, data);
+}
+
+static enum state
+state_dcs_param_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x00 ... 0x17:
+    case 0x19:
+    case 0x1c ... 0x1f:                                  action_ignore(term);                                              return STATE_DCS_PARAM;
+
+    case 0x20 ... 0x2f:                                  action_collect(term, data);                                       return STATE_DCS_INTERMEDIATE;
+    case 0x30 ... 0x39:                                  action_param(term, data);                                         return STATE_DCS_PARAM;
+    case 0x3a:                                                                                                             return STATE_DCS_IGNORE;
+    case 0x3b:                                           action_param_new(term, data);                                     return STATE_DCS_PARAM;
+    case 0x3c ... 0x3f:                                                                                                    return STATE_DCS_IGNORE;
+    case 0x40 ... 0x7e:                                                                   action_hook(term, data);         return STATE_DCS_PASSTHROUGH;
+    case 0x7f:                                           action_ignore(term);                                              return STATE_DCS_PARAM;
+    }
+
+    return anywhere(term, data);
+}
+
+static enum state
+state_dcs_intermediate_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x00 ... 0x17:
+    case 0x19:
+    case 0x1c ... 0x1f:                                  action_ignore(term);                                              return STATE_DCS_INTERMEDIATE;
+
+    case 0x20 ... 0x2f:                                  action_collect(term, data);                                       return STATE_DCS_INTERMEDIATE;
+    case 0x30 ... 0x3f:                                                                                                    return STATE_DCS_IGNORE;
+    case 0x40 ... 0x7e:                                                                   action_hook(term, data);         return STATE_DCS_PASSTHROUGH;
+    case 0x7f:                                           action_ignore(term);                                              return STATE_DCS_INTERMEDIATE;
+    }
+
+    return anywhere(term, data);
+}
+
+static enum state
+state_dcs_ignore_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x00 ... 0x17:
+    case 0x19:
+    case 0x1c ... 0x1f:
+    case 0x20 ... 0x7f:                                  action_ignore(term);                                              return STATE_DCS_IGNORE;
+    }
+
+    return anywhere(term, data);
+}
+
+static enum state
+state_dcs_passthrough_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x00 ... 0x17:
+    case 0x19:
+    case 0x1c ... 0x7e:                                  action_put(term, data);                                           return STATE_DCS_PASSTHROUGH;
+
+    case 0x7f:                                           action_ignore(term);                                              return STATE_DCS_PASSTHROUGH;
+
+    /* Anywhere */
+    case 0x18:          action_unhook(term, data);       action_execute(term, data);                                       return STATE_GROUND;
+    case 0x1a:          action_unhook(term, data);       action_execute(term, data);                                       return STATE_GROUND;
+    case 0x1b:          action_unhook(term, data);                                        action_clear(term);              return STATE_ESCAPE;
+
+    /* 8-bit C1 control characters (not supported) */
+    case 0x80 ... 0x9f: action_unhook(term, data);                                                                         return STATE_GROUND;
+
+    default:                                                                                                               return STATE_DCS_PASSTHROUGH;
+    }
+}
+
+static enum state
+state_sos_pm_apc_string_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x00 ... 0x17:
+    case 0x19:
+    case 0x1c ... 0x7f:                                  action_ignore(term);                                              return STATE_SOS_PM_APC_STRING;
+    }
+
+    return anywhere(term, data);
+}
+
+static enum state
+state_utf8_21_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x80 ... 0xbf:                                  action_utf8_22(term, data);                                       return STATE_GROUND;
+    default:            action_utf8_print(term, 0xfffd); return state_ground_switch(term, data);
+    }
+}
+
+static enum state
+state_utf8_31_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x80 ... 0xbf:                                  action_utf8_32(term, data);                                       return STATE_UTF8_32;
+    default:            action_utf8_print(term, 0xfffd); return state_ground_switch(term, data);
+    }
+}
+
+static enum state
+state_utf8_32_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x80 ... 0xbf:                                  action_utf8_33(term, data);                                       return STATE_GROUND;
+    default:            action_utf8_print(term, 0xfffd); return state_ground_switch(term, data);
+    }
+}
+
+static enum state
+state_utf8_41_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x80 ... 0xbf:                                  action_utf8_42(term, data);                                       return STATE_UTF8_42;
+    default:            action_utf8_print(term, 0xfffd); return state_ground_switch(term, data);
+    }
+}
+
+static enum state
+state_utf8_42_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x80 ... 0xbf:                                  action_utf8_43(term, data);                                       return STATE_UTF8_43;
+    default:            action_utf8_print(term, 0xfffd); return state_ground_switch(term, data);
+    }
+}
+
+static enum state
+state_utf8_43_switch(struct terminal *term, uint8_t data)
+{
+    switch (data) {
+        /*              exit                             current                          enter                            new state */
+    case 0x80 ... 0xbf:                                  action_utf8_44(term, data);                                       return STATE_GROUND;
+    default:            action_utf8_print(term, 0xfffd); return state_ground_switch(term, data);
+    }
+}
+
+UNIGNORE_WARNINGS
+
+void
+vt_from_slave_reference(struct terminal *term, const uint8_t *data, size_t len)
+{
+    enum state current_state = term->vt.state;
+
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; i++, p++) {
+        switch (current_state) {
+        case STATE_GROUND:              current_state = state_ground_switch(term, *p); break;
+        case STATE_ESCAPE:              current_state = state_escape_switch(term, *p); break;
+        case STATE_ESCAPE_INTERMEDIATE: current_state = state_escape_intermediate_switch(term, *p); break;
+        case STATE_CSI_ENTRY:           current_state = state_csi_entry_switch(term, *p); break;
+        case STATE_CSI_PARAM:           current_state = state_csi_param_switch(term, *p); break;
+        case STATE_CSI_INTERMEDIATE:    current_state = state_csi_intermediate_switch(term, *p); break;
+        case STATE_CSI_IGNORE:          current_state = state_csi_ignore_switch(term, *p); break;
+        case STATE_OSC_STRING:          current_state = state_osc_string_switch(term, *p); break;
+        case STATE_DCS_ENTRY:           current_state = state_dcs_entry_switch(term, *p); break;
+        case STATE_DCS_PARAM:           current_state = state_dcs_param_switch(term, *p); break;
+        case STATE_DCS_INTERMEDIATE:    current_state = state_dcs_intermediate_switch(term, *p); break;
+        case STATE_DCS_IGNORE:          current_state = state_dcs_ignore_switch(term, *p); break;
+        case STATE_DCS_PASSTHROUGH:     current_state = state_dcs_passthrough_switch(term, *p); break;
+        case STATE_SOS_PM_APC_STRING:   current_state = state_sos_pm_apc_string_switch(term, *p); break;
+
+        case STATE_UTF8_21:             current_state = state_utf8_21_switch(term, *p); break;
+        case STATE_UTF8_31:             current_state = state_utf8_31_switch(term, *p); break;
+        case STATE_UTF8_32:             current_state = state_utf8_32_switch(term, *p); break;
+        case STATE_UTF8_41:             current_state = state_utf8_41_switch(term, *p); break;
+        case STATE_UTF8_42:             current_state = state_utf8_42_switch(term, *p); break;
+        case STATE_UTF8_43:             current_state = state_utf8_43_switch(term, *p); break;
+        }
+
+        term->vt.state = current_state;
+    }
+}
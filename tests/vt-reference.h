@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../terminal.h"
+
+/* The original, switch based, parser; used to verify vt_from_slave() */
+void vt_from_slave_reference(
+    struct terminal *term, const uint8_t *data, size_t len);
+
+/*
+ * Number of bytes of a UTF-8 sequence decoded so far (into
+ * term->vt.utf8), in parser state 'state'. 0 if not in a UTF-8 state.
+ */
+size_t vt_utf8_bytes_decoded(int state);
@@ -354,7 +354,7 @@ regex_detected(const struct terminal *term, enum url_action action,
             /* Expand combining characters */
             if (wc[0] >= CELL_COMB_CHARS_LO && wc[0] <= CELL_COMB_CHARS_HI) {
                 const struct composed *composed =
-                    composed_lookup(term->composed, wc[0] - CELL_COMB_CHARS_LO);
+                    composed_lookup(&term->composed, wc[0] - CELL_COMB_CHARS_LO);
                 xassert(composed != NULL);
 
                 wc = composed->chars;
@@ -701,8 +701,8 @@ tag_cells_for_url(struct terminal *term, const struct url *url, bool value)
     size_t r = start->row & (grid->num_rows - 1);
     size_t c = start->col;
 
-    struct row *row = grid->rows[r];
-    row->dirty = true;
+    struct row *row = grid_row_unpacked(grid, r);
+    grid_row_dirty(row);
 
     while (true) {
         struct cell *cell = &row->cells[c];
@@ -716,13 +716,13 @@ tag_cells_for_url(struct terminal *term, const struct url *url, bool value)
             r = (r + 1) & (grid->num_rows - 1);
             c = 0;
 
-            row = grid->rows[r];
+            row = grid_row_unpacked(grid, r);
             if (row == NULL) {
                 /* Un-allocated scrollback. This most likely means a
                  * runaway OSC-8 URL. */
                 break;
             }
-            row->dirty = true;
+            grid_row_dirty(row);
         }
     }
 }
@@ -747,7 +747,7 @@ urls_render(struct terminal *term, const struct config_spawn_template *launch)
         if (cursor_row != NULL) {
             struct cell *cell = &cursor_row->cells[term->render.last_cursor.col];
             cell->attrs.clean = 0;
-            cursor_row->dirty = true;
+            grid_row_dirty(cursor_row);
         }
     }
     term->render.last_cursor.row = NULL;
@@ -8,6 +8,14 @@
  #include <utf8proc.h>
 #endif
 
+#if defined(__AVX2__)
+ #include <immintrin.h>
+#elif defined(__SSE2__)
+ #include <emmintrin.h>
+#elif defined(__ARM_NEON)
+ #include <arm_neon.h>
+#endif
+
 #define LOG_MODULE "vt"
 #define LOG_ENABLE_DBG 0
 #include "log.h"
@@ -16,6 +24,7 @@
 #include "csi.h"
 #include "dcs.h"
 #include "debug.h"
+#include "grid.h"
 #include "osc.h"
 #include "sixel.h"
 #include "util.h"
@@ -103,11 +112,6 @@ esc_as_string(struct terminal *term, uint8_t final)
 }
 #endif
 
-static void
-action_ignore(struct terminal *term)
-{
-}
-
 static void
 action_clear(struct terminal *term)
 {
@@ -201,7 +205,7 @@ action_execute(struct terminal *term, uint8_t c)
          * subsequent cells, all the way until the next tab stop.
          */
         if (emit_tab_char) {
-            row->dirty = true;
+            grid_row_dirty(row);
 
             row->cells[start_col].wc = U'\t';
             row->cells[start_col].attrs.clean = 0;
@@ -290,11 +294,108 @@ action_execute(struct terminal *term, uint8_t c)
     }
 }
 
-static void
-action_print(struct terminal *term, uint8_t c)
+/*
+ * Returns the length of the initial run of printable ASCII
+ * characters (0x20-0x7e) in 'data'.
+ */
+static size_t
+printable_ascii_run_length(const uint8_t *data, size_t len)
+{
+    size_t i = 0;
+
+    /*
+     * Note: the x86 compares are signed; bytes >= 0x80 are negative,
+     * and thus fail the "> 0x1f" test.
+     */
+
+#if defined(__AVX2__)
+    const __m256i lo32 = _mm256_set1_epi8(0x1f);
+    const __m256i hi32 = _mm256_set1_epi8(0x7f);
+
+    for (; i + 32 <= len; i += 32) {
+        const __m256i v = _mm256_loadu_si256((const __m256i *)&data[i]);
+        const __m256i printable = _mm256_and_si256(
+            _mm256_cmpgt_epi8(v, lo32), _mm256_cmpgt_epi8(hi32, v));
+
+        const uint32_t mask = _mm256_movemask_epi8(printable);
+        if (mask != 0xffffffff)
+            return i + __builtin_ctz(~mask);
+    }
+#endif
+
+#if defined(__SSE2__)
+    const __m128i lo16 = _mm_set1_epi8(0x1f);
+    const __m128i hi16 = _mm_set1_epi8(0x7f);
+
+    for (; i + 16 <= len; i += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i *)&data[i]);
+        const __m128i printable = _mm_and_si128(
+            _mm_cmpgt_epi8(v, lo16), _mm_cmplt_epi8(v, hi16));
+
+        const uint32_t mask = _mm_movemask_epi8(printable);
+        if (mask != 0xffff)
+            return i + __builtin_ctz(~mask);
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t lo16 = vdupq_n_u8(0x20);
+    const uint8x16_t hi16 = vdupq_n_u8(0x7e);
+
+    for (; i + 16 <= len; i += 16) {
+        const uint8x16_t v = vld1q_u8(&data[i]);
+        const uint8x16_t printable = vandq_u8(
+            vcgeq_u8(v, lo16), vcleq_u8(v, hi16));
+
+        /* Narrow to one nibble per byte */
+        const uint64_t mask = vget_lane_u64(
+            vreinterpret_u64_u8(
+                vshrn_n_u16(vreinterpretq_u16_u8(printable), 4)), 0);
+
+        if (mask != UINT64_MAX)
+            return i + __builtin_ctzll(~mask) / 4;
+    }
+#endif
+
+    for (; i < len; i++) {
+        if (data[i] < 0x20 || data[i] > 0x7e)
+            break;
+    }
+
+    return i;
+}
+
+UNITTEST
+{
+    uint8_t data[100];
+
+    for (size_t len = 0; len <= sizeof(data); len++) {
+        memset(data, 'a', sizeof(data));
+        xassert(printable_ascii_run_length(data, len) == len);
+
+        static const uint8_t non_printable[] = {
+            0x00, 0x07, 0x1b, 0x1f, 0x7f, 0x80, 0x9b, 0xc3, 0xff};
+
+        for (size_t i = 0; i < len; i++) {
+            for (size_t j = 0; j < ALEN(non_printable); j++) {
+                data[i] = non_printable[j];
+                xassert(printable_ascii_run_length(data, len) == i);
+            }
+
+            data[i] = i & 1 ? 0x20 : 0x7e;
+        }
+    }
+}
+
+/*
+ * Prints the run of printable ASCII characters starting at 'p' (which
+ * is known to be printable). Returns a pointer to the first byte
+ * following the run.
+ */
+static const uint8_t *
+action_print_run(struct terminal *term, const uint8_t *p, const uint8_t *end)
 {
-    term_reset_grapheme_state(term);
-    term->ascii_printer(term, c);
+    const size_t count = printable_ascii_run_length(p, end - p);
+    term_print_ascii_run(term, p, count);
+    return p + count;
 }
 
 static void
@@ -739,363 +840,205 @@ action_utf8_44(struct terminal *term, uint8_t c)
     action_utf8_print(term, term->vt.utf8);
 }
 
-IGNORE_WARNING("-Wpedantic")
-
-static enum state
-anywhere(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x18:                                           action_execute(term, data);                                       return STATE_GROUND;
-    case 0x1a:                                           action_execute(term, data);                                       return STATE_GROUND;
-    case 0x1b:                                                                            action_clear(term);              return STATE_ESCAPE;
-
-    /* 8-bit C1 control characters (not supported) */
-    case 0x80 ... 0x9f:                                                                                                    return STATE_GROUND;
-    }
-
-    return term->vt.state;
-}
-
-static enum state
-state_ground_switch(struct terminal *term, uint8_t data)
+/*
+ * Returns the length of the initial run of non-ASCII bytes (0x80-0xff)
+ * in 'data'.
+ */
+static size_t
+non_ascii_run_length(const uint8_t *data, size_t len)
 {
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x00 ... 0x17:
-    case 0x19:
-    case 0x1c ... 0x1f:                                  action_execute(term, data);                                       return STATE_GROUND;
-
-    /* modified from 0x20..0x7f to 0x20..0x7e, since 0x7f is DEL, which is a zero-width character */
-    case 0x20 ... 0x7e:                                  action_print(term, data);                                         return STATE_GROUND;
-
-    case 0xc2 ... 0xdf:                                  action_utf8_21(term, data);                                       return STATE_UTF8_21;
-    case 0xe0 ... 0xef:                                  action_utf8_31(term, data);                                       return STATE_UTF8_31;
-    case 0xf0 ... 0xf4:                                  action_utf8_41(term, data);                                       return STATE_UTF8_41;
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    for (; i + 32 <= len; i += 32) {
+        const __m256i v = _mm256_loadu_si256((const __m256i *)&data[i]);
+        const uint32_t mask = _mm256_movemask_epi8(v);
+        if (mask != 0xffffffff)
+            return i + __builtin_ctz(~mask);
     }
+#endif
 
-    return anywhere(term, data);
-}
-
-static enum state
-state_escape_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x00 ... 0x17:
-    case 0x19:
-    case 0x1c ... 0x1f:                                  action_execute(term, data);                                       return STATE_ESCAPE;
-
-    case 0x20 ... 0x2f:                                  action_collect(term, data);                                       return STATE_ESCAPE_INTERMEDIATE;
-    case 0x30 ... 0x4f:                                  action_esc_dispatch(term, data);                                  return STATE_GROUND;
-    case 0x50:                                                                            action_clear(term);              return STATE_DCS_ENTRY;
-    case 0x51 ... 0x57:                                  action_esc_dispatch(term, data);                                  return STATE_GROUND;
-    case 0x58:                                                                                                             return STATE_SOS_PM_APC_STRING;
-    case 0x59:                                           action_esc_dispatch(term, data);                                  return STATE_GROUND;
-    case 0x5a:                                           action_esc_dispatch(term, data);                                  return STATE_GROUND;
-    case 0x5b:                                                                            action_clear(term);              return STATE_CSI_ENTRY;
-    case 0x5c:                                           action_esc_dispatch(term, data);                                  return STATE_GROUND;
-    case 0x5d:                                                                            action_osc_start(term, data);    return STATE_OSC_STRING;
-    case 0x5e ... 0x5f:                                                                                                    return STATE_SOS_PM_APC_STRING;
-    case 0x60 ... 0x7e:                                  action_esc_dispatch(term, data);                                  return STATE_GROUND;
-    case 0x7f:                                           action_ignore(term);                                              return STATE_ESCAPE;
-    }
-
-    return anywhere(term, data);
-}
-
-static enum state
-state_escape_intermediate_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x00 ... 0x17:
-    case 0x19:
-    case 0x1c ... 0x1f:                                  action_execute(term, data);                                       return STATE_ESCAPE_INTERMEDIATE;
-
-    case 0x20 ... 0x2f:                                  action_collect(term, data);                                       return STATE_ESCAPE_INTERMEDIATE;
-    case 0x30 ... 0x7e:                                  action_esc_dispatch(term, data);                                  return STATE_GROUND;
-    case 0x7f:                                           action_ignore(term);                                              return STATE_ESCAPE_INTERMEDIATE;
-    }
-
-    return anywhere(term, data);
-}
-
-static enum state
-state_csi_entry_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x00 ... 0x17:
-    case 0x19:
-    case 0x1c ... 0x1f:                                  action_execute(term, data);                                       return STATE_CSI_ENTRY;
-
-    case 0x20 ... 0x2f:                                  action_collect(term, data);                                       return STATE_CSI_INTERMEDIATE;
-    case 0x30 ... 0x39:                                  action_param(term, data);                                         return STATE_CSI_PARAM;
-    case 0x3a:                                           action_param_new_subparam(term, data);                            return STATE_CSI_PARAM;
-    case 0x3b:                                           action_param_new(term, data);                                     return STATE_CSI_PARAM;
-
-    case 0x3c ... 0x3f:                                  action_collect(term, data);                                       return STATE_CSI_PARAM;
-    case 0x40 ... 0x7e:                                  action_csi_dispatch(term, data);                                  return STATE_GROUND;
-    case 0x7f:                                           action_ignore(term);                                              return STATE_CSI_ENTRY;
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i *)&data[i]);
+        const uint32_t mask = _mm_movemask_epi8(v);
+        if (mask != 0xffff)
+            return i + __builtin_ctz(~mask);
     }
+#elif defined(__ARM_NEON)
+    const uint8x16_t hi16 = vdupq_n_u8(0x80);
 
-    return anywhere(term, data);
-}
+    for (; i + 16 <= len; i += 16) {
+        const uint8x16_t v = vld1q_u8(&data[i]);
+        const uint8x16_t non_ascii = vcgeq_u8(v, hi16);
 
-static enum state
-state_csi_param_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x00 ... 0x17:
-    case 0x19:
-    case 0x1c ... 0x1f:                                  action_execute(term, data);                                       return STATE_CSI_PARAM;
+        /* Narrow to one nibble per byte */
+        const uint64_t mask = vget_lane_u64(
+            vreinterpret_u64_u8(
+                vshrn_n_u16(vreinterpretq_u16_u8(non_ascii), 4)), 0);
 
-    case 0x20 ... 0x2f:                                  action_collect(term, data);                                       return STATE_CSI_INTERMEDIATE;
-
-    case 0x30 ... 0x39:                                  action_param(term, data);                                         return STATE_CSI_PARAM;
-    case 0x3a:                                           action_param_new_subparam(term, data);                            return STATE_CSI_PARAM;
-    case 0x3b:                                           action_param_new(term, data);                                     return STATE_CSI_PARAM;
-
-    case 0x3c ... 0x3f:                                                                                                    return STATE_CSI_IGNORE;
-    case 0x40 ... 0x7e:                                  action_csi_dispatch(term, data);                                  return STATE_GROUND;
-    case 0x7f:                                           action_ignore(term);                                              return STATE_CSI_PARAM;
-    }
-
-    return anywhere(term, data);
-}
-
-static enum state
-state_csi_intermediate_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x00 ... 0x17:
-    case 0x19:
-    case 0x1c ... 0x1f:                                  action_execute(term, data);                                       return STATE_CSI_INTERMEDIATE;
-
-    case 0x20 ... 0x2f:                                  action_collect(term, data);                                       return STATE_CSI_INTERMEDIATE;
-    case 0x30 ... 0x3f:                                                                                                    return STATE_CSI_IGNORE;
-    case 0x40 ... 0x7e:                                  action_csi_dispatch(term, data);                                  return STATE_GROUND;
-    case 0x7f:                                           action_ignore(term);                                              return STATE_CSI_INTERMEDIATE;
+        if (mask != UINT64_MAX)
+            return i + __builtin_ctzll(~mask) / 4;
     }
+#endif
 
-    return anywhere(term, data);
-}
-
-static enum state
-state_csi_ignore_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x00 ... 0x17:
-    case 0x19:
-    case 0x1c ... 0x1f:                                  action_execute(term, data);                                       return STATE_CSI_IGNORE;
-
-    case 0x20 ... 0x3f:                                  action_ignore(term);                                              return STATE_CSI_IGNORE;
-    case 0x40 ... 0x7e:                                                                                                    return STATE_GROUND;
-    case 0x7f:                                           action_ignore(term);                                              return STATE_CSI_IGNORE;
+    for (; i < len; i++) {
+        if (data[i] < 0x80)
+            break;
     }
 
-    return anywhere(term, data);
+    return i;
 }
 
-static enum state
-state_osc_string_switch(struct terminal *term, uint8_t data)
+UNITTEST
 {
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-
-    /* Note: original was 20-7f, but I changed to 20-ff to include utf-8. Don't forget to add EXECUTE to 8-bit C1 if we implement that. */
-    default:                                             action_osc_put(term, data);                                       return STATE_OSC_STRING;
-
-    case 0x07:          action_osc_end(term, data);                                                                        return STATE_GROUND;
-
-    case 0x00 ... 0x06:
-    case 0x08 ... 0x17:
-    case 0x19:
-    case 0x1c ... 0x1f:                                  action_ignore(term);                                              return STATE_OSC_STRING;
-
-
-    case 0x18:
-    case 0x1a:          action_osc_end(term, data);      action_execute(term, data);                                       return STATE_GROUND;
-
-    case 0x1b:          action_osc_end(term, data);      action_clear(term);                                               return STATE_ESCAPE;
+    uint8_t data[100];
+
+    for (size_t len = 0; len <= sizeof(data); len++) {
+        memset(data, 0xe4, sizeof(data));
+        xassert(non_ascii_run_length(data, len) == len);
+
+        for (size_t i = 0; i < len; i++) {
+            data[i] = 0x7f;
+            xassert(non_ascii_run_length(data, len) == i);
+            data[i] = i & 1 ? 0x00 : 'a';
+            xassert(non_ascii_run_length(data, len) == i);
+            data[i] = i & 1 ? 0x80 : 0xff;
+        }
     }
 }
 
-static enum state
-state_dcs_entry_switch(struct terminal *term, uint8_t data)
+/*
+ * Decodes the UTF-8 sequences in the non-ASCII run starting at 'p'
+ * (in the ground state, 'p' pointing to a lead byte), and prints the
+ * decoded characters in batches.
+ *
+ * Only complete, well-formed sequences are decoded. Decoding stops at
+ * the first sequence that is truncated (by an ASCII character, or by
+ * the end of the buffer), or that has an invalid continuation
+ * byte. Such sequences are left to the byte-at-a-time UTF-8 states,
+ * which takes care of emitting replacement characters, and of
+ * carrying partial sequences over to the next call to
+ * vt_from_slave().
+ *
+ * Surrogates (3-byte) and out-of-range (4-byte) sequences are
+ * dropped, and stray continuation bytes, and bytes that are never
+ * valid in UTF-8, are ignored, exactly like the UTF-8 states do.
+ *
+ * Returns a pointer to the first byte not consumed, and sets 'state'
+ * to the new parser state.
+ */
+static const uint8_t *
+action_utf8_run(struct terminal *term, const uint8_t *p, const uint8_t *end,
+                enum state *state)
 {
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x00 ... 0x17:
-    case 0x19:
-    case 0x1c ... 0x1f:                                  action_ignore(term);                                              return STATE_DCS_ENTRY;
-
-    case 0x20 ... 0x2f:                                  action_collect(term, data);                                       return STATE_DCS_INTERMEDIATE;
-    case 0x30 ... 0x39:                                  action_param(term, data);                                         return STATE_DCS_PARAM;
-    case 0x3a:                                                                                                             return STATE_DCS_IGNORE;
-    case 0x3b:                                           action_param_new(term, data);                                     return STATE_DCS_PARAM;
-    case 0x3c ... 0x3f:                                  action_collect(term, data);                                       return STATE_DCS_PARAM;
-    case 0x40 ... 0x7e:                                                                   action_hook(term, data);         return STATE_DCS_PASSTHROUGH;
-    case 0x7f:                                           action_ignore(term);                                              return STATE_DCS_ENTRY;
-    }
+    const uint8_t *const start = p;
+    const uint8_t *const run_end = p + non_ascii_run_length(p, end - p);
 
-    return anywhere(term, data);
-}
+    char32_t wcs[256];
+    size_t count = 0;
 
-static enum state
-state_dcs_param_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x00 ... 0x17:
-    case 0x19:
-    case 0x1c ... 0x1f:                                  action_ignore(term);                                              return STATE_DCS_PARAM;
-
-    case 0x20 ... 0x2f:                                  action_collect(term, data);                                       return STATE_DCS_INTERMEDIATE;
-    case 0x30 ... 0x39:                                  action_param(term, data);                                         return STATE_DCS_PARAM;
-    case 0x3a:                                                                                                             return STATE_DCS_IGNORE;
-    case 0x3b:                                           action_param_new(term, data);                                     return STATE_DCS_PARAM;
-    case 0x3c ... 0x3f:                                                                                                    return STATE_DCS_IGNORE;
-    case 0x40 ... 0x7e:                                                                   action_hook(term, data);         return STATE_DCS_PASSTHROUGH;
-    case 0x7f:                                           action_ignore(term);                                              return STATE_DCS_PARAM;
-    }
-
-    return anywhere(term, data);
-}
+    while (p < run_end) {
+        const uint8_t c0 = p[0];
 
-static enum state
-state_dcs_intermediate_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x00 ... 0x17:
-    case 0x19:
-    case 0x1c ... 0x1f:                                  action_ignore(term);                                              return STATE_DCS_INTERMEDIATE;
-
-    case 0x20 ... 0x2f:                                  action_collect(term, data);                                       return STATE_DCS_INTERMEDIATE;
-    case 0x30 ... 0x3f:                                                                                                    return STATE_DCS_IGNORE;
-    case 0x40 ... 0x7e:                                                                   action_hook(term, data);         return STATE_DCS_PASSTHROUGH;
-    case 0x7f:                                           action_ignore(term);                                              return STATE_DCS_INTERMEDIATE;
-    }
+        if (unlikely(c0 < 0xc2 || c0 > 0xf4)) {
+            /* Ignored in the ground state */
+            p++;
+            continue;
+        }
 
-    return anywhere(term, data);
-}
+        const size_t left = run_end - p;
+        char32_t wc;
 
-static enum state
-state_dcs_ignore_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x00 ... 0x17:
-    case 0x19:
-    case 0x1c ... 0x1f:
-    case 0x20 ... 0x7f:                                  action_ignore(term);                                              return STATE_DCS_IGNORE;
-    }
+        if (c0 <= 0xdf) {
+            if (left < 2 || (p[1] & 0xc0) != 0x80)
+                break;
 
-    return anywhere(term, data);
-}
+            wc = (c0 & 0x1f) << 6 | (p[1] & 0x3f);
+            p += 2;
+        }
 
-static enum state
-state_dcs_passthrough_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x00 ... 0x17:
-    case 0x19:
-    case 0x1c ... 0x7e:                                  action_put(term, data);                                           return STATE_DCS_PASSTHROUGH;
+        else if (c0 <= 0xef) {
+            if (left < 3 || (p[1] & 0xc0) != 0x80 || (p[2] & 0xc0) != 0x80)
+                break;
 
-    case 0x7f:                                           action_ignore(term);                                              return STATE_DCS_PASSTHROUGH;
+            wc = (c0 & 0x0f) << 12 | (p[1] & 0x3f) << 6 | (p[2] & 0x3f);
+            p += 3;
 
-    /* Anywhere */
-    case 0x18:          action_unhook(term, data);       action_execute(term, data);                                       return STATE_GROUND;
-    case 0x1a:          action_unhook(term, data);       action_execute(term, data);                                       return STATE_GROUND;
-    case 0x1b:          action_unhook(term, data);                                        action_clear(term);              return STATE_ESCAPE;
+            if (unlikely(wc >= 0xd800 && wc <= 0xdfff)) {
+                /* Invalid sequence - invalid UTF-16 surrogate halves */
+                continue;
+            }
+        }
 
-    /* 8-bit C1 control characters (not supported) */
-    case 0x80 ... 0x9f: action_unhook(term, data);                                                                         return STATE_GROUND;
+        else {
+            if (left < 4 ||
+                (p[1] & 0xc0) != 0x80 ||
+                (p[2] & 0xc0) != 0x80 ||
+                (p[3] & 0xc0) != 0x80)
+            {
+                break;
+            }
 
-    default:                                                                                                               return STATE_DCS_PASSTHROUGH;
-    }
-}
+            wc = (c0 & 0x07) << 18 | (p[1] & 0x3f) << 12 |
+                (p[2] & 0x3f) << 6 | (p[3] & 0x3f);
+            p += 4;
 
-static enum state
-state_sos_pm_apc_string_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x00 ... 0x17:
-    case 0x19:
-    case 0x1c ... 0x7f:                                  action_ignore(term);                                              return STATE_SOS_PM_APC_STRING;
-    }
+            if (unlikely(wc > 0x10ffff)) {
+                /* Invalid UTF-8 */
+                continue;
+            }
+        }
 
-    return anywhere(term, data);
-}
+        wcs[count++] = wc;
 
-static enum state
-state_utf8_21_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x80 ... 0xbf:                                  action_utf8_22(term, data);                                       return STATE_GROUND;
-    default:            action_utf8_print(term, 0xfffd); return state_ground_switch(term, data);
+        if (count == ALEN(wcs)) {
+            term_process_and_print_non_ascii_run(term, wcs, count);
+            count = 0;
+        }
     }
-}
 
-static enum state
-state_utf8_31_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x80 ... 0xbf:                                  action_utf8_32(term, data);                                       return STATE_UTF8_32;
-    default:            action_utf8_print(term, 0xfffd); return state_ground_switch(term, data);
-    }
-}
+    if (count > 0)
+        term_process_and_print_non_ascii_run(term, wcs, count);
 
-static enum state
-state_utf8_32_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x80 ... 0xbf:                                  action_utf8_33(term, data);                                       return STATE_GROUND;
-    default:            action_utf8_print(term, 0xfffd); return state_ground_switch(term, data);
+    if (likely(p > start)) {
+        *state = STATE_GROUND;
+        return p;
     }
-}
 
-static enum state
-state_utf8_41_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x80 ... 0xbf:                                  action_utf8_42(term, data);                                       return STATE_UTF8_42;
-    default:            action_utf8_print(term, 0xfffd); return state_ground_switch(term, data);
+    /* Not even one sequence could be decoded; fall back to the UTF-8 states */
+    const uint8_t c0 = *p++;
+
+    if (c0 <= 0xdf) {
+        action_utf8_21(term, c0);
+        *state = STATE_UTF8_21;
+    } else if (c0 <= 0xef) {
+        action_utf8_31(term, c0);
+        *state = STATE_UTF8_31;
+    } else {
+        action_utf8_41(term, c0);
+        *state = STATE_UTF8_41;
     }
-}
 
-static enum state
-state_utf8_42_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x80 ... 0xbf:                                  action_utf8_43(term, data);                                       return STATE_UTF8_43;
-    default:            action_utf8_print(term, 0xfffd); return state_ground_switch(term, data);
-    }
+    return p;
 }
 
-static enum state
-state_utf8_43_switch(struct terminal *term, uint8_t data)
-{
-    switch (data) {
-        /*              exit                             current                          enter                            new state */
-    case 0x80 ... 0xbf:                                  action_utf8_44(term, data);                                       return STATE_GROUND;
-    default:            action_utf8_print(term, 0xfffd); return state_ground_switch(term, data);
-    }
-}
+#include "vt-table.h"
+
+/*
+ * The parser is table driven; each byte is mapped to a byte class,
+ * and the (state, class) pair is looked up in vt_transitions[] (see
+ * scripts/generate-vt-table.py), giving us the action(s) to execute,
+ * and the new state.
+ *
+ * When supported by the compiler, actions are dispatched with
+ * computed gotos, rather than a switch.
+ */
+#if defined(__GNUC__)
+ #define VT_COMPUTED_GOTO
+#endif
 
-UNIGNORE_WARNINGS
+IGNORE_WARNING("-Wpedantic")
 
 void
 vt_from_slave(struct terminal *term, const uint8_t *data, size_t len)
@@ -1103,31 +1046,55 @@ vt_from_slave(struct terminal *term, const uint8_t *data, size_t len)
     enum state current_state = term->vt.state;
 
     const uint8_t *p = data;
-    for (size_t i = 0; i < len; i++, p++) {
-        switch (current_state) {
-        case STATE_GROUND:              current_state = state_ground_switch(term, *p); break;
-        case STATE_ESCAPE:              current_state = state_escape_switch(term, *p); break;
-        case STATE_ESCAPE_INTERMEDIATE: current_state = state_escape_intermediate_switch(term, *p); break;
-        case STATE_CSI_ENTRY:           current_state = state_csi_entry_switch(term, *p); break;
-        case STATE_CSI_PARAM:           current_state = state_csi_param_switch(term, *p); break;
-        case STATE_CSI_INTERMEDIATE:    current_state = state_csi_intermediate_switch(term, *p); break;
-        case STATE_CSI_IGNORE:          current_state = state_csi_ignore_switch(term, *p); break;
-        case STATE_OSC_STRING:          current_state = state_osc_string_switch(term, *p); break;
-        case STATE_DCS_ENTRY:           current_state = state_dcs_entry_switch(term, *p); break;
-        case STATE_DCS_PARAM:           current_state = state_dcs_param_switch(term, *p); break;
-        case STATE_DCS_INTERMEDIATE:    current_state = state_dcs_intermediate_switch(term, *p); break;
-        case STATE_DCS_IGNORE:          current_state = state_dcs_ignore_switch(term, *p); break;
-        case STATE_DCS_PASSTHROUGH:     current_state = state_dcs_passthrough_switch(term, *p); break;
-        case STATE_SOS_PM_APC_STRING:   current_state = state_sos_pm_apc_string_switch(term, *p); break;
-
-        case STATE_UTF8_21:             current_state = state_utf8_21_switch(term, *p); break;
-        case STATE_UTF8_31:             current_state = state_utf8_31_switch(term, *p); break;
-        case STATE_UTF8_32:             current_state = state_utf8_32_switch(term, *p); break;
-        case STATE_UTF8_41:             current_state = state_utf8_41_switch(term, *p); break;
-        case STATE_UTF8_42:             current_state = state_utf8_42_switch(term, *p); break;
-        case STATE_UTF8_43:             current_state = state_utf8_43_switch(term, *p); break;
-        }
+    const uint8_t *const end = data + len;
+    uint8_t c;
+    uint16_t t;
+
+    /* Consumes the next byte, transitions to the new state, and
+     * evaluates to the action to execute */
+#define NEXT_TRANSITION()                                               \
+    (c = *p++,                                                          \
+     t = vt_transitions[current_state][vt_byte_class[c]],               \
+     current_state = VT_TRANSITION_STATE(t),                            \
+     VT_TRANSITION_ACTION(t))
+
+#if defined(VT_COMPUTED_GOTO)
+    static const void *const dispatch_table[] = {
+ #define X(name, body) [VT_ACTION_##name] = &&action_##name,
+        VT_ACTION_LIST(X)
+ #undef X
+    };
+
+ #define DISPATCH()                                                     \
+    do {                                                                \
+        if (unlikely(p >= end))                                         \
+            goto out;                                                   \
+        goto *dispatch_table[NEXT_TRANSITION()];                        \
+    } while (0)
+
+    DISPATCH();
+
+ #define X(name, body) action_##name: { body } DISPATCH();
+    VT_ACTION_LIST(X)
+ #undef X
+
+out:
+#else
+ #define DISPATCH() continue
 
-        term->vt.state = current_state;
+    while (p < end) {
+        switch (NEXT_TRANSITION()) {
+ #define X(name, body) case VT_ACTION_##name: { body } DISPATCH();
+        VT_ACTION_LIST(X)
+ #undef X
+        }
     }
+#endif
+
+#undef DISPATCH
+#undef NEXT_TRANSITION
+
+    term->vt.state = current_state;
 }
+
+UNIGNORE_WARNINGS